@@ -0,0 +1,394 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "benchmark_options.h"
+#include "cpu_isa.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <limits>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace
+{
+
+/// Non-negative number, integer types take digits only and are range checked
+template <typename value_type>
+value_type parse_number (const std::string &option, const std::string &value)
+{
+  if constexpr (std::is_integral_v<value_type>)
+    {
+      unsigned long long result {};
+      const auto [end, error] = std::from_chars (value.data (), value.data () + value.size (), result);
+
+      if (error == std::errc {} && end == value.data () + value.size ()
+          && result <= static_cast<unsigned long long> (std::numeric_limits<value_type>::max ()))
+        return static_cast<value_type> (result);
+    }
+  else
+    {
+      try
+        {
+          size_t end {};
+          const double result = std::stod (value, &end);
+
+          if (end == value.size () && result >= 0)
+            return static_cast<value_type> (result);
+        }
+      catch (const std::logic_error &)
+        {
+        }
+    }
+
+  throw std::runtime_error ("Error! Invalid value '" + value + "' of " + option);
+}
+
+/// Comma separated list, e.g. 2,4,8
+template <typename value_type>
+std::vector<value_type> parse_list (const std::string &option, const std::string &value)
+{
+  std::vector<value_type> result;
+  std::istringstream is (value);
+  std::string item;
+
+  while (std::getline (is, item, ','))
+    result.push_back (parse_number<value_type> (option, item));
+
+  if (result.empty ())
+    throw std::runtime_error ("Error! Empty list in " + option);
+
+  return result;
+}
+
+/// Comma separated names, e.g. jacobi,bilu0
+std::vector<std::string> parse_names (const std::string &option, const std::string &value)
+{
+  std::vector<std::string> result;
+  std::istringstream is (value);
+  std::string item;
+
+  while (std::getline (is, item, ','))
+    if (!item.empty ())
+      result.push_back (item);
+
+  if (result.empty ())
+    throw std::runtime_error ("Error! Empty list in " + option);
+
+  return result;
+}
+
+matrix_source parse_source (const std::string &value)
+{
+  if (value == "generator") return matrix_source::generator;
+  if (value == "mtx") return matrix_source::mtx;
+  if (value == "binary") return matrix_source::binary;
+  if (value == "bridge") return matrix_source::bridge;
+
+  throw std::runtime_error ("Error! Unknown matrix source '" + value + "'");
+}
+
+std::string to_string (matrix_source source)
+{
+  switch (source)
+    {
+      case matrix_source::generator: return "generator";
+      case matrix_source::mtx: return "mtx";
+      case matrix_source::binary: return "binary";
+      case matrix_source::bridge: return "bridge";
+    }
+
+  return {};
+}
+
+}
+
+std::string get_benchmark_usage (const std::string &program)
+{
+  return "Usage: " + program + " [options] [input]\n"
+    "\n"
+    "Matrix source:\n"
+    "  --source generator|mtx|binary|bridge   (default: generator, mtx if input is given)\n"
+    "  --input PATH            .mtx file, directory of .mtx files or manifest; binary CSR file\n"
+    "  --rows N                generator block rows (default: 50000)\n"
+    "  --blocks-per-row N      generator blocks per row (default: 6)\n"
+    "  --save-binary PATH      write source matrix as binary CSR (mtx and generator sources)\n"
+    "  --solve                 bridge: solve the system instead of measuring SpMV\n"
+    "  --solver NAME           gpu-bicgstab (default); CPU solvers with the first --threads count:\n"
+    "                          bicgstab, pbicgstab (pipelined), cg (symmetric positive definite)\n"
+    "  --load-cases N          bridge: solve N positions of the load in one batch (cg with none or jacobi precond)\n"
+    "  --load-steps N          bridge: move the load through N positions, each solve starts from the previous solution;\n"
+    "                          cg (none or jacobi precond) also recycles a deflation subspace, gpu-bicgstab warm starts only\n"
+    "  --recycle N             recycled subspace of cg in --load-steps (default: 8, 0 to warm start only)\n"
+    "  --monitor-stride N      print solver progress every N iterations (default: 0, the last iteration only);\n"
+    "                          convergence history of solves is stored in results file either way\n"
+    "  --mixed-precision       CPU solvers iterate in float on float copy of matrix, refined on double residual\n"
+    "                          until it reaches the tolerance (--dtype double, none or jacobi precond)\n"
+    "  --solver-format NAME    matrix kernel of CPU solvers: csr, bcsr (default, row major blocks), bcsr-column-major,\n"
+    "                          auto (fastest format and block size on this host, the decision is cached)\n"
+    "  --precond LIST          CPU solvers preconditioners: none, jacobi (default), block-jacobi, bilu0,\n"
+    "                          amg, amg-chebyshev (smoothed aggregation V-cycle with Jacobi / Chebyshev smoother),\n"
+    "                          chebyshev (polynomial in block-Jacobi preconditioned matrix, no inner products);\n"
+    "                          with several the system is solved with each and setup/solve times are compared\n"
+    "  --chebyshev-degree N    degree of chebyshev preconditioner, it takes N - 1 SpMVs per apply (default: 4)\n"
+    "\n"
+    "Types and kernels:\n"
+    "  --dtype float|double    (default: float)\n"
+    "  --itype int32|int64     (default: int32; int64 runs CPU kernels only)\n"
+    "  --block-sizes LIST      comma separated (default: 2,4,8,16,32)\n"
+    "  --kernels REGEX         measure only kernels whose name matches\n"
+    "  --threads LIST          thread counts of CPU kernels (default: all hardware threads)\n"
+    "  --device N              CUDA device (default: 1)\n"
+    "  --isa generic|sse4|avx2|avx512   CPU kernels instruction set (default: highest supported)\n"
+    "\n"
+    "Measurement:\n"
+    "  --repetitions N         fixed number of recorded runs per kernel\n"
+    "  --max-repetitions N     upper bound of adaptive repetitions (default: 200)\n"
+    "  --warmup N              runs before recording (default: 2)\n"
+    "  --target-ci X           relative 95% CI half width to stop at (default: 0.01)\n"
+    "  --no-counters           don't record hardware counters\n"
+    "\n"
+    "Thread scaling:\n"
+    "  --scaling strong|weak   run threaded CPU kernels at 1, 2, 4 ... all cores and per NUMA node;\n"
+    "                          weak scaling multiplies generator rows by threads count\n"
+    "\n"
+    "Regression check:\n"
+    "  --baseline PATH         rerun configuration of results file and compare, exit code 2 on regression\n"
+    "  --threshold X           relative slowdown considered a regression (default: 0.05)\n"
+    "\n"
+    "  --output PATH           result file (default: result.json)\n"
+    "  --help\n";
+}
+
+std::optional<benchmark_options> parse_benchmark_options (int argc, char *argv[])
+{
+  benchmark_options options;
+  options.settings.collect_counters = true;
+
+  bool source_is_set = false;
+
+  for (int i = 1; i < argc; i++)
+    {
+      const std::string option = argv[i];
+
+      auto value = [&] () -> std::string {
+        if (i + 1 >= argc)
+          throw std::runtime_error ("Error! Missing value of " + option);
+        return argv[++i];
+      };
+
+      if (option == "--help" || option == "-h")
+        return std::nullopt;
+      else if (option == "--source")
+        {
+          options.source = parse_source (value ());
+          source_is_set = true;
+        }
+      else if (option == "--input")
+        options.input = value ();
+      else if (option == "--rows")
+        options.n_rows = parse_number<unsigned int> (option, value ());
+      else if (option == "--blocks-per-row")
+        options.blocks_per_row = parse_number<unsigned int> (option, value ());
+      else if (option == "--save-binary")
+        options.save_binary = value ();
+      else if (option == "--solve")
+        options.solve = true;
+      else if (option == "--solver")
+        options.solver = value ();
+      else if (option == "--load-cases")
+        options.load_cases = parse_number<unsigned int> (option, value ());
+      else if (option == "--load-steps")
+        options.load_steps = parse_number<unsigned int> (option, value ());
+      else if (option == "--recycle")
+        options.recycled = parse_number<unsigned int> (option, value ());
+      else if (option == "--monitor-stride")
+        options.monitor_stride = parse_number<unsigned int> (option, value ());
+      else if (option == "--mixed-precision")
+        options.mixed_precision = true;
+      else if (option == "--solver-format")
+        options.solver_format = value ();
+      else if (option == "--precond")
+        options.preconditioners = parse_names (option, value ());
+      else if (option == "--chebyshev-degree")
+        options.chebyshev_degree = parse_number<unsigned int> (option, value ());
+      else if (option == "--dtype")
+        options.data_type = value ();
+      else if (option == "--itype")
+        options.index_type = value ();
+      else if (option == "--block-sizes")
+        options.block_sizes = parse_list<int> (option, value ());
+      else if (option == "--kernels")
+        options.kernel_filter = value ();
+      else if (option == "--threads")
+        options.threads_counts = parse_list<unsigned int> (option, value ());
+      else if (option == "--device")
+        options.device = parse_number<int> (option, value ());
+      else if (option == "--isa")
+        options.isa = to_string (cpu_isa_from_string (value ()));
+      else if (option == "--repetitions")
+        options.settings.min_count = options.settings.max_count = parse_number<unsigned int> (option, value ());
+      else if (option == "--max-repetitions")
+        options.settings.max_count = parse_number<unsigned int> (option, value ());
+      else if (option == "--warmup")
+        options.settings.warmup_count = parse_number<unsigned int> (option, value ());
+      else if (option == "--target-ci")
+        options.settings.target_relative_ci = parse_number<double> (option, value ());
+      else if (option == "--no-counters")
+        options.settings.collect_counters = false;
+      else if (option == "--scaling")
+        {
+          const std::string mode = value ();
+
+          if (mode == "strong")
+            options.scaling = scaling_mode::strong;
+          else if (mode == "weak")
+            options.scaling = scaling_mode::weak;
+          else
+            throw std::runtime_error ("Error! Unknown scaling mode " + mode);
+        }
+      else if (option == "--baseline")
+        options.baseline = value ();
+      else if (option == "--threshold")
+        options.regression_threshold = parse_number<double> (option, value ());
+      else if (option == "--output" || option == "-o")
+        options.output = value ();
+      else if (!option.empty () && option[0] != '-' && options.input.empty ())
+        options.input = option; ///< Positional input keeps the old `program <mtx path>` invocation working
+      else
+        throw std::runtime_error ("Error! Unknown option " + option);
+    }
+
+  if (!source_is_set && !options.input.empty ())
+    options.source = matrix_source::mtx;
+
+  if (options.data_type != "float" && options.data_type != "double")
+    throw std::runtime_error ("Error! Unsupported data type " + options.data_type);
+  if (options.index_type != "int32" && options.index_type != "int64")
+    throw std::runtime_error ("Error! Unsupported index type " + options.index_type);
+  if ((options.source == matrix_source::mtx || options.source == matrix_source::binary) && options.input.empty ())
+    throw std::runtime_error ("Error! Input path is required for mtx and binary sources");
+  if (options.solver != "gpu-bicgstab" && options.solver != "bicgstab" && options.solver != "pbicgstab" && options.solver != "cg")
+    throw std::runtime_error ("Error! Unknown solver " + options.solver);
+  if (options.solver_format != "csr" && options.solver_format != "bcsr" && options.solver_format != "bcsr-column-major" && options.solver_format != "auto")
+    throw std::runtime_error ("Error! Unknown solver format " + options.solver_format);
+  if (options.load_cases == 0)
+    throw std::runtime_error ("Error! At least one load case is required");
+  if (options.load_cases > 1 && (options.solver != "cg" || options.preconditioners.size () != 1
+                                 || (options.preconditioners.front () != "none" && options.preconditioners.front () != "jacobi")))
+    throw std::runtime_error ("Error! Batched load cases are solved by cg with one of none, jacobi preconditioners");
+  if (options.load_steps == 0)
+    throw std::runtime_error ("Error! At least one load step is required");
+  if (options.load_steps > 1 && options.load_cases > 1)
+    throw std::runtime_error ("Error! Load steps and batched load cases can't be combined");
+  if (options.load_steps > 1 && options.solver != "gpu-bicgstab"
+      && (options.solver != "cg" || options.preconditioners.size () != 1
+          || (options.preconditioners.front () != "none" && options.preconditioners.front () != "jacobi")))
+    throw std::runtime_error ("Error! Load steps are solved by gpu-bicgstab or by cg with one of none, jacobi preconditioners");
+  if (options.mixed_precision && (options.solver == "gpu-bicgstab" || options.data_type != "double"))
+    throw std::runtime_error ("Error! Mixed precision refines double solution of CPU solvers (--dtype double)");
+  if (options.mixed_precision && (options.preconditioners.size () != 1
+                                  || (options.preconditioners.front () != "none" && options.preconditioners.front () != "jacobi")))
+    throw std::runtime_error ("Error! Mixed precision solvers take one of none, jacobi preconditioners");
+  if (options.mixed_precision && (options.load_cases > 1 || options.load_steps > 1))
+    throw std::runtime_error ("Error! Mixed precision can't be combined with load cases or load steps");
+  for (auto &preconditioner: options.preconditioners)
+    if (preconditioner != "none" && preconditioner != "jacobi" && preconditioner != "block-jacobi" && preconditioner != "bilu0"
+        && preconditioner != "amg" && preconditioner != "amg-chebyshev" && preconditioner != "chebyshev")
+      throw std::runtime_error ("Error! Unknown preconditioner " + preconditioner);
+  if (options.chebyshev_degree == 0)
+    throw std::runtime_error ("Error! Chebyshev degree should be positive");
+  if (options.scaling == scaling_mode::weak && options.source != matrix_source::generator)
+    throw std::runtime_error ("Error! Weak scaling needs the generator source");
+  if (options.source == matrix_source::bridge && options.index_type != "int32")
+    throw std::runtime_error ("Error! Bridge model is built with int32 indices only");
+
+  for (auto bs: options.block_sizes)
+    if (bs < 1)
+      throw std::runtime_error ("Error! Block size should be positive");
+
+  for (auto threads_count: options.threads_counts)
+    if (threads_count < 1)
+      throw std::runtime_error ("Error! Threads count should be positive");
+
+  if (options.settings.max_count < 1)
+    throw std::runtime_error ("Error! At least one repetition is required");
+  options.settings.min_count = std::clamp (options.settings.min_count, 1u, options.settings.max_count);
+
+  if (options.kernel_filter)
+    {
+      try
+        {
+          std::regex check (*options.kernel_filter);
+        }
+      catch (const std::regex_error &error)
+        {
+          throw std::runtime_error ("Error! Invalid kernel filter: " + std::string (error.what ()));
+        }
+    }
+
+  return options;
+}
+
+nlohmann::json benchmark_options_to_json (const benchmark_options &options)
+{
+  nlohmann::json json;
+
+  json["source"] = to_string (options.source);
+  json["input"] = options.input;
+  json["n_rows"] = options.n_rows;
+  json["blocks_per_row"] = options.blocks_per_row;
+  json["dtype"] = options.data_type;
+  json["itype"] = options.index_type;
+  json["block_sizes"] = options.block_sizes;
+  json["threads"] = options.threads_counts;
+  json["scaling"] = options.scaling == scaling_mode::strong ? "strong"
+                  : options.scaling == scaling_mode::weak ? "weak" : "none";
+
+  if (options.kernel_filter)
+    json["kernels"] = *options.kernel_filter;
+  if (options.isa)
+    json["isa"] = *options.isa;
+
+  return json;
+}
+
+void apply_baseline_options (benchmark_options &options, const nlohmann::json &baseline)
+{
+  if (!baseline.contains ("options"))
+    {
+      options.source = matrix_source::generator;
+      options.block_sizes.clear ();
+
+      for (auto &item: baseline.items ())
+        if (!item.key ().empty () && std::all_of (item.key ().begin (), item.key ().end (), [] (unsigned char c) { return std::isdigit (c); }))
+          options.block_sizes.push_back (std::stoi (item.key ()));
+
+      std::sort (options.block_sizes.begin (), options.block_sizes.end ());
+      return;
+    }
+
+  const auto &json = baseline["options"];
+
+  options.source = parse_source (json.value ("source", to_string (options.source)));
+  options.input = json.value ("input", options.input);
+  options.n_rows = json.value ("n_rows", options.n_rows);
+  options.blocks_per_row = json.value ("blocks_per_row", options.blocks_per_row);
+  options.data_type = json.value ("dtype", options.data_type);
+  options.index_type = json.value ("itype", options.index_type);
+  options.block_sizes = json.value ("block_sizes", options.block_sizes);
+  options.threads_counts = json.value ("threads", options.threads_counts);
+
+  const std::string scaling = json.value ("scaling", "none");
+  options.scaling = scaling == "strong" ? scaling_mode::strong
+                  : scaling == "weak" ? scaling_mode::weak : scaling_mode::none;
+
+  if (json.contains ("kernels"))
+    options.kernel_filter = json["kernels"].get<std::string> ();
+  if (json.contains ("isa") && !options.isa)
+    options.isa = json["isa"].get<std::string> ();
+}
@@ -0,0 +1,87 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_BENCHMARK_OPTIONS_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_BENCHMARK_OPTIONS_H
+
+#include "measurement_class.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+enum class matrix_source
+{
+  generator, mtx, binary, bridge
+};
+
+enum class scaling_mode
+{
+  none,
+  strong, ///< Fixed matrix, growing threads count
+  weak    ///< Generator rows grow with threads count
+};
+
+/**
+ * @brief Settings of one benchmark run, filled from command line
+ *
+ * Defaults reproduce the original hardcoded run (n-diagonal generator,
+ * float/int, bs 2..32, result.json in working directory).
+ */
+class benchmark_options
+{
+public:
+  matrix_source source = matrix_source::generator;
+  std::string input;                          ///< .mtx file, directory or manifest; binary CSR file
+  std::string output = "result.json";
+  std::string save_binary;                    ///< Store source matrix in binary CSR format before measurements
+
+  unsigned int n_rows = 50'000;               ///< Generator, block rows
+  unsigned int blocks_per_row = 6;            ///< Generator
+
+  std::string data_type = "float";            ///< float or double
+  std::string index_type = "int32";           ///< int32 or int64 (CPU kernels only)
+
+  std::vector<int> block_sizes { 2, 4, 8, 16, 32 };
+  std::vector<unsigned int> threads_counts;   ///< CPU kernels run with each count, hardware concurrency if empty
+  std::optional<std::string> kernel_filter;   ///< ECMAScript regex, matched against kernel names
+
+  bool solve = false;                         ///< Bridge, solve system instead of measuring SpMV
+  std::string solver = "gpu-bicgstab";        ///< Solver of --solve, see get_benchmark_usage
+  std::vector<std::string> preconditioners { "jacobi" }; ///< CPU solvers, system is solved with each of them
+  unsigned int chebyshev_degree = 4;          ///< Degree of chebyshev preconditioner
+  unsigned int load_cases = 1;                ///< Right hand sides of a batched CPU solve, see get_benchmark_usage
+  unsigned int load_steps = 1;                ///< Positions of a moving load solved one after another, see get_benchmark_usage
+  unsigned int recycled = 8;                  ///< Recycled subspace of cg in load steps
+  unsigned int monitor_stride = 0;            ///< Solvers print progress every N iterations, the last one only for 0
+  bool mixed_precision = false;               ///< CPU solvers iterate in float, refined in double, see get_benchmark_usage
+  std::string solver_format = "bcsr";         ///< Matrix format of CPU solvers: csr, bcsr, bcsr-column-major or auto
+  int device = 1;                             ///< CUDA device
+  std::optional<std::string> isa;             ///< CPU kernels instruction set level, detected if not set
+
+  scaling_mode scaling = scaling_mode::none;  ///< Measure only threaded CPU kernels for each threads count
+
+  std::string baseline;                       ///< Results file to rerun and compare against
+  double regression_threshold = 0.05;         ///< Relative slowdown that fails comparison
+
+  measurement_settings settings;
+};
+
+/// Throws std::runtime_error on invalid arguments. Returns nullopt if help was requested.
+std::optional<benchmark_options> parse_benchmark_options (int argc, char *argv[]);
+
+std::string get_benchmark_usage (const std::string &program);
+
+/// Configuration part of options (what is measured, not how), stored in results file
+nlohmann::json benchmark_options_to_json (const benchmark_options &options);
+
+/**
+ * @brief Take configuration from baseline results file so that the same cases are rerun
+ *
+ * Files without stored options (written before the command line driver) are
+ * generator runs with block sizes as top level keys.
+ */
+void apply_baseline_options (benchmark_options &options, const nlohmann::json &baseline);
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_BENCHMARK_OPTIONS_H
@@ -0,0 +1,33 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cache_directory.h"
+
+#include <cstdlib>
+
+#include <unistd.h>
+
+std::filesystem::path get_cache_directory ()
+{
+  const char *xdg_cache = std::getenv ("XDG_CACHE_HOME");
+  const char *home = std::getenv ("HOME");
+
+  std::filesystem::path root = xdg_cache ? std::filesystem::path (xdg_cache)
+                             : home      ? std::filesystem::path (home) / ".cache"
+                                         : std::filesystem::temp_directory_path ();
+
+  const auto path = root / "block_matrix_format_performance";
+
+  std::error_code error;
+  std::filesystem::create_directories (path, error);
+
+  return path;
+}
+
+std::string get_host_name ()
+{
+  char buffer[256] {};
+  gethostname (buffer, sizeof (buffer) - 1);
+  return buffer;
+}
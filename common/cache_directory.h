@@ -0,0 +1,16 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CACHE_DIRECTORY_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CACHE_DIRECTORY_H
+
+#include <filesystem>
+#include <string>
+
+/// $XDG_CACHE_HOME (or ~/.cache)/block_matrix_format_performance, created on demand
+std::filesystem::path get_cache_directory ();
+
+std::string get_host_name ();
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CACHE_DIRECTORY_H
@@ -0,0 +1,188 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "machine_limits.h"
+#include "cache_directory.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <numeric>
+
+namespace
+{
+
+/// Best of several STREAM triad runs, GB/s
+double stream_triad (thread_pool &pool, size_t n)
+{
+  std::unique_ptr<double[]> a (new double[n]);
+  std::unique_ptr<double[]> b (new double[n]);
+  std::unique_ptr<double[]> c (new double[n]);
+
+  /// First touch from the same threads that run triad places pages on their nodes
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    auto [begin, end] = thread_range (n, thread_id, threads_count);
+    std::fill (a.get () + begin, a.get () + end, 1.0);
+    std::fill (b.get () + begin, b.get () + end, 2.0);
+    std::fill (c.get () + begin, c.get () + end, 0.5);
+  });
+
+  const double scalar = 3.0;
+  double best = 0.0;
+
+  for (unsigned int repeat = 0; repeat < 10; repeat++)
+    {
+      auto begin_time = std::chrono::steady_clock::now ();
+
+      pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+        auto [begin, end] = thread_range (n, thread_id, threads_count);
+        double * __restrict__ a_ptr = a.get ();
+        const double * __restrict__ b_ptr = b.get ();
+        const double * __restrict__ c_ptr = c.get ();
+
+        for (size_t i = begin; i < end; i++)
+          a_ptr[i] = b_ptr[i] + scalar * c_ptr[i];
+      });
+
+      auto end_time = std::chrono::steady_clock::now ();
+      const double elapsed = std::chrono::duration<double> (end_time - begin_time).count ();
+
+      best = std::max (best, 3 * n * sizeof (double) / elapsed / 1E+9);
+    }
+
+  return best;
+}
+
+/// FMA throughput of all threads, GFLOP/s
+double peak_flops (thread_pool &pool, const std::function<double (unsigned long long)> &kernel)
+{
+  const unsigned long long iterations = 1 << 22;
+  std::vector<double> operations (pool.size ());
+
+  /// Warm up, so that clock of vector units is settled
+  pool.run ([&] (unsigned int thread_id, unsigned int) {
+    operations[thread_id] = kernel (iterations / 16);
+  });
+
+  auto begin_time = std::chrono::steady_clock::now ();
+
+  pool.run ([&] (unsigned int thread_id, unsigned int) {
+    operations[thread_id] = kernel (iterations);
+  });
+
+  auto end_time = std::chrono::steady_clock::now ();
+  const double elapsed = std::chrono::duration<double> (end_time - begin_time).count ();
+
+  return std::accumulate (operations.begin (), operations.end (), 0.0) / elapsed / 1E+9;
+}
+
+}
+
+double machine_limits::get_attainable_gflops (double arithmetic_intensity, bool double_precision) const
+{
+  return std::min (get_peak_gflops (double_precision), arithmetic_intensity * bandwidth);
+}
+
+nlohmann::json machine_limits::get_roofline (const measurement_class &measurement, bool double_precision) const
+{
+  nlohmann::json json;
+
+  if (measurement.get_load_store_bytes () <= 0.0 || measurement.get_operations_count () <= 0.0)
+    return json;
+
+  const double arithmetic_intensity = measurement.get_arithmetic_intensity ();
+  const double attainable = get_attainable_gflops (arithmetic_intensity, double_precision);
+
+  json["arithmetic_intensity"] = arithmetic_intensity;
+  json["bandwidth_fraction"] = measurement.get_effective_bandwidth () / bandwidth;
+  json["attainable_gflops"] = attainable;
+  json["performance_fraction"] = measurement.get_computational_throughput () / attainable;
+
+  return json;
+}
+
+nlohmann::json machine_limits::to_json () const
+{
+  nlohmann::json json;
+
+  json["host"] = host;
+  json["threads"] = threads_count;
+  json["bandwidth"] = bandwidth;
+  json["numa_node_bandwidth"] = numa_node_bandwidth;
+  json["isa"] = isa;
+  json["peak_gflops_float"] = peak_gflops_float;
+  json["peak_gflops_double"] = peak_gflops_double;
+
+  return json;
+}
+
+machine_limits machine_limits::from_json (const nlohmann::json &json)
+{
+  machine_limits limits;
+
+  limits.host = json.at ("host").get<std::string> ();
+  limits.threads_count = json.at ("threads").get<unsigned int> ();
+  limits.bandwidth = json.at ("bandwidth").get<double> ();
+  limits.numa_node_bandwidth = json.at ("numa_node_bandwidth").get<std::vector<double>> ();
+  limits.isa = json.at ("isa").get<std::string> ();
+  limits.peak_gflops_float = json.at ("peak_gflops_float").get<double> ();
+  limits.peak_gflops_double = json.at ("peak_gflops_double").get<double> ();
+
+  return limits;
+}
+
+machine_limits machine_limits::measure (unsigned int threads_count, const peak_kernels &kernels, size_t elements_count)
+{
+  machine_limits limits;
+  limits.host = get_host_name ();
+  limits.threads_count = threads_count;
+  limits.isa = kernels.isa;
+
+  {
+    thread_pool pool (threads_count);
+    limits.bandwidth = stream_triad (pool, elements_count);
+    limits.peak_gflops_float = peak_flops (pool, kernels.float_kernel);
+    limits.peak_gflops_double = peak_flops (pool, kernels.double_kernel);
+  }
+
+  for (auto &node_cpus: thread_pool::get_numa_nodes ())
+    {
+      thread_pool node_pool (node_cpus.size (), node_cpus);
+      limits.numa_node_bandwidth.push_back (stream_triad (node_pool, elements_count));
+    }
+
+  return limits;
+}
+
+machine_limits machine_limits::load_or_measure (unsigned int threads_count, const peak_kernels &kernels)
+{
+  const auto path = get_cache_directory () / (get_host_name () + ".json");
+
+  {
+    std::ifstream is (path);
+
+    if (is)
+      {
+        try
+          {
+            auto limits = from_json (nlohmann::json::parse (is));
+            if (limits.threads_count == threads_count && limits.isa == kernels.isa)
+              return limits;
+          }
+        catch (const nlohmann::json::exception &)
+          {
+            /// Broken cache is just remeasured
+          }
+      }
+  }
+
+  auto limits = measure (threads_count, kernels);
+
+  std::ofstream os (path);
+  os << limits.to_json ().dump (2) << std::endl;
+
+  return limits;
+}
@@ -0,0 +1,73 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_MACHINE_LIMITS_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_MACHINE_LIMITS_H
+
+#include "measurement_class.h"
+#include "json.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Attainable memory bandwidth and FLOP rate of the host
+ *
+ * Bandwidth is measured with multithreaded STREAM triad (a = b + s * c, 24 bytes per element,
+ * write allocate isn't counted), once with all cpus and once per NUMA node with threads
+ * pinned to the node. Peak is measured in float and in double with independent FMA chains
+ * of the instruction set level kernels use, so roofline of a kernel is the one of its data type.
+ */
+class machine_limits
+{
+public:
+  std::string host;
+  unsigned int threads_count {};
+
+  double bandwidth {};                      ///< GB/s, all cpus
+  std::vector<double> numa_node_bandwidth;  ///< GB/s, threads pinned to each node
+  std::string isa;                          ///< Instruction set level of peak kernels
+  double peak_gflops_float {};              ///< Single precision GFLOP/s, all cpus
+  double peak_gflops_double {};             ///< Double precision GFLOP/s, all cpus
+
+  /**
+   * @brief Peak FLOP rate probes of instruction set level, supplied by CPU kernels (see cpu_spmv_functions::peak)
+   *
+   * Probe runs in one thread and returns operations count of iterations.
+   */
+  class peak_kernels
+  {
+  public:
+    std::string isa;
+    std::function<double (unsigned long long iterations)> float_kernel;
+    std::function<double (unsigned long long iterations)> double_kernel;
+  };
+
+  double get_peak_gflops (bool double_precision) const { return double_precision ? peak_gflops_double : peak_gflops_float; }
+
+  /// Arithmetic intensity (FLOP/byte) where kernel stops being memory bound
+  double get_ridge_point (bool double_precision) const { return get_peak_gflops (double_precision) / bandwidth; }
+
+  /// min (peak, AI * BW) in GFLOP/s
+  double get_attainable_gflops (double arithmetic_intensity, bool double_precision) const;
+
+  /// Roofline position of measured kernel, empty if kernel didn't report bytes and operations
+  nlohmann::json get_roofline (const measurement_class &measurement, bool double_precision) const;
+
+  nlohmann::json to_json () const;
+  static machine_limits from_json (const nlohmann::json &json);
+
+  static machine_limits measure (unsigned int threads_count, const peak_kernels &kernels, size_t elements_count = 1 << 25);
+
+  /**
+   * @brief Load limits of this host from cache or measure and store them
+   *
+   * Cache lives in $XDG_CACHE_HOME (or ~/.cache)/block_matrix_format_performance/<host>.json,
+   * it's remeasured if threads count or instruction set level of kernels differ.
+   */
+  static machine_limits load_or_measure (unsigned int threads_count, const peak_kernels &kernels);
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_MACHINE_LIMITS_H
@@ -8,7 +8,15 @@
 #include "mmio.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <limits>
+#include <tuple>
+#include <string>
+#include <type_traits>
 #include <memory>
+#include <vector>
 
 template <typename data_type, typename index_type>
 class bcsr_matrix_class
@@ -81,10 +89,26 @@ public:
   const std::unique_ptr<index_type[]> row_ptr;
 };
 
+/// "CSRBIN01", first word of binary CSR files
+constexpr std::uint64_t csr_binary_magic = 0x31304e4942525343;
+
 template <typename data_type, typename index_type>
 class csr_matrix_class
 {
 public:
+  csr_matrix_class (
+    index_type n_rows_arg,
+    index_type n_cols_arg,
+    index_type nnz_arg)
+    : n_rows (n_rows_arg)
+    , n_cols (n_cols_arg)
+    , nnz (nnz_arg)
+    , values (new data_type[nnz])
+    , columns (new index_type[nnz])
+    , row_ptr (new index_type[n_rows + 1])
+  {
+  }
+
   explicit csr_matrix_class (const bcsr_matrix_class<data_type, index_type> &matrix)
     : n_rows (matrix.n_rows * matrix.bs)
     , n_cols (matrix.n_cols * matrix.bs)
@@ -143,6 +167,24 @@ public:
     fclose (fp);
   }
 
+  /// See read_csr_binary
+  void write_binary (const std::string &filename) const
+  {
+    std::ofstream os (filename, std::ios::binary);
+
+    if (!os)
+      throw std::runtime_error ("Error! Can't open " + filename);
+
+    const std::uint64_t header[] = {
+      csr_binary_magic, sizeof (index_type), sizeof (data_type),
+      static_cast<std::uint64_t> (n_rows), static_cast<std::uint64_t> (n_cols), static_cast<std::uint64_t> (nnz) };
+
+    os.write (reinterpret_cast<const char *> (header), sizeof (header));
+    os.write (reinterpret_cast<const char *> (row_ptr.get ()), (n_rows + 1) * sizeof (index_type));
+    os.write (reinterpret_cast<const char *> (columns.get ()), nnz * sizeof (index_type));
+    os.write (reinterpret_cast<const char *> (values.get ()), nnz * sizeof (data_type));
+  }
+
 public:
   const index_type n_rows {};
   const index_type n_cols {};
@@ -173,7 +215,7 @@ std::unique_ptr<bcsr_matrix_class<data_type, index_type>> gen_n_diag_bcsr (
     {
       row_ptr[row] = row * blocks_per_row;
 
-      const index_type first_column = [&] () {
+      const index_type first_column = [&] () -> index_type {
         if (row < blocks_per_row / 2)
           return 0;
         if (row > n_rows_arg - blocks_per_row)
@@ -195,4 +237,419 @@ std::unique_ptr<bcsr_matrix_class<data_type, index_type>> gen_n_diag_bcsr (
   return matrix;
 }
 
+/**
+ * @brief Read coordinate Matrix Market file (SuiteSparse collection format) into CSR
+ *
+ * Symmetric and skew-symmetric matrices are expanded into general form, pattern
+ * matrices get unit values. Duplicate entries are kept as is.
+ */
+template <typename data_type, typename index_type>
+std::unique_ptr<csr_matrix_class<data_type, index_type>> read_csr_mm (const std::string &filename)
+{
+  FILE *fp = fopen (filename.c_str (), "r");
+
+  if (!fp)
+    throw std::runtime_error ("Error! Can't open " + filename);
+
+  MM_typecode matcode;
+  int n_rows_arg {};
+  int n_cols_arg {};
+  int file_nnz {};
+
+  if (mm_read_banner (fp, &matcode) != 0
+   || !mm_is_coordinate (matcode)
+   || mm_is_complex (matcode)
+   || mm_read_mtx_crd_size (fp, &n_rows_arg, &n_cols_arg, &file_nnz) != 0)
+    {
+      fclose (fp);
+      throw std::runtime_error ("Error! Unsupported matrix market file " + filename);
+    }
+
+  if (n_rows_arg < 0 || n_cols_arg < 0 || file_nnz < 0)
+    {
+      fclose (fp);
+      throw std::runtime_error ("Error! Negative size in matrix market file " + filename);
+    }
+
+  const bool is_symmetric = mm_is_symmetric (matcode) || mm_is_skew (matcode);
+  const data_type mirror_sign = mm_is_skew (matcode) ? -1.0 : 1.0;
+
+  std::vector<index_type> rows;
+  std::vector<index_type> cols;
+  std::vector<data_type> vals;
+
+  rows.reserve ((is_symmetric ? 2 : 1) * static_cast<std::size_t> (file_nnz));
+  cols.reserve (rows.capacity ());
+  vals.reserve (rows.capacity ());
+
+  for (int element = 0; element < file_nnz; element++)
+    {
+      int row {};
+      int col {};
+      double value = 1.0;
+
+      const int read_count = mm_is_pattern (matcode)
+                           ? fscanf (fp, "%d %d", &row, &col)
+                           : fscanf (fp, "%d %d %lg", &row, &col, &value) - 1;
+
+      if (read_count != 2)
+        {
+          fclose (fp);
+          throw std::runtime_error ("Error! Premature end of file " + filename);
+        }
+
+      if (row < 1 || row > n_rows_arg || col < 1 || col > n_cols_arg)
+        {
+          fclose (fp);
+          throw std::runtime_error ("Error! Index (" + std::to_string (row) + ", " + std::to_string (col)
+                                    + ") out of range in " + filename);
+        }
+
+      /// Matrix market files use 1-based indices
+      rows.push_back (row - 1);
+      cols.push_back (col - 1);
+      vals.push_back (value);
+
+      if (is_symmetric && row != col)
+        {
+          rows.push_back (col - 1);
+          cols.push_back (row - 1);
+          vals.push_back (mirror_sign * value);
+        }
+    }
+
+  fclose (fp);
+
+  /// Symmetric expansion might double nnz of file
+  if (vals.size () > static_cast<std::size_t> (std::numeric_limits<index_type>::max ()))
+    throw std::runtime_error ("Error! Number of nonzeros " + std::to_string (vals.size ())
+                              + " exceeds index type range in " + filename);
+
+  std::unique_ptr<csr_matrix_class<data_type, index_type>> matrix (
+    new csr_matrix_class<data_type, index_type> (n_rows_arg, n_cols_arg, static_cast<index_type> (vals.size ())));
+
+  auto row_ptr = matrix->row_ptr.get ();
+  auto columns = matrix->columns.get ();
+  auto values = matrix->values.get ();
+
+  std::fill_n (row_ptr, matrix->n_rows + 1, 0);
+  for (auto &row: rows)
+    row_ptr[row + 1]++;
+  for (index_type row = 0; row < matrix->n_rows; row++)
+    row_ptr[row + 1] += row_ptr[row];
+
+  std::vector<index_type> count (row_ptr, row_ptr + matrix->n_rows);
+  for (size_t element = 0; element < vals.size (); element++)
+    {
+      const index_type offset = count[rows[element]]++;
+      columns[offset] = cols[element];
+      values[offset] = vals[element];
+    }
+
+  std::vector<std::pair<index_type, data_type>> row_buffer;
+  for (index_type row = 0; row < matrix->n_rows; row++)
+    {
+      row_buffer.clear ();
+      for (index_type element = row_ptr[row]; element < row_ptr[row + 1]; element++)
+        row_buffer.emplace_back (columns[element], values[element]);
+
+      std::sort (row_buffer.begin (), row_buffer.end (), [] (const auto &a, const auto &b) { return a.first < b.first; });
+
+      for (size_t i = 0; i < row_buffer.size (); i++)
+        std::tie (columns[row_ptr[row] + i], values[row_ptr[row] + i]) = row_buffer[i];
+    }
+
+  return matrix;
+}
+
+namespace detail
+{
+template <typename target_type, typename source_type>
+void read_binary_array (std::istream &is, target_type *target, std::uint64_t size)
+{
+  if constexpr (std::is_same_v<target_type, source_type>)
+    {
+      is.read (reinterpret_cast<char *> (target), size * sizeof (target_type));
+    }
+  else
+    {
+      std::vector<source_type> buffer (size);
+      is.read (reinterpret_cast<char *> (buffer.data ()), size * sizeof (source_type));
+      std::copy (buffer.begin (), buffer.end (), target);
+    }
+}
+
+template <typename target_type>
+void read_binary_array (std::istream &is, target_type *target, std::uint64_t size, std::uint64_t stored_size, bool is_integer)
+{
+  if (is_integer && stored_size == 4)
+    read_binary_array<target_type, std::int32_t> (is, target, size);
+  else if (is_integer && stored_size == 8)
+    read_binary_array<target_type, std::int64_t> (is, target, size);
+  else if (!is_integer && stored_size == 4)
+    read_binary_array<target_type, float> (is, target, size);
+  else if (!is_integer && stored_size == 8)
+    read_binary_array<target_type, double> (is, target, size);
+  else
+    throw std::runtime_error ("Error! Unsupported element size in binary matrix");
+}
+}
+
+/**
+ * @brief Read CSR matrix written by csr_matrix_class::write_binary
+ *
+ * Layout: six little endian uint64 (magic, index size, value size, n_rows,
+ * n_cols, nnz) followed by row_ptr, columns and values arrays. Files written
+ * with other index/value types are converted on read, so a matrix converted
+ * once from Matrix Market loads in a fraction of parsing time.
+ */
+template <typename data_type, typename index_type>
+std::unique_ptr<csr_matrix_class<data_type, index_type>> read_csr_binary (const std::string &filename)
+{
+  std::ifstream is (filename, std::ios::binary);
+
+  if (!is)
+    throw std::runtime_error ("Error! Can't open " + filename);
+
+  std::uint64_t header[6] {};
+  is.read (reinterpret_cast<char *> (header), sizeof (header));
+
+  if (!is || header[0] != csr_binary_magic)
+    throw std::runtime_error ("Error! Not a binary CSR file " + filename);
+
+  const std::uint64_t index_size = header[1];
+  const std::uint64_t value_size = header[2];
+  const std::uint64_t n_rows = header[3];
+  const std::uint64_t nnz = header[5];
+
+  if (std::max (n_rows, nnz) > static_cast<std::uint64_t> (std::numeric_limits<index_type>::max ()))
+    throw std::runtime_error ("Error! Matrix " + filename + " doesn't fit into index type");
+
+  std::unique_ptr<csr_matrix_class<data_type, index_type>> matrix (
+    new csr_matrix_class<data_type, index_type> (n_rows, header[4], nnz));
+
+  detail::read_binary_array (is, matrix->row_ptr.get (), n_rows + 1, index_size, true);
+  detail::read_binary_array (is, matrix->columns.get (), nnz, index_size, true);
+  detail::read_binary_array (is, matrix->values.get (), nnz, value_size, false);
+
+  if (!is)
+    throw std::runtime_error ("Error! Premature end of file " + filename);
+
+  return matrix;
+}
+
+/**
+ * @brief Split CSR matrix into bs x bs blocks (row major), padding the last block row/column with zeroes
+ */
+template <typename data_type, typename index_type>
+std::unique_ptr<bcsr_matrix_class<data_type, index_type>> csr_to_bcsr (
+  const csr_matrix_class<data_type, index_type> &matrix,
+  index_type bs)
+{
+  const index_type n_block_rows = (matrix.n_rows + bs - 1) / bs;
+  const index_type n_block_cols = (matrix.n_cols + bs - 1) / bs;
+
+  std::unique_ptr<index_type[]> block_row_ptr (new index_type[n_block_rows + 1]);
+  std::vector<index_type> last_block_row (n_block_cols, -1); ///< Last block row that referenced block column
+
+  block_row_ptr[0] = 0;
+  for (index_type block_row = 0; block_row < n_block_rows; block_row++)
+    {
+      index_type blocks_in_row = 0;
+      const index_type last_row = std::min ((block_row + 1) * bs, matrix.n_rows);
+
+      for (index_type row = block_row * bs; row < last_row; row++)
+        {
+          for (index_type element = matrix.row_ptr[row]; element < matrix.row_ptr[row + 1]; element++)
+            {
+              const index_type block_col = matrix.columns[element] / bs;
+              if (last_block_row[block_col] != block_row)
+                {
+                  last_block_row[block_col] = block_row;
+                  blocks_in_row++;
+                }
+            }
+        }
+
+      block_row_ptr[block_row + 1] = block_row_ptr[block_row] + blocks_in_row;
+    }
+
+  std::unique_ptr<bcsr_matrix_class<data_type, index_type>> block_matrix (
+    new bcsr_matrix_class<data_type, index_type> (
+      n_block_rows, n_block_cols, bs, block_row_ptr[n_block_rows]));
+
+  auto row_ptr = block_matrix->row_ptr.get ();
+  auto columns = block_matrix->columns.get ();
+  auto values = block_matrix->values.get ();
+
+  std::copy_n (block_row_ptr.get (), n_block_rows + 1, row_ptr);
+  std::fill_n (values, block_matrix->size (), 0.0);
+  std::fill (last_block_row.begin (), last_block_row.end (), -1);
+
+  for (index_type block_row = 0; block_row < n_block_rows; block_row++)
+    {
+      index_type offset = row_ptr[block_row];
+      const index_type last_row = std::min ((block_row + 1) * bs, matrix.n_rows);
+
+      for (index_type row = block_row * bs; row < last_row; row++)
+        {
+          for (index_type element = matrix.row_ptr[row]; element < matrix.row_ptr[row + 1]; element++)
+            {
+              const index_type block_col = matrix.columns[element] / bs;
+              if (last_block_row[block_col] != block_row)
+                {
+                  last_block_row[block_col] = block_row;
+                  columns[offset++] = block_col;
+                }
+            }
+        }
+
+      std::sort (columns + row_ptr[block_row], columns + row_ptr[block_row + 1]);
+
+      for (index_type row = block_row * bs; row < last_row; row++)
+        {
+          for (index_type element = matrix.row_ptr[row]; element < matrix.row_ptr[row + 1]; element++)
+            {
+              const index_type col = matrix.columns[element];
+              data_type *block_data = block_matrix->get_block_data_by_column (block_row, col / bs);
+              block_data[(row % bs) * bs + col % bs] += matrix.values[element];
+            }
+        }
+    }
+
+  return block_matrix;
+}
+
+/// Copy of matrix with values of target_type, e.g. float copy of double matrix for mixed precision solvers
+template <typename target_type, typename data_type, typename index_type>
+std::unique_ptr<bcsr_matrix_class<target_type, index_type>> convert_values (const bcsr_matrix_class<data_type, index_type> &matrix)
+{
+  std::unique_ptr<bcsr_matrix_class<target_type, index_type>> result (
+    new bcsr_matrix_class<target_type, index_type> (matrix.n_rows, matrix.n_cols, matrix.bs, matrix.nnzb));
+
+  std::copy_n (matrix.row_ptr.get (), matrix.n_rows + 1, result->row_ptr.get ());
+  std::copy_n (matrix.columns.get (), matrix.nnzb, result->columns.get ());
+  std::transform (matrix.values.get (), matrix.values.get () + matrix.size (), result->values.get (),
+                  [] (data_type value) { return static_cast<target_type> (value); });
+
+  return result;
+}
+
+template <typename target_type, typename data_type, typename index_type>
+std::unique_ptr<csr_matrix_class<target_type, index_type>> convert_values (const csr_matrix_class<data_type, index_type> &matrix)
+{
+  std::unique_ptr<csr_matrix_class<target_type, index_type>> result (
+    new csr_matrix_class<target_type, index_type> (matrix.n_rows, matrix.n_cols, matrix.nnz));
+
+  std::copy_n (matrix.row_ptr.get (), matrix.n_rows + 1, result->row_ptr.get ());
+  std::copy_n (matrix.columns.get (), matrix.nnz, result->columns.get ());
+  std::transform (matrix.values.get (), matrix.values.get () + matrix.nnz, result->values.get (),
+                  [] (data_type value) { return static_cast<target_type> (value); });
+
+  return result;
+}
+
+/**
+ * @brief BCSR with blocks of slice_width consecutive block rows interleaved (sliced ELLPACK of blocks)
+ *
+ * Block rows are grouped into slices of slice_width rows, every row of a slice
+ * is padded with zero blocks to the longest row of the slice. Element (r, c)
+ * of k-th block of slice rows is stored for all rows (lanes) contiguously:
+ *
+ *   columns[slice_ptr[slice] + k * slice_width + lane]
+ *   values[(slice_ptr[slice] + k * slice_width) * bs * bs + (r * bs + c) * slice_width + lane]
+ *
+ * so that kernels process slice_width block rows in SIMD lanes. Padding
+ * blocks repeat the last column of their row to keep x reads in cache. Rows
+ * of the last slice past n_rows are padding as well.
+ */
+template <typename data_type, typename index_type>
+class sliced_bcsr_matrix_class
+{
+public:
+  sliced_bcsr_matrix_class (
+    const bcsr_matrix_class<data_type, index_type> &matrix,
+    index_type slice_width_arg)
+    : n_rows (matrix.n_rows)
+    , n_cols (matrix.n_cols)
+    , bs (matrix.bs)
+    , nnzb (matrix.nnzb)
+    , slice_width (slice_width_arg)
+    , n_slices ((matrix.n_rows + slice_width_arg - 1) / slice_width_arg)
+    , slice_ptr (new index_type[n_slices + 1])
+  {
+    auto get_row_length = [&] (index_type row) -> index_type {
+      return row < n_rows ? matrix.row_ptr[row + 1] - matrix.row_ptr[row] : 0;
+    };
+
+    slice_ptr[0] = 0;
+    for (index_type slice = 0; slice < n_slices; slice++)
+      {
+        index_type slice_length = 0;
+        for (index_type lane = 0; lane < slice_width; lane++)
+          slice_length = std::max (slice_length, get_row_length (slice * slice_width + lane));
+        slice_ptr[slice + 1] = slice_ptr[slice] + slice_length * slice_width;
+      }
+
+    padded_nnzb = slice_ptr[n_slices];
+    values.reset (new data_type[size ()]);
+    columns.reset (new index_type[padded_nnzb]);
+
+    std::fill_n (values.get (), size (), data_type {});
+
+    const index_type block_size = bs * bs;
+
+    for (index_type slice = 0; slice < n_slices; slice++)
+      {
+        const index_type slice_length = (slice_ptr[slice + 1] - slice_ptr[slice]) / slice_width;
+
+        for (index_type lane = 0; lane < slice_width; lane++)
+          {
+            const index_type row = slice * slice_width + lane;
+            const index_type row_length = get_row_length (row);
+
+            for (index_type k = 0; k < slice_length; k++)
+              {
+                const index_type slot = slice_ptr[slice] + k * slice_width;
+
+                if (k >= row_length)
+                  {
+                    columns[slot + lane] = row_length > 0 ? matrix.columns[matrix.row_ptr[row] + row_length - 1] : 0;
+                    continue;
+                  }
+
+                const index_type block = matrix.row_ptr[row] + k;
+                const data_type *block_data = matrix.values.get () + block * block_size;
+                data_type *slot_data = values.get () + slot * block_size;
+
+                columns[slot + lane] = matrix.columns[block];
+                for (index_type element = 0; element < block_size; element++)
+                  slot_data[element * slice_width + lane] = block_data[element];
+              }
+          }
+      }
+  }
+
+  /// Number of stored values, including padding
+  index_type size () const
+  {
+    return padded_nnzb * bs * bs;
+  }
+
+public:
+  const index_type n_rows {};
+  const index_type n_cols {};
+
+  const index_type bs {};
+  const index_type nnzb {};         ///< Blocks of source matrix
+  index_type padded_nnzb {};        ///< Stored blocks
+
+  const index_type slice_width {};
+  const index_type n_slices {};
+
+  std::unique_ptr<data_type[]> values;
+  std::unique_ptr<index_type[]> columns;
+  const std::unique_ptr<index_type[]> slice_ptr;  ///< First stored block of each slice
+};
+
 #endif //BLOCK_MATRIX_FORMAT_PERFORMANCE_MATRIX_CONVERTERS_H
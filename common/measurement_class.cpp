@@ -4,13 +4,148 @@
 
 #include "measurement_class.h"
 
+#include <algorithm>
+#include <cmath>
+
 measurement_class::measurement_class (
   std::string format,
   double elapsed_arg,
-  double load_store_bytes,
-  double operations_count)
+  double load_store_bytes_arg,
+  double operations_count_arg)
   : elapsed (elapsed_arg)
-  , effective_bandwidth (load_store_bytes / (elapsed * giga))
-  , computational_throughput (operations_count / (elapsed * giga))
+  , effective_bandwidth (load_store_bytes_arg / (elapsed * giga))
+  , computational_throughput (operations_count_arg / (elapsed * giga))
   , matrix_format (move (format))
+  , load_store_bytes (load_store_bytes_arg)
+  , operations_count (operations_count_arg)
+  , samples (1, elapsed_arg)
+  , mean (elapsed_arg)
+  , min (elapsed_arg)
+  , p95 (elapsed_arg)
 { }
+
+static double percentile (const std::vector<double> &sorted, double p)
+{
+  const double position = p * (sorted.size () - 1);
+  const size_t lower = std::floor (position);
+  const size_t upper = std::ceil (position);
+
+  return sorted[lower] + (sorted[upper] - sorted[lower]) * (position - lower);
+}
+
+double student_t_95 (size_t df)
+{
+  const double table[] = { 12.71, 4.303, 3.182 };
+
+  if (df == 0)
+    return 0.0;
+  if (df <= 3)
+    return table[df - 1];
+  return 1.96 + 2.4 / df;
+}
+
+void measurement_class::finalize ()
+{
+  if (samples.empty ())
+    return;
+
+  std::vector<double> sorted = samples;
+  std::sort (sorted.begin (), sorted.end ());
+  min = sorted.front ();
+
+  const double q1 = percentile (sorted, 0.25);
+  const double q3 = percentile (sorted, 0.75);
+  const double iqr = q3 - q1;
+
+  std::vector<double> accepted;
+  std::copy_if (sorted.begin (), sorted.end (), std::back_inserter (accepted), [&] (double sample) {
+    return sample >= q1 - 1.5 * iqr && sample <= q3 + 1.5 * iqr;
+  });
+  outliers_count = sorted.size () - accepted.size ();
+
+  elapsed = percentile (accepted, 0.5);
+  p95 = percentile (accepted, 0.95);
+
+  mean = 0.0;
+  for (auto &sample: accepted)
+    mean += sample;
+  mean /= accepted.size ();
+
+  double variance = 0.0;
+  for (auto &sample: accepted)
+    variance += (sample - mean) * (sample - mean);
+  stddev = accepted.size () > 1 ? std::sqrt (variance / (accepted.size () - 1)) : 0.0;
+  ci_half_width = accepted.size () > 1 ? student_t_95 (accepted.size () - 1) * stddev / std::sqrt (accepted.size ()) : 0.0;
+
+  effective_bandwidth = load_store_bytes / (elapsed * giga);
+  computational_throughput = operations_count / (elapsed * giga);
+
+  for (auto &counter: counters_sum)
+    counters[counter.first] = counter.second / samples.size ();
+}
+
+nlohmann::json measurement_class::to_json () const
+{
+  nlohmann::json json;
+
+  json["elapsed"] = elapsed;
+  json["mean"] = mean;
+  json["min"] = min;
+  json["p95"] = p95;
+  json["stddev"] = stddev;
+  json["ci95"] = ci_half_width;
+  json["samples"] = samples.size ();
+  json["outliers"] = outliers_count;
+  json["bandwidth"] = effective_bandwidth;
+  json["throughput"] = computational_throughput;
+
+  if (!counters.empty ())
+    json["counters"] = counters;
+
+  return json;
+}
+
+std::vector<measurement_class> measure_multiple_times (
+  const std::function<std::vector<measurement_class> (bool)> &action,
+  const measurement_settings &settings)
+{
+  for (unsigned int warmup_id = 0; warmup_id < settings.warmup_count; warmup_id++)
+    action (true);
+
+  std::vector<measurement_class> results = action (false);
+
+  for (unsigned int measurement_id = 1; measurement_id < settings.max_count; measurement_id++)
+    {
+      if (measurement_id >= settings.min_count)
+        {
+          bool converged = true;
+          for (auto &result: results)
+            {
+              result.finalize ();
+              if (result.get_ci_half_width () > settings.target_relative_ci * result.get_mean ())
+                converged = false;
+            }
+
+          if (converged)
+            break;
+        }
+
+      auto new_results = action (false);
+      for (unsigned int i = 0; i < results.size (); i++)
+        results[i] += new_results[i];
+    }
+
+  for (auto &result: results)
+    result.finalize ();
+
+  return results;
+}
+
+measurement_class measure_multiple_times (
+  const std::function<measurement_class (bool)> &action,
+  const measurement_settings &settings)
+{
+  return measure_multiple_times (
+    [&] (bool warmup) { return std::vector<measurement_class> { action (warmup) }; },
+    settings).front ();
+}
@@ -5,8 +5,13 @@
 #ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_MEASUREMENT_CLASS_H
 #define BLOCK_MATRIX_FORMAT_PERFORMANCE_MEASUREMENT_CLASS_H
 
-#include <string>
+#include "json.hpp"
+
+#include <functional>
 #include <iostream>
+#include <string>
+#include <vector>
+#include <map>
 
 class measurement_class
 {
@@ -20,33 +25,47 @@ public:
     double load_store_bytes,
     double operations_count);
 
-  double get_elapsed () const { return elapsed; }
+  double get_elapsed () const { return elapsed; } ///< Median of accepted samples after finalize
   double get_effective_bandwidth () const { return effective_bandwidth; }
   double get_computational_throughput () const { return computational_throughput; }
+  double get_load_store_bytes () const { return load_store_bytes; }
+  double get_operations_count () const { return operations_count; }
+  double get_arithmetic_intensity () const { return operations_count / load_store_bytes; } ///< FLOP/byte
+
+  double get_mean () const { return mean; }
+  double get_min () const { return min; }
+  double get_p95 () const { return p95; }
+  double get_stddev () const { return stddev; }
+  double get_ci_half_width () const { return ci_half_width; } ///< Half width of 95% confidence interval of mean
+  unsigned int get_samples_count () const { return samples.size (); }
+  unsigned int get_outliers_count () const { return outliers_count; }
 
   const std::string &get_format () const { return matrix_format; }
 
+  /// Hardware counters per run (mean over samples after finalize)
+  const std::map<std::string, double> &get_counters () const { return counters; }
+  void set_counters (const std::map<std::string, double> &values) { counters = counters_sum = values; }
+
   measurement_class & operator+=(const measurement_class &rhs)
   {
-    elapsed += rhs.get_elapsed ();
-    effective_bandwidth += rhs.get_effective_bandwidth ();
-    computational_throughput += rhs.get_computational_throughput ();
-
+    samples.insert (samples.end (), rhs.samples.begin (), rhs.samples.end ());
+    for (auto &counter: rhs.counters_sum)
+      counters_sum[counter.first] += counter.second;
+    load_store_bytes = rhs.load_store_bytes;
+    operations_count = rhs.operations_count;
     matrix_format = rhs.get_format ();
-    measurements_count++;
 
     return *this;
   }
 
-  void finalize ()
-  {
-    if (measurements_count)
-      {
-        elapsed /= measurements_count;
-        effective_bandwidth /= measurements_count;
-        computational_throughput /= measurements_count;
-      }
-  }
+  /**
+   * @brief Reject outliers (outside of Tukey fences) and compute statistics of remaining samples
+   *
+   * Bandwidth and throughput are recomputed from the median.
+   */
+  void finalize ();
+
+  nlohmann::json to_json () const;
 
 private:
   double elapsed {};
@@ -54,9 +73,52 @@ private:
   double computational_throughput {};
   std::string matrix_format;
 
-  unsigned int measurements_count {};
+  double load_store_bytes {};
+  double operations_count {};
+
+  std::vector<double> samples;
+
+  std::map<std::string, double> counters_sum;
+  std::map<std::string, double> counters;
+
+  double mean {};
+  double min {};
+  double p95 {};
+  double stddev {};
+  double ci_half_width {};
+  unsigned int outliers_count {};
 };
 
+/// Two-sided 95% Student t quantile, approximated for df > 3
+double student_t_95 (size_t df);
+
+class machine_limits;
+
+class measurement_settings
+{
+public:
+  unsigned int warmup_count = 2;      ///< Runs that are executed but not recorded
+  unsigned int min_count = 10;
+  unsigned int max_count = 200;
+  double target_relative_ci = 0.01;   ///< Stop when 95% CI half width is within this fraction of the mean
+  bool collect_counters = false;      ///< Record hardware counters around CPU kernels (see perf_counters)
+  const machine_limits *limits = nullptr; ///< Report roofline position of kernels if set
+};
+
+/**
+ * @brief Run action until confidence interval of each returned measurement is narrow enough
+ *
+ * Action is called with `true` during warm-up runs. All calls must return
+ * measurements in the same order.
+ */
+std::vector<measurement_class> measure_multiple_times (
+  const std::function<std::vector<measurement_class> (bool)> &action,
+  const measurement_settings &settings = {});
+
+measurement_class measure_multiple_times (
+  const std::function<measurement_class (bool)> &action,
+  const measurement_settings &settings = {});
+
 template <typename data_type>
 void compare_results (unsigned int y_size, const data_type *a, const data_type *b)
 {
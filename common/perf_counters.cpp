@@ -0,0 +1,235 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "perf_counters.h"
+#include "thread_pool.h"
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+
+int perf_event_open (perf_event_attr &attr, pid_t pid, int cpu)
+{
+  return static_cast<int> (syscall (__NR_perf_event_open, &attr, pid, cpu, -1, 0));
+}
+
+perf_event_attr make_attr (std::uint32_t type, std::uint64_t config)
+{
+  perf_event_attr attr {};
+  attr.size = sizeof (perf_event_attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  return attr;
+}
+
+std::string read_line (const std::filesystem::path &path)
+{
+  std::ifstream is (path);
+  std::string line;
+  std::getline (is, line);
+  return line;
+}
+
+/**
+ * @brief Translate sysfs event description ("event=0x04,umask=0x03") into attr.config
+ *
+ * Each term is placed according to its format file ("config:8-15").
+ */
+bool parse_uncore_event (const std::filesystem::path &pmu, const std::string &description, std::uint64_t &config)
+{
+  config = 0;
+
+  std::stringstream terms (description);
+  std::string term;
+
+  while (std::getline (terms, term, ','))
+    {
+      const auto eq = term.find ('=');
+      if (eq == std::string::npos)
+        return false;
+
+      const std::string format = read_line (pmu / "format" / term.substr (0, eq));
+      if (format.rfind ("config:", 0) != 0)
+        return false;
+
+      unsigned int first_bit {};
+      unsigned int last_bit {};
+      const auto dash = format.find ('-');
+
+      first_bit = std::stoul (format.substr (7, dash - 7));
+      last_bit = dash == std::string::npos ? first_bit : std::stoul (format.substr (dash + 1));
+
+      const std::uint64_t value = std::stoull (term.substr (eq + 1), nullptr, 0);
+      const std::uint64_t mask = last_bit - first_bit >= 63 ? ~0ull : ((1ull << (last_bit - first_bit + 1)) - 1);
+      config |= (value & mask) << first_bit;
+    }
+
+  return true;
+}
+
+}
+
+perf_counters::perf_counters (thread_pool *pool)
+{
+  events = open_core_events ();
+
+  if (pool)
+    {
+      std::mutex events_lock;
+
+      pool->run ([&] (unsigned int, unsigned int) {
+        auto worker_events = open_core_events ();
+
+        std::lock_guard guard (events_lock);
+        events.insert (events.end (), worker_events.begin (), worker_events.end ());
+      });
+    }
+
+  open_uncore_events ();
+}
+
+perf_counters::~perf_counters ()
+{
+  for (auto &e: events)
+    close (e.fd);
+}
+
+std::vector<perf_counters::event> perf_counters::open_core_events ()
+{
+  const std::uint64_t llc_read_miss = PERF_COUNT_HW_CACHE_LL
+                                    | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  const std::uint64_t dtlb_read_miss = PERF_COUNT_HW_CACHE_DTLB
+                                     | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                     | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+  const std::pair<const char *, perf_event_attr> core_events[] = {
+    { "cycles",       make_attr (PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES) },
+    { "instructions", make_attr (PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS) },
+    { "llc_misses",   make_attr (PERF_TYPE_HW_CACHE, llc_read_miss) },
+    { "dtlb_misses",  make_attr (PERF_TYPE_HW_CACHE, dtlb_read_miss) },
+  };
+
+  std::vector<event> thread_events;
+
+  for (auto &[name, attr_template]: core_events)
+    {
+      perf_event_attr attr = attr_template;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+
+      const int fd = perf_event_open (attr, 0, -1);
+      if (fd >= 0)
+        thread_events.push_back ({ name, fd, 1.0 });
+    }
+
+  return thread_events;
+}
+
+void perf_counters::open_uncore_events ()
+{
+  namespace fs = std::filesystem;
+
+  const fs::path devices ("/sys/bus/event_source/devices");
+  std::error_code error;
+
+  if (!fs::is_directory (devices, error))
+    return;
+
+  for (auto &pmu: fs::directory_iterator (devices, error))
+    {
+      if (pmu.path ().filename ().string ().rfind ("uncore_imc", 0) != 0)
+        continue;
+
+      const std::string type_line = read_line (pmu.path () / "type");
+      const std::string cpumask_line = read_line (pmu.path () / "cpumask");
+
+      if (type_line.empty () || cpumask_line.empty ())
+        continue;
+
+      const std::uint32_t type = std::stoul (type_line);
+      const int cpu = std::stoi (cpumask_line); ///< First cpu of the socket
+
+      for (auto &[event_name, counter_name]: { std::pair<const char *, const char *> { "cas_count_read", "memory_read_bytes" },
+                                               std::pair<const char *, const char *> { "cas_count_write", "memory_write_bytes" } })
+        {
+          const fs::path event_path = pmu.path () / "events" / event_name;
+          std::uint64_t config {};
+
+          if (!fs::exists (event_path) || !parse_uncore_event (pmu.path (), read_line (event_path), config))
+            continue;
+
+          double scale = 64.0; ///< Bytes per CAS
+          const std::string scale_line = read_line (fs::path (event_path.string () + ".scale"));
+          const std::string unit_line = read_line (fs::path (event_path.string () + ".unit"));
+          if (!scale_line.empty ())
+            scale = std::stod (scale_line) * (unit_line == "MiB" ? 1024.0 * 1024.0 : 1.0);
+
+          perf_event_attr attr = make_attr (type, config);
+          const int fd = perf_event_open (attr, -1, cpu);
+          if (fd >= 0)
+            events.push_back ({ counter_name, fd, scale });
+        }
+    }
+}
+
+void perf_counters::start ()
+{
+  for (auto &e: events)
+    {
+      ioctl (e.fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl (e.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void perf_counters::stop ()
+{
+  for (auto &e: events)
+    ioctl (e.fd, PERF_EVENT_IOC_DISABLE, 0);
+
+  for (auto &e: events)
+    {
+      std::uint64_t data[3] {}; ///< value, time enabled, time running
+      e.value = 0.0;
+
+      if (read (e.fd, data, sizeof (data)) == sizeof (data) && data[2] > 0)
+        e.value = static_cast<double> (data[0]) * data[1] / data[2] * e.scale;
+    }
+}
+
+std::map<std::string, double> perf_counters::get_values () const
+{
+  std::map<std::string, double> values;
+
+  for (auto &e: events)
+    values[e.name] += e.value; ///< Threads and several IMC boxes are summed into one value
+
+  return values;
+}
+
+#else
+
+perf_counters::perf_counters (thread_pool *) {}
+perf_counters::~perf_counters () = default;
+std::vector<perf_counters::event> perf_counters::open_core_events () { return {}; }
+void perf_counters::open_uncore_events () {}
+void perf_counters::start () {}
+void perf_counters::stop () {}
+std::map<std::string, double> perf_counters::get_values () const { return {}; }
+
+#endif
@@ -0,0 +1,62 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_PERF_COUNTERS_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+class thread_pool;
+
+/**
+ * @brief Hardware performance counters of a thread pool (Linux perf_event_open)
+ *
+ * Collects cycles, instructions, LLC read misses and dTLB read misses of the
+ * calling thread and of the workers of pool, summed over threads. Events are
+ * opened by each worker for itself: workers of a pool outlive measurements,
+ * so inherited counters would only get their counts at thread exit. If uncore
+ * IMC PMUs are exposed (Intel server parts) and permissions allow system-wide
+ * counting, DRAM read/write traffic is counted too.
+ * Events that can't be opened are silently skipped, so on other platforms
+ * or with restrictive perf_event_paranoid the object simply reports nothing.
+ */
+class perf_counters
+{
+public:
+  /// Pool should outlive counters, without it only the calling thread is counted
+  explicit perf_counters (thread_pool *pool = nullptr);
+  ~perf_counters ();
+
+  perf_counters (const perf_counters &) = delete;
+  perf_counters &operator= (const perf_counters &) = delete;
+
+  void start ();
+  void stop ();
+
+  bool empty () const { return events.empty (); }
+
+  /// Values of last start/stop interval, scaled for multiplexing
+  std::map<std::string, double> get_values () const;
+
+private:
+  struct event
+  {
+    std::string name;
+    int fd {};
+    double scale {}; ///< Multiplier from raw count to reported unit
+    double value {};
+  };
+
+  /// Events of the calling thread
+  static std::vector<event> open_core_events ();
+  void open_uncore_events ();
+
+private:
+  std::vector<event> events;
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_PERF_COUNTERS_H
@@ -0,0 +1,142 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "regression_check.h"
+#include "measurement_class.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+timing_summary timing_summary::from_json (const nlohmann::json &json)
+{
+  timing_summary summary;
+
+  if (json.is_number ())
+    {
+      summary.elapsed = summary.mean = json.get<double> ();
+      return summary;
+    }
+
+  summary.elapsed = json.at ("elapsed").get<double> ();
+  summary.mean = json.value ("mean", summary.elapsed);
+  summary.stddev = json.value ("stddev", 0.0);
+  summary.count = json.value ("samples", 0u) - json.value ("outliers", 0u);
+
+  return summary;
+}
+
+nlohmann::json kernel_comparison::to_json () const
+{
+  nlohmann::json json;
+
+  json["configuration"] = configuration;
+  json["kernel"] = kernel;
+  json["baseline"] = baseline.elapsed;
+  json["current"] = current.elapsed;
+  json["relative_change"] = relative_change;
+  json["t"] = t_statistic;
+  json["regression"] = regression;
+
+  return json;
+}
+
+namespace
+{
+
+/// Results files mix measurements with matrix description, these are never kernels
+const std::set<std::string> metadata_keys { "machine", "isa", "options", "comparison", "path", "n_rows", "n_cols", "nnz", "nnzb", "fill_ratio" };
+
+bool is_measurement (const nlohmann::json &json)
+{
+  return json.is_number () || (json.is_object () && json.contains ("elapsed"));
+}
+
+/// Variance of mean, 0 for values without statistics
+double mean_variance (const timing_summary &summary)
+{
+  return summary.count > 1 ? summary.stddev * summary.stddev / summary.count : 0.0;
+}
+
+kernel_comparison compare (
+  const std::string &configuration,
+  const std::string &kernel,
+  const nlohmann::json &baseline_json,
+  const nlohmann::json &current_json,
+  double threshold)
+{
+  kernel_comparison result;
+  result.configuration = configuration;
+  result.kernel = kernel;
+  result.baseline = timing_summary::from_json (baseline_json);
+  result.current = timing_summary::from_json (current_json);
+
+  if (result.baseline.elapsed <= 0.0)
+    return result;
+
+  result.relative_change = (result.current.elapsed - result.baseline.elapsed) / result.baseline.elapsed;
+
+  const double scale = 1.0 + threshold;
+  const double baseline_variance = mean_variance (result.baseline) * scale * scale;
+  const double current_variance = mean_variance (result.current);
+  const double variance = baseline_variance + current_variance;
+  const double difference = result.current.mean - scale * result.baseline.mean;
+
+  if (variance <= 0.0)
+    {
+      /// Nothing to test against, fall back to the threshold alone
+      result.t_statistic = difference > 0.0 ? INFINITY : 0.0;
+      result.regression = result.relative_change > threshold;
+      return result;
+    }
+
+  result.t_statistic = difference / std::sqrt (variance);
+
+  /// Welch–Satterthwaite degrees of freedom
+  double denominator = 0.0;
+  if (result.baseline.count > 1)
+    denominator += baseline_variance * baseline_variance / (result.baseline.count - 1);
+  if (result.current.count > 1)
+    denominator += current_variance * current_variance / (result.current.count - 1);
+
+  const auto degrees_of_freedom = static_cast<size_t> (std::max (1.0, variance * variance / denominator));
+
+  result.regression = result.relative_change > threshold
+                   && result.t_statistic > student_t_95 (degrees_of_freedom);
+
+  return result;
+}
+
+void compare_recursive (
+  const std::string &path,
+  const nlohmann::json &baseline,
+  const nlohmann::json &current,
+  double threshold,
+  std::vector<kernel_comparison> &comparisons)
+{
+  for (auto &item: baseline.items ())
+    {
+      if (metadata_keys.count (item.key ()) || !current.contains (item.key ()))
+        continue;
+
+      const auto &current_value = current[item.key ()];
+
+      if (is_measurement (item.value ()) && is_measurement (current_value))
+        comparisons.push_back (compare (path, item.key (), item.value (), current_value, threshold));
+      else if (item.value ().is_object () && current_value.is_object ())
+        compare_recursive (path.empty () ? item.key () : path + "/" + item.key (), item.value (), current_value, threshold, comparisons);
+    }
+}
+
+}
+
+std::vector<kernel_comparison> compare_to_baseline (
+  const nlohmann::json &baseline,
+  const nlohmann::json &current,
+  double threshold)
+{
+  std::vector<kernel_comparison> comparisons;
+  compare_recursive ({}, baseline, current, threshold, comparisons);
+  return comparisons;
+}
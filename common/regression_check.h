@@ -0,0 +1,55 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_REGRESSION_CHECK_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_REGRESSION_CHECK_H
+
+#include "json.hpp"
+
+#include <string>
+#include <vector>
+
+/// Timing of one kernel in one configuration, as stored in results file
+class timing_summary
+{
+public:
+  double elapsed {};    ///< Median (or the only value in results written before statistics were recorded)
+  double mean {};
+  double stddev {};
+  unsigned int count {}; ///< Accepted samples, 0 if only a single value is known
+
+  static timing_summary from_json (const nlohmann::json &json);
+};
+
+class kernel_comparison
+{
+public:
+  std::string configuration; ///< Path of results object, e.g. "4" or "matrix/block_sizes/4/results"
+  std::string kernel;
+
+  timing_summary baseline;
+  timing_summary current;
+
+  double relative_change {}; ///< (current - baseline) / baseline of medians, positive is slower
+  double t_statistic {};     ///< Welch t of H0: current mean <= (1 + threshold) * baseline mean
+  bool regression {};
+
+  nlohmann::json to_json () const;
+};
+
+/**
+ * @brief Compare every kernel found in both results files
+ *
+ * A kernel regresses if it is slower than baseline by more than threshold
+ * (relative) and one-sided Welch t-test rejects "slowdown is within threshold"
+ * at 97.5% confidence. Baselines without sample statistics (plain elapsed
+ * values) are treated as exact, so the test reduces to a one-sample t-test.
+ * Kernels missing in either file are ignored.
+ */
+std::vector<kernel_comparison> compare_to_baseline (
+  const nlohmann::json &baseline,
+  const nlohmann::json &current,
+  double threshold);
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_REGRESSION_CHECK_H
@@ -0,0 +1,48 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "solver_monitor.h"
+
+#include <sstream>
+
+solver_monitor::solver_monitor (callback_type callback_arg, unsigned int stride_arg)
+  : callback (std::move (callback_arg))
+  , stride (stride_arg)
+{
+}
+
+void solver_monitor::start (const std::string &solver_name_arg, std::vector<std::string> scalar_names_arg, unsigned int max_iterations)
+{
+  solver_name = solver_name_arg;
+  scalar_names = std::move (scalar_names_arg);
+
+  start_time = std::chrono::steady_clock::now ();
+  solve_time = 0.0;
+
+  residuals.clear ();
+  scalars.clear ();
+  residuals.reserve (max_iterations);
+  scalars.reserve (static_cast<std::size_t> (max_iterations) * scalar_names.size ());
+}
+
+void solver_monitor::finish ()
+{
+  solve_time = std::chrono::duration<double> (std::chrono::steady_clock::now () - start_time).count ();
+
+  const unsigned int iterations = get_iterations ();
+
+  if (callback && iterations > 0 && (stride == 0 || iterations % stride != 0))
+    callback (*this, iterations);
+}
+
+std::string solver_monitor::format (unsigned int iteration) const
+{
+  std::ostringstream line;
+  line << "i: " << iteration << "; rhs norm: " << get_residual (iteration);
+
+  for (unsigned int scalar_id = 0; scalar_id < scalar_names.size (); scalar_id++)
+    line << "; " << scalar_names[scalar_id] << ": " << get_scalar (iteration, scalar_id);
+
+  return line.str ();
+}
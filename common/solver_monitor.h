@@ -0,0 +1,99 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_SOLVER_MONITOR_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_SOLVER_MONITOR_H
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Convergence history of an iterative solver
+ *
+ * Solvers record the relative residual and their scalars (alpha, beta, ...)
+ * after every iteration. start allocates buffers for max_iterations of the
+ * solve, so record only stores values; printing and other reporting are left
+ * to callback, which is called every stride iterations and for the last one
+ * (only for the last one with stride 0). Time from start to finish is
+ * kept as well, solvers don't print progress or timing themselves, so inner
+ * solves of mixed precision refinement run quietly.
+ */
+class solver_monitor
+{
+public:
+  /// Called with monitor and number of the iteration just recorded (starting from 1)
+  using callback_type = std::function<void (const solver_monitor &monitor, unsigned int iteration)>;
+
+  solver_monitor () = default;
+  explicit solver_monitor (callback_type callback, unsigned int stride = 1);
+
+  /// Called by solver before the first iteration, clears history of the previous solve
+  void start (const std::string &solver_name, std::vector<std::string> scalar_names, unsigned int max_iterations);
+
+  /// Called by solver after every iteration, scalars are in order of names given to start
+  void record (double relative_residual, std::initializer_list<double> iteration_scalars)
+  {
+    residuals.push_back (relative_residual);
+    scalars.resize (scalars.size () + scalar_names.size ());
+    std::copy_n (iteration_scalars.begin (), std::min (iteration_scalars.size (), scalar_names.size ()), scalars.end () - scalar_names.size ());
+
+    if (callback && stride > 0 && get_iterations () % stride == 0)
+      callback (*this, get_iterations ());
+  }
+
+  /// Called by solver after the last iteration
+  void finish ();
+
+  unsigned int get_iterations () const { return static_cast<unsigned int> (residuals.size ()); }
+  double get_solve_time () const { return solve_time; }  ///< Seconds from start to finish
+  const std::string &get_solver_name () const { return solver_name; }
+  const std::vector<std::string> &get_scalar_names () const { return scalar_names; }
+
+  /// Of iteration starting from 1
+  double get_residual (unsigned int iteration) const { return residuals[iteration - 1]; }
+  double get_scalar (unsigned int iteration, unsigned int scalar_id) const { return scalars[(iteration - 1) * scalar_names.size () + scalar_id]; }
+
+  /// "iteration: 1; rhs norm: ...; alpha: ..." line of iteration
+  std::string format (unsigned int iteration) const;
+
+  /// Template, so that CUDA sources don't get json.hpp with this header; json_type is nlohmann::json
+  template <class json_type>
+  json_type to_json () const
+  {
+    json_type json;
+
+    json["solver"] = solver_name;
+    json["iterations"] = get_iterations ();
+    json["solve_time"] = solve_time;
+    json["residuals"] = residuals;
+
+    for (std::size_t scalar_id = 0; scalar_id < scalar_names.size (); scalar_id++)
+      {
+        std::vector<double> values (residuals.size ());
+        for (std::size_t i = 0; i < values.size (); i++)
+          values[i] = scalars[i * scalar_names.size () + scalar_id];
+        json["scalars"][scalar_names[scalar_id]] = values;
+      }
+
+    return json;
+  }
+
+private:
+  callback_type callback;
+  unsigned int stride = 1;
+
+  std::chrono::steady_clock::time_point start_time;
+  double solve_time {};
+
+  std::string solver_name;
+  std::vector<std::string> scalar_names;
+  std::vector<double> residuals;
+  std::vector<double> scalars;  ///< Scalars of iteration i start at i * scalar_names.size ()
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_SOLVER_MONITOR_H
@@ -0,0 +1,168 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_SPMV_KERNEL_REGISTRY_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_SPMV_KERNEL_REGISTRY_H
+
+#include "matrix_converters.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class thread_pool;
+
+enum class matrix_format
+{
+  csr, bcsr_row_major, bcsr_column_major, sliced_bcsr
+};
+
+inline std::string to_string (matrix_format format)
+{
+  switch (format)
+    {
+      case matrix_format::csr: return "CSR";
+      case matrix_format::bcsr_row_major: return "BCSR (row major)";
+      case matrix_format::bcsr_column_major: return "BCSR (column major)";
+      case matrix_format::sliced_bcsr: return "Sliced BCSR";
+    }
+
+  return {};
+}
+
+/**
+ * @brief Matrix in every benchmarked format and input vector
+ *
+ * csr is built from bcsr, so both describe the same (possibly padded) matrix.
+ */
+template <typename data_type, typename index_type>
+class spmv_problem
+{
+public:
+  const csr_matrix_class<data_type, index_type> &csr;
+  const bcsr_matrix_class<data_type, index_type> &bcsr; ///< Row major blocks
+  const data_type *column_major_values {};              ///< bcsr values with transposed blocks
+  const data_type *x {};
+
+  index_type get_x_size () const { return csr.n_cols; }
+  index_type get_y_size () const { return csr.n_rows; }
+};
+
+/// Kernel bound to a problem. Setup (allocations, copies, handles) happens in constructor.
+template <typename data_type, typename index_type>
+class spmv_kernel
+{
+public:
+  virtual ~spmv_kernel () = default;
+
+  /// Compute y = A x once and return elapsed seconds of computation only
+  virtual double run () = 0;
+
+  /// Copy result of the last run into host array of problem.get_y_size () elements
+  virtual void copy_y (data_type *y) = 0;
+};
+
+template <typename data_type, typename index_type>
+class spmv_kernel_entry
+{
+public:
+  using problem_type = spmv_problem<data_type, index_type>;
+  using factory_type = std::function<std::unique_ptr<spmv_kernel<data_type, index_type>> (const problem_type &, thread_pool &)>;
+  using model_type = std::function<double (const problem_type &)>;
+
+  std::string name;                     ///< Key of results
+  std::string device;                   ///< "CPU" or "GPU"
+  matrix_format format {};
+  std::vector<index_type> block_sizes;  ///< Empty if any block size is supported
+  bool threaded = false;                ///< Uses thread pool passed to create, measured for each threads count
+  model_type bytes_model;               ///< Compulsory load/store bytes of one SpMV
+  model_type operations_model;          ///< FLOPs of one SpMV
+  factory_type create;
+
+  bool supports (index_type bs) const
+  {
+    return block_sizes.empty () || std::find (block_sizes.begin (), block_sizes.end (), bs) != block_sizes.end ();
+  }
+};
+
+template <typename data_type, typename index_type>
+double csr_spmv_bytes (const spmv_problem<data_type, index_type> &problem)
+{
+  const auto &matrix = problem.csr;
+
+  return static_cast<double> (matrix.nnz) * (2 * sizeof (data_type) + sizeof (index_type)) ///< values, x, columns
+       + static_cast<double> (matrix.n_rows) * (2 * sizeof (index_type) + sizeof (data_type)); ///< row_ptr, y
+}
+
+template <typename data_type, typename index_type>
+double csr_spmv_operations (const spmv_problem<data_type, index_type> &problem)
+{
+  return 2.0 * problem.csr.nnz;
+}
+
+template <typename data_type, typename index_type>
+double bcsr_spmv_bytes (const spmv_problem<data_type, index_type> &problem)
+{
+  const auto &matrix = problem.bcsr;
+  const double bs = matrix.bs;
+
+  return static_cast<double> (matrix.nnzb) * (bs * bs * sizeof (data_type) + bs * sizeof (data_type) + sizeof (index_type)) ///< values, x, columns
+       + static_cast<double> (matrix.n_rows) * (2 * sizeof (index_type) + bs * sizeof (data_type)); ///< row_ptr, y
+}
+
+template <typename data_type, typename index_type>
+double bcsr_spmv_operations (const spmv_problem<data_type, index_type> &problem)
+{
+  return 2.0 * problem.bcsr.nnzb * problem.bcsr.bs * problem.bcsr.bs;
+}
+
+/**
+ * @brief List of SpMV implementations known to the benchmark driver
+ *
+ * Modules add their kernels with register_*_spmv_kernels functions; the driver
+ * iterates over entries, so a registered kernel is measured and validated
+ * against the reference without further changes.
+ */
+template <typename data_type, typename index_type>
+class spmv_kernel_registry
+{
+public:
+  using entry_type = spmv_kernel_entry<data_type, index_type>;
+
+  entry_type &add (entry_type entry)
+  {
+    kernels.push_back (std::move (entry));
+    return kernels.back ();
+  }
+
+  entry_type &add (
+    std::string name,
+    std::string device,
+    matrix_format format,
+    std::vector<index_type> block_sizes,
+    typename entry_type::factory_type create)
+  {
+    const bool is_csr = format == matrix_format::csr;
+
+    entry_type entry;
+    entry.name = std::move (name);
+    entry.device = std::move (device);
+    entry.format = format;
+    entry.block_sizes = std::move (block_sizes);
+    entry.bytes_model = is_csr ? csr_spmv_bytes<data_type, index_type> : bcsr_spmv_bytes<data_type, index_type>;
+    entry.operations_model = is_csr ? csr_spmv_operations<data_type, index_type> : bcsr_spmv_operations<data_type, index_type>;
+    entry.create = std::move (create);
+
+    return add (std::move (entry));
+  }
+
+  const std::vector<entry_type> &get_kernels () const { return kernels; }
+
+private:
+  std::vector<entry_type> kernels;
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_SPMV_KERNEL_REGISTRY_H
@@ -0,0 +1,154 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+thread_pool::thread_pool (unsigned int threads_count_arg, std::vector<int> cpus_arg)
+  : threads_count (std::max (threads_count_arg, 1u))
+  , cpus (std::move (cpus_arg))
+{
+  for (unsigned int thread_id = 0; thread_id < threads_count; thread_id++)
+    workers.emplace_back (&thread_pool::worker_loop, this, thread_id);
+}
+
+thread_pool::~thread_pool ()
+{
+  {
+    std::lock_guard<std::mutex> guard (lock);
+    stop = true;
+  }
+  task_ready.notify_all ();
+
+  for (auto &worker: workers)
+    worker.join ();
+}
+
+void thread_pool::run (const std::function<void (unsigned int, unsigned int)> &action)
+{
+  std::unique_lock<std::mutex> guard (lock);
+
+  task = &action;
+  running = threads_count;
+  generation++;
+  task_ready.notify_all ();
+
+  task_done.wait (guard, [this] { return running == 0; });
+  task = nullptr;
+}
+
+void thread_pool::worker_loop (unsigned int thread_id)
+{
+#ifdef __linux__
+  if (!cpus.empty ())
+    {
+      cpu_set_t cpu_set;
+      CPU_ZERO (&cpu_set);
+      CPU_SET (cpus[thread_id % cpus.size ()], &cpu_set);
+      pthread_setaffinity_np (pthread_self (), sizeof (cpu_set_t), &cpu_set);
+    }
+#endif
+
+  unsigned long long last_generation = 0;
+
+  while (true)
+    {
+      const std::function<void (unsigned int, unsigned int)> *current_task {};
+
+      {
+        std::unique_lock<std::mutex> guard (lock);
+        task_ready.wait (guard, [&] { return stop || generation != last_generation; });
+
+        if (stop)
+          return;
+
+        last_generation = generation;
+        current_task = task;
+      }
+
+      (*current_task) (thread_id, threads_count);
+
+      {
+        std::lock_guard<std::mutex> guard (lock);
+        if (--running == 0)
+          task_done.notify_one ();
+      }
+    }
+}
+
+/// Parse "0-3,8-11" into cpu ids
+static std::vector<int> parse_cpu_list (const std::string &list)
+{
+  std::vector<int> result;
+  std::stringstream ranges (list);
+  std::string range;
+
+  while (std::getline (ranges, range, ','))
+    {
+      if (range.empty ())
+        continue;
+
+      const auto dash = range.find ('-');
+      const int first = std::stoi (range.substr (0, dash));
+      const int last = dash == std::string::npos ? first : std::stoi (range.substr (dash + 1));
+
+      for (int cpu = first; cpu <= last; cpu++)
+        result.push_back (cpu);
+    }
+
+  return result;
+}
+
+std::vector<std::vector<int>> thread_pool::get_numa_nodes ()
+{
+  namespace fs = std::filesystem;
+
+  std::vector<std::vector<int>> nodes;
+  std::error_code error;
+  const fs::path nodes_path ("/sys/devices/system/node");
+
+  if (fs::is_directory (nodes_path, error))
+    {
+      std::vector<fs::path> node_dirs;
+      for (auto &entry: fs::directory_iterator (nodes_path, error))
+        {
+          const std::string name = entry.path ().filename ().string ();
+          if (name.rfind ("node", 0) == 0 && name.size () > 4 && std::isdigit (name[4]))
+            node_dirs.push_back (entry.path ());
+        }
+
+      std::sort (node_dirs.begin (), node_dirs.end ());
+
+      for (auto &node_dir: node_dirs)
+        {
+          std::ifstream is (node_dir / "cpulist");
+          std::string list;
+          std::getline (is, list);
+
+          auto node_cpus = parse_cpu_list (list);
+          if (!node_cpus.empty ())
+            nodes.push_back (std::move (node_cpus));
+        }
+    }
+
+  if (nodes.empty ())
+    {
+      nodes.emplace_back ();
+      for (unsigned int cpu = 0; cpu < std::thread::hardware_concurrency (); cpu++)
+        nodes.back ().push_back (cpu);
+    }
+
+  return nodes;
+}
@@ -0,0 +1,106 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_THREAD_POOL_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+/**
+ * @brief Persistent pool of worker threads for fork-join CPU kernels
+ *
+ * Threads are created once and sleep between calls of run, so per-call
+ * overhead is one wake-up instead of thread creation. If cpus are given,
+ * worker i is pinned to cpus[i % cpus.size ()] (Linux only), which together
+ * with first touch keeps the data of each worker on its NUMA node.
+ */
+class thread_pool
+{
+public:
+  explicit thread_pool (
+    unsigned int threads_count = std::thread::hardware_concurrency (),
+    std::vector<int> cpus = {});
+  ~thread_pool ();
+
+  thread_pool (const thread_pool &) = delete;
+  thread_pool &operator= (const thread_pool &) = delete;
+
+  unsigned int size () const { return threads_count; }
+
+  /// Execute action on every worker and wait for completion
+  void run (const std::function<void (unsigned int thread_id, unsigned int threads_count)> &action);
+
+  /// CPU lists of NUMA nodes (single node with all cpus if topology isn't available)
+  static std::vector<std::vector<int>> get_numa_nodes ();
+
+private:
+  void worker_loop (unsigned int thread_id);
+
+private:
+  const unsigned int threads_count {};
+  const std::vector<int> cpus;
+
+  std::vector<std::thread> workers;
+
+  std::mutex lock;
+  std::condition_variable task_ready;
+  std::condition_variable task_done;
+
+  const std::function<void (unsigned int, unsigned int)> *task = nullptr;
+  unsigned long long generation {};
+  unsigned int running {};
+  bool stop = false;
+};
+
+/**
+ * @brief Barrier between phases of one thread_pool::run call
+ *
+ * Spins (with yield) instead of sleeping, since phases it separates, like
+ * levels of triangular solve, are much shorter than a wake-up.
+ */
+class spin_barrier
+{
+public:
+  explicit spin_barrier (unsigned int threads_count_arg) : threads_count (threads_count_arg) {}
+
+  void wait ()
+  {
+    const unsigned int current_generation = generation.load (std::memory_order_acquire);
+
+    if (arrived.fetch_add (1, std::memory_order_acq_rel) + 1 == threads_count)
+      {
+        arrived.store (0, std::memory_order_relaxed);
+        generation.fetch_add (1, std::memory_order_release);
+        return;
+      }
+
+    while (generation.load (std::memory_order_acquire) == current_generation)
+      std::this_thread::yield ();
+  }
+
+private:
+  const unsigned int threads_count {};
+  std::atomic<unsigned int> arrived {};
+  std::atomic<unsigned int> generation {};
+};
+
+/// Contiguous part [first, second) of n elements processed by thread_id
+template <typename index_type>
+std::pair<index_type, index_type> thread_range (index_type n, unsigned int thread_id, unsigned int threads_count)
+{
+  const index_type chunk = n / threads_count;
+  const index_type remainder = n % threads_count;
+
+  const index_type begin = chunk * thread_id + std::min<index_type> (thread_id, remainder);
+  const index_type end = begin + chunk + (static_cast<index_type> (thread_id) < remainder ? 1 : 0);
+
+  return { begin, end };
+}
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_THREAD_POOL_H
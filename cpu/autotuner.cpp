@@ -0,0 +1,267 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "autotuner.h"
+#include "cpu_matrix_multiplier.h"
+#include "cache_directory.h"
+
+#include "json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+template <class T, class C>
+cpu_autotuned_operator<T, C>::cpu_autotuned_operator (const csr_matrix_class<T, C> &matrix, matrix_format format, C bs)
+{
+  if (format == matrix_format::csr)
+    {
+      csr = std::make_unique<csr_matrix_class<T, C>> (*csr_to_bcsr (matrix, C (1)));
+      A = std::make_unique<cpu_csr_operator<T, C>> (*csr);
+    }
+  else if (format == matrix_format::bcsr_row_major || format == matrix_format::bcsr_column_major)
+    {
+      if (bs < 1 || matrix.n_rows % bs || matrix.n_cols % bs)
+        throw std::runtime_error ("Error! Matrix dimensions aren't multiples of block size " + std::to_string (bs));
+
+      bcsr = csr_to_bcsr (matrix, bs);
+      A = std::make_unique<cpu_bcsr_operator<T, C>> (*bcsr, format);
+    }
+  else
+    {
+      throw std::runtime_error ("Error! No linear operator of format " + to_string (format));
+    }
+}
+
+template <class T, class C>
+std::string cpu_autotuned_operator<T, C>::get_description () const
+{
+  return to_string (get_format ()) + " (bs = " + std::to_string (get_bs ()) + ")";
+}
+
+template <typename index_type>
+std::uint64_t get_sparsity_fingerprint (
+  index_type n_rows,
+  index_type n_cols,
+  const index_type *row_ptr,
+  const index_type *columns)
+{
+  /// FNV-1a over 64-bit words
+  std::uint64_t hash = 14695981039346656037ull;
+  auto add = [&] (std::uint64_t value) {
+    hash ^= value;
+    hash *= 1099511628211ull;
+  };
+
+  add (n_rows);
+  add (n_cols);
+
+  for (index_type row = 0; row <= n_rows; row++)
+    add (row_ptr[row]);
+
+  const index_type nnz = row_ptr[n_rows];
+  const index_type stride = std::max<index_type> (1, nnz / 4096);
+  for (index_type element = 0; element < nnz; element += stride)
+    add (columns[element]);
+
+  return hash;
+}
+
+namespace
+{
+
+std::filesystem::path autotune_cache_path ()
+{
+  return get_cache_directory () / "autotune.json";
+}
+
+nlohmann::json load_autotune_cache ()
+{
+  std::ifstream is (autotune_cache_path ());
+
+  if (is)
+    {
+      try
+        {
+          return nlohmann::json::parse (is);
+        }
+      catch (const nlohmann::json::exception &)
+        {
+          /// Broken cache is rebuilt
+        }
+    }
+
+  return nlohmann::json::object ();
+}
+
+/// Cache directory may be shared by nodes of a cluster, decisions are valid on the same host and threads count only
+template <typename data_type>
+std::string cache_key (std::uint64_t fingerprint, unsigned int threads_count)
+{
+  return get_host_name () + "_" + std::to_string (std::thread::hardware_concurrency ()) + "_"
+       + std::to_string (threads_count) + "_" + std::to_string (fingerprint)
+       + (sizeof (data_type) == sizeof (float) ? "_float" : "_double");
+}
+
+/// Formats of cpu_linear_operator
+matrix_format matrix_format_from_string (const std::string &name)
+{
+  for (auto format: { matrix_format::csr, matrix_format::bcsr_row_major, matrix_format::bcsr_column_major })
+    if (to_string (format) == name)
+      return format;
+
+  throw std::runtime_error ("Error! Unknown matrix format " + name);
+}
+
+}
+
+template <class T, class C>
+std::unique_ptr<cpu_autotuned_operator<T, C>> autotune_operator (
+  const csr_matrix_class<T, C> &matrix,
+  thread_pool &pool,
+  const autotune_settings &settings)
+{
+  const std::string key = cache_key<T> (
+    get_sparsity_fingerprint (matrix.n_rows, matrix.n_cols, matrix.row_ptr.get (), matrix.columns.get ()),
+    pool.size ());
+
+  if (settings.use_cache)
+    {
+      const auto cache = load_autotune_cache ();
+
+      if (cache.contains (key))
+        {
+          try
+            {
+              const auto &decision = cache.at (key);
+              return std::make_unique<cpu_autotuned_operator<T, C>> (
+                matrix,
+                matrix_format_from_string (decision.at ("format").get<std::string> ()),
+                decision.at ("bs").get<C> ());
+            }
+          catch (const std::exception &)
+            {
+              /// Decision of an older build or of a different matrix with the same fingerprint is tuned again
+            }
+        }
+    }
+
+  spmv_kernel_registry<T, C> registry;
+  register_cpu_spmv_kernels (registry);
+
+  /// Threaded CPU kernel of format supports bs
+  auto has_kernel = [&] (matrix_format format, C bs) {
+    return std::any_of (registry.get_kernels ().begin (), registry.get_kernels ().end (), [&] (const auto &entry) {
+      return entry.device == "CPU" && entry.threaded && entry.format == format && entry.supports (bs);
+    });
+  };
+
+  /// Block sizes in order of settings, so that the native one of a block matrix goes first
+  std::vector<std::pair<matrix_format, C>> trials;
+  if (has_kernel (matrix_format::csr, 1))
+    trials.emplace_back (matrix_format::csr, 1);
+
+  for (auto bs: settings.block_sizes)
+    for (auto format: { matrix_format::bcsr_row_major, matrix_format::bcsr_column_major })
+      {
+        const std::pair<matrix_format, C> trial (format, bs);
+
+        if (bs > 0 && matrix.n_rows % bs == 0 && matrix.n_cols % bs == 0 && has_kernel (format, bs)
+         && std::find (trials.begin (), trials.end (), trial) == trials.end ())
+          trials.push_back (trial);
+      }
+
+  if (trials.empty ())
+    throw std::runtime_error ("Error! No CPU formats to autotune");
+
+  std::vector<T> x (matrix.n_cols, 1.0);
+  std::vector<T> y (matrix.n_rows);
+
+  const auto begin = std::chrono::steady_clock::now ();
+  auto spent = [&] { return std::chrono::duration<double> (std::chrono::steady_clock::now () - begin).count (); };
+
+  double best_time = std::numeric_limits<double>::max ();
+  std::unique_ptr<cpu_autotuned_operator<T, C>> best;
+
+  for (auto &[format, bs]: trials)
+    {
+      if (best && spent () > settings.time_budget)
+        break;
+
+      auto candidate = std::make_unique<cpu_autotuned_operator<T, C>> (matrix, format, bs);
+      const auto ranges = candidate->partition (pool.size ());
+
+      auto apply = [&] {
+        pool.run ([&] (unsigned int thread_id, unsigned int) {
+          candidate->apply (ranges[thread_id].first, ranges[thread_id].second, x.data (), y.data ());
+        });
+      };
+
+      apply (); ///< Warm-up
+
+      double candidate_time = std::numeric_limits<double>::max ();
+      for (unsigned int repeat = 0; repeat < 5; repeat++)
+        {
+          const auto trial_begin = std::chrono::steady_clock::now ();
+          apply ();
+          const auto trial_end = std::chrono::steady_clock::now ();
+          candidate_time = std::min (candidate_time, std::chrono::duration<double> (trial_end - trial_begin).count ());
+        }
+
+      if (candidate_time < best_time)
+        {
+          best_time = candidate_time;
+          best = std::move (candidate);
+        }
+    }
+
+  if (settings.use_cache)
+    {
+      auto cache = load_autotune_cache ();
+      cache[key] = {
+        { "format", to_string (best->get_format ()) },
+        { "bs", best->get_bs () },
+        { "elapsed", best_time }
+      };
+
+      std::ofstream os (autotune_cache_path ());
+      os << cache.dump (2) << std::endl;
+    }
+
+  return best;
+}
+
+template <class T, class C>
+std::unique_ptr<cpu_autotuned_operator<T, C>> autotune_operator (
+  const bcsr_matrix_class<T, C> &matrix,
+  thread_pool &pool,
+  const autotune_settings &settings)
+{
+  autotune_settings block_settings = settings;
+
+  auto &block_sizes = block_settings.block_sizes;
+  block_sizes.erase (std::remove (block_sizes.begin (), block_sizes.end (), static_cast<int> (matrix.bs)), block_sizes.end ());
+  block_sizes.insert (block_sizes.begin (), static_cast<int> (matrix.bs));
+
+  return autotune_operator (csr_matrix_class<T, C> (matrix), pool, block_settings);
+}
+
+#define INSTANTIATE(DTYPE,ITYPE) \
+  template class cpu_autotuned_operator<DTYPE, ITYPE>; \
+  template std::unique_ptr<cpu_autotuned_operator<DTYPE, ITYPE>> autotune_operator (const csr_matrix_class<DTYPE, ITYPE> &, thread_pool &, const autotune_settings &); \
+  template std::unique_ptr<cpu_autotuned_operator<DTYPE, ITYPE>> autotune_operator (const bcsr_matrix_class<DTYPE, ITYPE> &, thread_pool &, const autotune_settings &);
+
+INSTANTIATE (float,int)
+INSTANTIATE (double,int)
+INSTANTIATE (float,std::int64_t)
+INSTANTIATE (double,std::int64_t)
+
+#undef INSTANTIATE
+
+template std::uint64_t get_sparsity_fingerprint (int, int, const int *, const int *);
+template std::uint64_t get_sparsity_fingerprint (std::int64_t, std::int64_t, const std::int64_t *, const std::int64_t *);
@@ -0,0 +1,91 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_AUTOTUNER_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_AUTOTUNER_H
+
+#include "cpu_linear_operator.h"
+#include "matrix_converters.h"
+#include "thread_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief cpu_linear_operator chosen by autotune_operator
+ *
+ * Operator owns its copy of the matrix in the chosen format and block size,
+ * so it stays valid after the source matrix is gone.
+ */
+template <class T, class C>
+class cpu_autotuned_operator : public cpu_linear_operator<T, C>
+{
+public:
+  /// Matrix is split into blocks of bs (ignored for CSR), dimensions should be multiples of bs
+  cpu_autotuned_operator (const csr_matrix_class<T, C> &matrix, matrix_format format, C bs);
+
+  C size () const override { return A->size (); }
+  C unit_rows () const override { return A->unit_rows (); }
+  matrix_format get_format () const override { return A->get_format (); }
+
+  std::vector<std::pair<C, C>> partition (unsigned int threads_count) const override { return A->partition (threads_count); }
+  void apply (C first, C last, const T *x, T *y) const override { A->apply (first, last, x, y); }
+  T apply_dot (C first, C last, const T *x, T *y) const override { return A->apply_dot (first, last, x, y); }
+  void apply_multiple (C first, C last, unsigned int k, unsigned int stride, const T *x, T *y) const override { A->apply_multiple (first, last, k, stride, x, y); }
+  void diagonal (C first, C last, T *d) const override { A->diagonal (first, last, d); }
+
+  C get_bs () const { return bcsr ? bcsr->bs : 1; }
+  std::string get_description () const;
+
+private:
+  std::unique_ptr<csr_matrix_class<T, C>> csr;
+  std::unique_ptr<bcsr_matrix_class<T, C>> bcsr;
+  std::unique_ptr<cpu_linear_operator<T, C>> A;
+};
+
+class autotune_settings
+{
+public:
+  double time_budget = 2.0;                      ///< Seconds spent on trials (setup of formats included)
+  std::vector<int> block_sizes = { 2, 3, 4, 6, 8 }; ///< Only sizes that divide matrix dimensions are tried
+  bool use_cache = true;
+};
+
+/// Hash of dimensions, row pointers and a strided sample of column indices
+template <typename index_type>
+std::uint64_t get_sparsity_fingerprint (
+  index_type n_rows,
+  index_type n_cols,
+  const index_type *row_ptr,
+  const index_type *columns);
+
+/**
+ * @brief Trial CPU formats and block sizes on pool and return the fastest operator
+ *
+ * Candidates are formats of threaded CPU kernels of the registry (see
+ * register_cpu_spmv_kernels) that solvers can run as cpu_linear_operator,
+ * with block sizes the kernels support. Each one is timed with the apply of
+ * the operator over its partition, the same code solvers run. Threads count
+ * is that of pool, which solvers share with the operator.
+ *
+ * Decision is stored in autotune.json in the cache directory keyed by host,
+ * its CPU count, pool size, sparsity fingerprint and data type, so repeated
+ * calls on the same mesh and machine skip the trials.
+ */
+template <class T, class C>
+std::unique_ptr<cpu_autotuned_operator<T, C>> autotune_operator (
+  const csr_matrix_class<T, C> &matrix,
+  thread_pool &pool,
+  const autotune_settings &settings = {});
+
+/// Native block size of matrix is tried first
+template <class T, class C>
+std::unique_ptr<cpu_autotuned_operator<T, C>> autotune_operator (
+  const bcsr_matrix_class<T, C> &matrix,
+  thread_pool &pool,
+  const autotune_settings &settings = {});
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_AUTOTUNER_H
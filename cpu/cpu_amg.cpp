@@ -0,0 +1,644 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_amg.h"
+#include "cpu_matrix_multiplier.h"
+#include "cpu_row_runner.h"
+#include "cpu_spmv_isa.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+
+namespace
+{
+
+/// Coarsest level is inverted only if it has at most that many scalar rows
+constexpr int max_dense_rows = 1024;
+
+template <class T, class C>
+T block_norm (C bs, const T *block)
+{
+  T sum {};
+  for (C i = 0; i < bs * bs; i++)
+    sum += block[i] * block[i];
+  return std::sqrt (sum);
+}
+
+/// c += a b for row major n x n blocks
+template <class T, class C>
+void block_mult_add (C n, const T *a, const T *b, T *c)
+{
+  for (C i = 0; i < n; i++)
+    for (C k = 0; k < n; k++)
+      {
+        const T a_ik = a[i * n + k];
+        for (C j = 0; j < n; j++)
+          c[i * n + j] += a_ik * b[k * n + j];
+      }
+}
+
+/// a b, rows of result are split between threads
+template <class T, class C>
+std::unique_ptr<bcsr_matrix_class<T, C>> bcsr_multiply (
+  const bcsr_matrix_class<T, C> &a,
+  const bcsr_matrix_class<T, C> &b,
+  thread_pool &pool)
+{
+  const C bs = a.bs;
+  const C block_size = bs * bs;
+
+  std::vector<C> row_ptr (a.n_rows + 1, 0);
+
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    const auto [first, last] = thread_range (a.n_rows, thread_id, threads_count);
+    std::vector<C> marker (b.n_cols, -1);
+
+    for (C row = first; row < last; row++)
+      for (C a_block = a.row_ptr[row]; a_block < a.row_ptr[row + 1]; a_block++)
+        {
+          const C k = a.columns[a_block];
+          for (C b_block = b.row_ptr[k]; b_block < b.row_ptr[k + 1]; b_block++)
+            if (marker[b.columns[b_block]] != row)
+              {
+                marker[b.columns[b_block]] = row;
+                row_ptr[row + 1]++;
+              }
+        }
+  });
+
+  for (C row = 0; row < a.n_rows; row++)
+    row_ptr[row + 1] += row_ptr[row];
+
+  auto result = std::make_unique<bcsr_matrix_class<T, C>> (a.n_rows, b.n_cols, bs, row_ptr[a.n_rows]);
+  std::copy (row_ptr.begin (), row_ptr.end (), result->row_ptr.get ());
+
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    const auto [first, last] = thread_range (a.n_rows, thread_id, threads_count);
+
+    /// Rows of thread are filled in increasing order, so positions set for previous rows are below row_ptr[row]
+    std::vector<C> position (b.n_cols, -1);
+    std::vector<C> order;
+    std::vector<C> row_columns;
+    std::vector<T> row_values;
+
+    C *columns = result->columns.get ();
+    T *values = result->values.get ();
+
+    for (C row = first; row < last; row++)
+      {
+        const C row_begin = row_ptr[row];
+        C row_end = row_begin;
+
+        for (C a_block = a.row_ptr[row]; a_block < a.row_ptr[row + 1]; a_block++)
+          {
+            const C k = a.columns[a_block];
+            for (C b_block = b.row_ptr[k]; b_block < b.row_ptr[k + 1]; b_block++)
+              {
+                const C column = b.columns[b_block];
+                if (position[column] < row_begin)
+                  {
+                    position[column] = row_end;
+                    columns[row_end] = column;
+                    std::fill_n (values + row_end * block_size, block_size, T {});
+                    row_end++;
+                  }
+
+                block_mult_add (bs, a.values.get () + a_block * block_size, b.values.get () + b_block * block_size, values + position[column] * block_size);
+              }
+          }
+
+        if (std::is_sorted (columns + row_begin, columns + row_end))
+          continue;
+
+        const C count = row_end - row_begin;
+        order.resize (count);
+        std::iota (order.begin (), order.end (), C {});
+        std::sort (order.begin (), order.end (), [&] (C lhs, C rhs) { return columns[row_begin + lhs] < columns[row_begin + rhs]; });
+
+        row_columns.assign (columns + row_begin, columns + row_end);
+        row_values.assign (values + row_begin * block_size, values + row_end * block_size);
+
+        for (C i = 0; i < count; i++)
+          {
+            columns[row_begin + i] = row_columns[order[i]];
+            std::copy_n (row_values.data () + order[i] * block_size, block_size, values + (row_begin + i) * block_size);
+          }
+      }
+  });
+
+  return result;
+}
+
+/// a^T with transposed blocks
+template <class T, class C>
+std::unique_ptr<bcsr_matrix_class<T, C>> bcsr_transpose (const bcsr_matrix_class<T, C> &a)
+{
+  const C bs = a.bs;
+  auto result = std::make_unique<bcsr_matrix_class<T, C>> (a.n_cols, a.n_rows, bs, a.nnzb);
+
+  std::fill_n (result->row_ptr.get (), a.n_cols + 1, C {});
+  for (C block = 0; block < a.nnzb; block++)
+    result->row_ptr[a.columns[block] + 1]++;
+  for (C row = 0; row < a.n_cols; row++)
+    result->row_ptr[row + 1] += result->row_ptr[row];
+
+  std::vector<C> offsets (result->row_ptr.get (), result->row_ptr.get () + a.n_cols);
+
+  for (C row = 0; row < a.n_rows; row++)
+    for (C block = a.row_ptr[row]; block < a.row_ptr[row + 1]; block++)
+      {
+        const C position = offsets[a.columns[block]]++;
+        result->columns[position] = row;
+
+        const T *source = a.values.get () + block * bs * bs;
+        T *target = result->values.get () + position * bs * bs;
+        for (C i = 0; i < bs; i++)
+          for (C j = 0; j < bs; j++)
+            target[j * bs + i] = source[i * bs + j];
+      }
+
+  return result;
+}
+
+/**
+ * Aggregates of nodes (block rows), -1 for nodes without strong connections,
+ * which are left to smoother. Returns aggregates count.
+ */
+template <class T, class C>
+C aggregate_nodes (const bcsr_matrix_class<T, C> &A, double threshold, thread_pool &pool, std::vector<C> &aggregates)
+{
+  const C n = A.n_rows;
+  const C bs = A.bs;
+
+  std::vector<T> diagonal_norms (n);
+  std::vector<char> strong (A.nnzb);
+  std::vector<char> has_strong (n);
+
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    const auto [first, last] = thread_range (n, thread_id, threads_count);
+    for (C row = first; row < last; row++)
+      for (C block = A.row_ptr[row]; block < A.row_ptr[row + 1]; block++)
+        if (A.columns[block] == row)
+          diagonal_norms[row] = block_norm (bs, A.values.get () + block * bs * bs);
+  });
+
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    const auto [first, last] = thread_range (n, thread_id, threads_count);
+    for (C row = first; row < last; row++)
+      for (C block = A.row_ptr[row]; block < A.row_ptr[row + 1]; block++)
+        {
+          const C column = A.columns[block];
+          const T norm = block_norm (bs, A.values.get () + block * bs * bs);
+
+          strong[block] = column != row && norm > threshold * std::sqrt (diagonal_norms[row] * diagonal_norms[column]);
+          has_strong[row] |= strong[block];
+        }
+  });
+
+  aggregates.assign (n, -1);
+  C count = 0;
+
+  /// 1 - nodes with whole strong neighbourhood free start aggregates
+  for (C row = 0; row < n; row++)
+    {
+      if (aggregates[row] >= 0 || !has_strong[row])
+        continue;
+
+      bool is_free = true;
+      for (C block = A.row_ptr[row]; block < A.row_ptr[row + 1] && is_free; block++)
+        if (strong[block] && aggregates[A.columns[block]] >= 0)
+          is_free = false;
+
+      if (!is_free)
+        continue;
+
+      aggregates[row] = count;
+      for (C block = A.row_ptr[row]; block < A.row_ptr[row + 1]; block++)
+        if (strong[block])
+          aggregates[A.columns[block]] = count;
+      count++;
+    }
+
+  /// 2 - other nodes join aggregate of the strongest aggregated neighbour
+  const std::vector<C> first_pass = aggregates;
+
+  for (C row = 0; row < n; row++)
+    {
+      if (aggregates[row] >= 0 || !has_strong[row])
+        continue;
+
+      T max_norm {};
+      for (C block = A.row_ptr[row]; block < A.row_ptr[row + 1]; block++)
+        if (strong[block] && first_pass[A.columns[block]] >= 0)
+          {
+            const T norm = block_norm (bs, A.values.get () + block * bs * bs);
+            if (norm > max_norm)
+              {
+                max_norm = norm;
+                aggregates[row] = first_pass[A.columns[block]];
+              }
+          }
+    }
+
+  /// 3 - the rest form aggregates with their free strong neighbours
+  for (C row = 0; row < n; row++)
+    {
+      if (aggregates[row] >= 0 || !has_strong[row])
+        continue;
+
+      aggregates[row] = count;
+      for (C block = A.row_ptr[row]; block < A.row_ptr[row + 1]; block++)
+        if (strong[block] && aggregates[A.columns[block]] < 0)
+          aggregates[A.columns[block]] = count;
+      count++;
+    }
+
+  return count;
+}
+
+}
+
+template <class T, class C>
+class cpu_amg<T, C>::level
+{
+public:
+  level (const bcsr_matrix_class<T, C> &A_arg, std::unique_ptr<bcsr_matrix_class<T, C>> A_owned_arg, thread_pool &pool)
+    : A_owned (std::move (A_owned_arg))
+    , A (A_owned ? *A_owned : A_arg)
+    , n (A.n_rows * A.bs)
+    , D (A, pool)
+    , runner (pool, nnz_balanced_ranges (A.row_ptr.get (), A.n_rows, pool.size ()))
+    , x (new T[n])
+    , b (new T[n])
+    , r (new T[n])
+    , d (new T[n])
+    , d_next (new T[n])
+    , t (new T[n])
+  {
+    /// First touch by the thread that owns rows
+    runner.template run<0> ([&] (C first, C last, T *) {
+      for (T *vector: { x.get (), b.get (), r.get (), d.get (), d_next.get (), t.get () })
+        std::fill (vector + first * A.bs, vector + last * A.bs, T {});
+    });
+  }
+
+public:
+  const std::unique_ptr<bcsr_matrix_class<T, C>> A_owned;  ///< Coarse levels
+  const bcsr_matrix_class<T, C> &A;
+  const C n {};                                            ///< Scalar rows
+
+  cpu_block_jacobi<T, C> D;
+  cpu_row_runner<T, C> runner;  ///< Block rows of A balanced by nonzero blocks, also used for P
+  T lambda_max {};              ///< Upper bound of D^-1 A spectrum
+
+  /// Transfer from next coarser level and to it
+  std::unique_ptr<bcsr_matrix_class<T, C>> P;
+  std::unique_ptr<bcsr_matrix_class<T, C>> R;
+  std::unique_ptr<cpu_row_runner<T, C>> R_runner;
+
+  std::unique_ptr<T[]> coarse_inverse;  ///< Coarsest level only, row major
+
+  std::unique_ptr<T[]> x;
+  std::unique_ptr<T[]> b;
+  std::unique_ptr<T[]> r;
+  std::unique_ptr<T[]> d;
+  std::unique_ptr<T[]> d_next;
+  std::unique_ptr<T[]> t;
+};
+
+template <class T, class C>
+cpu_amg<T, C>::cpu_amg (const bcsr_matrix_class<T, C> &A, thread_pool &pool_arg, amg_settings settings_arg)
+  : pool (pool_arg)
+  , settings (settings_arg)
+{
+  levels.push_back (std::make_unique<level> (A, nullptr, pool));
+
+  while (true)
+    {
+      level &l = *levels.back ();
+      const C bs = l.A.bs;
+
+      /// Bound of lambda_max (D^-1 A) by its infinity norm, power iterations underestimate it and Chebyshev diverges above interval
+      const C *row_ptr = l.A.row_ptr.get ();
+      const T *values = l.A.values.get ();
+      std::vector<T> thread_norms (pool.size ());
+
+      pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+        const auto [first, last] = thread_range (l.A.n_rows, thread_id, threads_count);
+        std::vector<T> product (bs * bs);
+        std::vector<T> row_sums (bs);
+        T norm {};
+
+        for (C row = first; row < last; row++)
+          {
+            const T *inverted_diagonal = l.D.get_inverted_blocks () + row * bs * bs;
+            std::fill (row_sums.begin (), row_sums.end (), T {});
+
+            for (C block = row_ptr[row]; block < row_ptr[row + 1]; block++)
+              {
+                std::fill (product.begin (), product.end (), T {});
+                block_mult_add (bs, inverted_diagonal, values + block * bs * bs, product.data ());
+
+                for (C i = 0; i < bs; i++)
+                  for (C j = 0; j < bs; j++)
+                    row_sums[i] += std::abs (product[i * bs + j]);
+              }
+
+            norm = std::max (norm, *std::max_element (row_sums.begin (), row_sums.end ()));
+          }
+
+        thread_norms[thread_id] = norm;
+      });
+
+      l.lambda_max = *std::max_element (thread_norms.begin (), thread_norms.end ());
+
+      if (!std::isfinite (l.lambda_max) || l.lambda_max <= T {})
+        l.lambda_max = T {1};
+
+      if (levels.size () >= settings.max_levels || l.A.n_rows <= static_cast<C> (settings.coarse_rows))
+        break;
+
+      std::vector<C> aggregates;
+      const C aggregates_count = aggregate_nodes (l.A, settings.strength_threshold, pool, aggregates);
+
+      if (aggregates_count == 0 || aggregates_count >= l.A.n_rows * 9 / 10)
+        break;
+
+      /// Tentative prolongator: identity blocks scaled by 1 / sqrt (aggregate size), so its columns are orthonormal
+      std::vector<C> aggregate_sizes (aggregates_count);
+      C aggregated_nodes = 0;
+      for (C row = 0; row < l.A.n_rows; row++)
+        if (aggregates[row] >= 0)
+          {
+            aggregate_sizes[aggregates[row]]++;
+            aggregated_nodes++;
+          }
+
+      bcsr_matrix_class<T, C> tentative (l.A.n_rows, aggregates_count, bs, aggregated_nodes);
+      tentative.row_ptr[0] = 0;
+      for (C row = 0, block = 0; row < l.A.n_rows; row++)
+        {
+          if (aggregates[row] >= 0)
+            {
+              T *values = tentative.values.get () + block * bs * bs;
+              const T scale = T {1} / std::sqrt (static_cast<T> (aggregate_sizes[aggregates[row]]));
+
+              for (C i = 0; i < bs; i++)
+                for (C j = 0; j < bs; j++)
+                  values[i * bs + j] = i == j ? scale : T {};
+
+              tentative.columns[block++] = aggregates[row];
+            }
+          tentative.row_ptr[row + 1] = block;
+        }
+
+      /// P = (I - omega D^-1 A) T, pattern of A T contains the one of T since A has diagonal blocks
+      l.P = bcsr_multiply (l.A, tentative, pool);
+
+      const T omega = T {4} / (3 * l.lambda_max);
+      bcsr_matrix_class<T, C> &P = *l.P;
+
+      pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+        const auto [first, last] = thread_range (P.n_rows, thread_id, threads_count);
+        std::vector<T> product (bs * bs);
+
+        for (C row = first; row < last; row++)
+          {
+            const T *inverted_diagonal = l.D.get_inverted_blocks () + row * bs * bs;
+
+            for (C block = P.row_ptr[row]; block < P.row_ptr[row + 1]; block++)
+              {
+                T *values = P.values.get () + block * bs * bs;
+
+                std::fill (product.begin (), product.end (), T {});
+                block_mult_add (bs, inverted_diagonal, values, product.data ());
+
+                for (C i = 0; i < bs * bs; i++)
+                  values[i] = -omega * product[i];
+
+                if (P.columns[block] == aggregates[row])
+                  for (C i = 0; i < bs; i++)
+                    values[i * bs + i] += T {1} / std::sqrt (static_cast<T> (aggregate_sizes[aggregates[row]]));
+              }
+          }
+      });
+
+      l.R = bcsr_transpose (P);
+      l.R_runner = std::make_unique<cpu_row_runner<T, C>> (pool, nnz_balanced_ranges (l.R->row_ptr.get (), l.R->n_rows, pool.size ()));
+
+      auto AP = bcsr_multiply (l.A, P, pool);
+      levels.push_back (std::make_unique<level> (l.A, bcsr_multiply (*l.R, *AP, pool), pool));
+    }
+
+  level &coarsest = *levels.back ();
+  const C n = coarsest.n;
+
+  if (n <= max_dense_rows)
+    {
+      const bcsr_matrix_class<T, C> &Ac = coarsest.A;
+      const C bs = Ac.bs;
+
+      coarsest.coarse_inverse.reset (new T[n * n]);
+      std::fill_n (coarsest.coarse_inverse.get (), n * n, T {});
+
+      for (C row = 0; row < Ac.n_rows; row++)
+        for (C block = Ac.row_ptr[row]; block < Ac.row_ptr[row + 1]; block++)
+          for (C i = 0; i < bs; i++)
+            for (C j = 0; j < bs; j++)
+              coarsest.coarse_inverse[(row * bs + i) * n + Ac.columns[block] * bs + j] = Ac.values[block * bs * bs + i * bs + j];
+
+      std::unique_ptr<T[]> buffer (new T[2 * n * n]);
+      if (!invert_dense_matrix (n, coarsest.coarse_inverse.get (), buffer.get ()))
+        coarsest.coarse_inverse.reset (); ///< Singular, coarsest level is smoothed instead
+    }
+}
+
+template <class T, class C>
+cpu_amg<T, C>::~cpu_amg () = default;
+
+template <class T, class C>
+C cpu_amg<T, C>::size () const
+{
+  return levels.front ()->n;
+}
+
+template <class T, class C>
+C cpu_amg<T, C>::level_rows (unsigned int level_id) const
+{
+  return levels[level_id]->A.n_rows;
+}
+
+template <class T, class C>
+double cpu_amg<T, C>::operator_complexity () const
+{
+  double nnzb {};
+  for (auto &l: levels)
+    nnzb += l->A.nnzb;
+  return nnzb / levels.front ()->A.nnzb;
+}
+
+template <class T, class C>
+void cpu_amg<T, C>::apply (const T *r, T *z) const
+{
+  cycle (0, r, z);
+}
+
+template <class T, class C>
+void cpu_amg<T, C>::smooth (const level &l_arg, const T *b, T *x, bool zero_initial, bool keep_residual) const
+{
+  level &l = const_cast<level &> (l_arg);
+
+  const auto spmv = get_cpu_spmv_functions<T, C> ().bcsr_row_major;
+  const bcsr_matrix_class<T, C> &A = l.A;
+  const C bs = A.bs;
+
+  T *r = l.r.get ();
+  T *d = l.d.get ();
+  T *d_next = l.d_next.get ();
+  T *t = l.t.get ();
+
+  /// d_0 = c0 D^-1 r_0; x_k+1 = x_k + d_k; r_k+1 = r_k - A d_k; d_k+1 = alpha d_k + beta D^-1 r_k+1
+  const bool is_chebyshev = settings.smoother == amg_smoother::chebyshev;
+  const T upper = l.lambda_max;
+  const T lower = upper / 30;
+  const T theta = (upper + lower) / 2;
+  const T delta = (upper - lower) / 2;
+  const T sigma = theta / delta;
+  T rho = 1 / sigma;
+
+  const T c0 = is_chebyshev ? 1 / theta : T {4} / (3 * l.lambda_max);
+
+  l.runner.template run<0> ([&] (C first, C last, T *) {
+    if (zero_initial)
+      {
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            r[row] = b[row];
+            x[row] = T {};
+          }
+      }
+    else
+      {
+        spmv (bs, first, last, A.row_ptr.get (), A.columns.get (), A.values.get (), x, t);
+        for (C row = first * bs; row < last * bs; row++)
+          r[row] = b[row] - t[row];
+      }
+
+    l.D.apply (first, last, r, d);
+    for (C row = first * bs; row < last * bs; row++)
+      d[row] *= c0;
+  });
+
+  const unsigned int steps = std::max (settings.sweeps, 1u);
+
+  for (unsigned int step = 1; step <= steps; step++)
+    {
+      const bool is_last = step == steps;
+
+      if (is_last && !keep_residual)
+        {
+          l.runner.template run<0> ([&] (C first, C last, T *) {
+            for (C row = first * bs; row < last * bs; row++)
+              x[row] += d[row];
+          });
+          break;
+        }
+
+      T alpha {};
+      T beta = c0;
+
+      if (is_chebyshev)
+        {
+          const T rho_next = 1 / (2 * sigma - rho);
+          alpha = rho_next * rho;
+          beta = 2 * rho_next / delta;
+          rho = rho_next;
+        }
+
+      l.runner.template run<0> ([&] (C first, C last, T *) {
+        spmv (bs, first, last, A.row_ptr.get (), A.columns.get (), A.values.get (), d, t);
+
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            x[row] += d[row];
+            r[row] -= t[row];
+          }
+
+        if (is_last)
+          return;
+
+        l.D.apply (first, last, r, d_next);
+        for (C row = first * bs; row < last * bs; row++)
+          d_next[row] = alpha * d[row] + beta * d_next[row];
+      });
+
+      std::swap (d, d_next);
+    }
+}
+
+template <class T, class C>
+void cpu_amg<T, C>::cycle (unsigned int level_id, const T *b, T *x) const
+{
+  level &l = *levels[level_id];
+  const auto spmv = get_cpu_spmv_functions<T, C> ().bcsr_row_major;
+
+  if (level_id + 1 == levels.size ())
+    {
+      if (!l.coarse_inverse)
+        {
+          smooth (l, b, x, true, false);
+          return;
+        }
+
+      const T *inverse = l.coarse_inverse.get ();
+      const C n = l.n;
+
+      pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+        const auto [first, last] = thread_range (n, thread_id, threads_count);
+        for (C row = first; row < last; row++)
+          {
+            T sum {};
+            for (C column = 0; column < n; column++)
+              sum += inverse[row * n + column] * b[column];
+            x[row] = sum;
+          }
+      });
+      return;
+    }
+
+  level &coarse = *levels[level_id + 1];
+  const C bs = l.A.bs;
+
+  smooth (l, b, x, true, true);
+
+  /// b_c = R r
+  const bcsr_matrix_class<T, C> &R = *l.R;
+  l.R_runner->template run<0> ([&] (C first, C last, T *) {
+    spmv (bs, first, last, R.row_ptr.get (), R.columns.get (), R.values.get (), l.r.get (), coarse.b.get ());
+  });
+
+  cycle (level_id + 1, coarse.b.get (), coarse.x.get ());
+
+  /// x += P x_c
+  const bcsr_matrix_class<T, C> &P = *l.P;
+  l.runner.template run<0> ([&] (C first, C last, T *) {
+    spmv (bs, first, last, P.row_ptr.get (), P.columns.get (), P.values.get (), coarse.x.get (), l.t.get ());
+    for (C row = first * bs; row < last * bs; row++)
+      x[row] += l.t[row];
+  });
+
+  smooth (l, b, x, false, false);
+}
+
+#define INSTANTIATE(DTYPE,ITYPE) \
+  template class cpu_amg<DTYPE, ITYPE>;
+
+INSTANTIATE (float,  int)
+INSTANTIATE (double, int)
+INSTANTIATE (float,  std::int64_t)
+INSTANTIATE (double, std::int64_t)
+
+#undef INSTANTIATE
@@ -0,0 +1,83 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_AMG_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_AMG_H
+
+#include <memory>
+#include <vector>
+
+#include "cpu_preconditioners.h"
+#include "matrix_converters.h"
+#include "thread_pool.h"
+
+enum class amg_smoother
+{
+  jacobi,    ///< Damped block-Jacobi, weight 4 / (3 lambda_max)
+  chebyshev  ///< Chebyshev polynomial in D^-1 A on [lambda_max / 30, lambda_max]
+};
+
+class amg_settings
+{
+public:
+  amg_smoother smoother = amg_smoother::jacobi;
+  unsigned int sweeps = 1;              ///< Pre- and post-smoothing steps, degree of polynomial for Chebyshev
+  double strength_threshold = 0.08;     ///< Nodes i, j are strongly coupled if |A_ij| > threshold sqrt (|A_ii| |A_jj|), Frobenius norms
+  unsigned int max_levels = 10;
+  unsigned int coarse_rows = 128;       ///< Block rows at which coarsening stops, coarsest level is solved by dense inverse
+};
+
+/**
+ * @brief Smoothed aggregation algebraic multigrid V-cycle on BCSR matrices
+ *
+ * Aggregation works on the graph of blocks, so all bs unknowns of a node go
+ * to the same aggregate and coarse matrices keep bs x bs blocks. Tentative
+ * prolongator maps aggregate unknowns to unknowns of its nodes with identity
+ * blocks (translations of the bridge nodes) and is smoothed with one
+ * block-Jacobi step. Coarse matrices are R A P with R = P^T, so the
+ * preconditioner is symmetric and works with CG too.
+ *
+ * Strength of connection, smoothing of prolongator, products R A P, diagonal
+ * inversion and bound of the spectrum of D^-1 A (infinity norm) run on the thread pool;
+ * only aggregation itself is sequential. In the cycle, every smoothing step,
+ * restriction and prolongation is one pass with the BCSR SpMV kernel of
+ * the active ISA (row major storage) over block rows balanced by nonzeros.
+ * Smoothing uses residual recurrence r -= A d, so x is updated in place and
+ * pre-smoothing leaves the residual that is restricted.
+ */
+template <class T, class C>
+class cpu_amg : public cpu_preconditioner<T, C>
+{
+public:
+  /// A should outlive preconditioner
+  cpu_amg (const bcsr_matrix_class<T, C> &A, thread_pool &pool, amg_settings settings = {});
+  ~cpu_amg () override;
+
+  C size () const override;
+  void apply (const T *r, T *z) const override;
+
+  unsigned int levels_count () const { return static_cast<unsigned int> (levels.size ()); }
+
+  /// Block rows of level
+  C level_rows (unsigned int level_id) const;
+
+  /// Nonzero blocks of all levels over ones of A
+  double operator_complexity () const;
+
+private:
+  class level;
+
+  void cycle (unsigned int level_id, const T *b, T *x) const;
+
+  /// x += smoother (b - A x), r is left with b - A x if keep_residual is set
+  void smooth (const level &l, const T *b, T *x, bool zero_initial, bool keep_residual) const;
+
+private:
+  thread_pool &pool;
+  const amg_settings settings;
+
+  std::vector<std::unique_ptr<level>> levels;
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_AMG_H
@@ -0,0 +1,261 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_batched_cg.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+
+constexpr int chunk_units = 64;
+
+}
+
+template <class T, class C>
+cpu_batched_cg<T, C>::cpu_batched_cg (const cpu_linear_operator<T, C> &A, bool use_precond, thread_pool &pool_arg, unsigned int max_systems_arg)
+  : n_rows (A.size ())
+  , bs (A.unit_rows ())
+  , max_systems (max_systems_arg)
+  , runner (pool_arg, A.partition (pool_arg.size ()))
+  , x (new T[n_rows * max_systems])
+  , r (new T[n_rows * max_systems])
+  , p (new T[n_rows * max_systems])
+  , q (new T[n_rows * max_systems])
+  , solutions (new T[n_rows * max_systems])
+{
+  if (max_systems == 0)
+    throw std::runtime_error ("Error! Batch should have at least one system");
+
+  if (use_precond)
+    {
+      P.reset (new T[n_rows]);
+      z.reset (new T[n_rows * max_systems]);
+    }
+
+  /// First touch by the thread that owns rows
+  run (0, [&] (C first, C last, T *) {
+    for (T *vector: { x.get (), r.get (), p.get (), q.get (), z.get (), solutions.get () })
+      if (vector)
+        std::fill (vector + first * bs * max_systems, vector + last * bs * max_systems, T {});
+    if (P)
+      std::fill (P.get () + first * bs, P.get () + last * bs, T {});
+  });
+}
+
+template <class T, class C>
+T *cpu_batched_cg<T, C>::solve (const cpu_linear_operator<T, C> &A, const T *b, unsigned int k, T epsilon, unsigned int max_iterations)
+{
+  if (k == 0 || k > max_systems)
+    throw std::runtime_error ("Error! Batch size should be in [1, " + std::to_string (max_systems) + "]");
+
+  T *x = this->x.get ();
+  T *r = this->r.get ();
+  T *p = this->p.get ();
+  T *q = this->q.get ();
+  T *P = this->P.get ();
+  T *z = P ? this->z.get () : r;
+  T *solutions = this->solutions.get ();
+
+  /// Column j of the batch holds system ids[j], first active columns are iterated
+  std::vector<unsigned int> ids (k);
+  std::vector<T> norm_b (k);
+  std::vector<T> rz (k);
+  std::vector<T> alpha (k);
+  std::vector<T> beta (k);
+  std::vector<unsigned int> kept;
+  std::vector<unsigned int> finished;
+
+  for (unsigned int j = 0; j < k; j++)
+    ids[j] = j;
+
+  iterations.assign (k, 0);
+  relative_residuals.assign (k, T {});
+
+  if (monitor)
+    monitor->start ("batched-cg", { "active" }, max_iterations);
+
+  /// Jacobi preconditioner; r0 = b (x0 = 0), z0 = M^-1 r0, p0 = z0; (b, b), (r0, z0)
+  const T *initial_sums = run (2 * k, [&] (C first, C last, T *thread_sums) {
+    if (P)
+      {
+        A.diagonal (first, last, P);
+        for (C row = first * bs; row < last * bs; row++)
+          P[row] = std::abs (P[row]) < 1e-20 ? 1.0 : 1.0 / P[row];
+      }
+
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        const T precond = P ? P[row] : T {1};
+
+        for (unsigned int j = 0; j < k; j++)
+          {
+            const C id = row * k + j;
+            const T b_row = b[j * n_rows + row];
+
+            x[id] = T {};
+            r[id] = b_row;
+            z[id] = precond * b_row;
+            p[id] = z[id];
+
+            thread_sums[j] += b_row * b_row;
+            thread_sums[k + j] += b_row * z[id];
+          }
+      }
+  });
+
+  for (unsigned int j = 0; j < k; j++)
+    {
+      norm_b[j] = std::sqrt (initial_sums[j]);
+      rz[j] = initial_sums[k + j];
+    }
+
+  unsigned int active = k;
+
+  for (unsigned int i = 0; i < max_iterations && active > 0; )
+    {
+      i++;
+
+      /// q = A p; (p, q) over chunks of units, while their rows of p and q are in cache; single system takes fused kernel
+      const T *pq = run (active, [&] (C first, C last, T *thread_sums) {
+        if (k == 1)
+          {
+            thread_sums[0] = A.apply_dot (first, last, p, q);
+            return;
+          }
+
+        for (C chunk = first; chunk < last; chunk += chunk_units)
+          {
+            const C chunk_end = std::min<C> (chunk + chunk_units, last);
+            A.apply_multiple (chunk, chunk_end, active, k, p, q);
+
+            for (C row = chunk * bs; row < chunk_end * bs; row++)
+              for (unsigned int j = 0; j < active; j++)
+                thread_sums[j] += p[row * k + j] * q[row * k + j];
+          }
+      });
+
+      /// Zero right hand side keeps x0 = 0
+      for (unsigned int j = 0; j < active; j++)
+        alpha[j] = norm_b[j] > T {} ? rz[j] / pq[j] : T {};
+
+      /// x += alpha p; r -= alpha q; z = M^-1 r; (r, z), (r, r)
+      const T *rz_rr = run (2 * active, [&] (C first, C last, T *thread_sums) {
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            const T precond = P ? P[row] : T {1};
+
+            for (unsigned int j = 0; j < active; j++)
+              {
+                const C id = row * k + j;
+
+                x[id] += alpha[j] * p[id];
+                r[id] -= alpha[j] * q[id];
+                if (P)
+                  z[id] = precond * r[id];
+
+                thread_sums[j] += r[id] * z[id];
+                thread_sums[active + j] += r[id] * r[id];
+              }
+          }
+      });
+
+      kept.clear ();
+      finished.clear ();
+
+      T max_residual {};
+
+      for (unsigned int j = 0; j < active; j++)
+        {
+          const T norm_r = std::sqrt (rz_rr[active + j]);
+          const T residual = norm_b[j] > T {} ? norm_r / norm_b[j] : T {};
+
+          iterations[ids[j]] = i;
+          relative_residuals[ids[j]] = residual;
+          max_residual = std::max (max_residual, residual);
+
+          /// Breakdown of one system doesn't stop the others
+          if (residual < epsilon || !std::isfinite (norm_r) || i == max_iterations)
+            {
+              finished.push_back (j);
+            }
+          else
+            {
+              beta[j] = rz_rr[j] / rz[j];
+              rz[j] = rz_rr[j];
+              kept.push_back (j);
+            }
+        }
+
+      if (monitor)
+        monitor->record (max_residual, { static_cast<double> (active) });
+
+      /// p = z + beta p; solutions of finished systems are copied out, columns of the rest are compacted
+      const unsigned int kept_count = static_cast<unsigned int> (kept.size ());
+      const bool compact = !finished.empty () && finished.front () < kept_count;
+
+      run (0, [&] (C first, C last, T *) {
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            for (unsigned int j: finished)
+              solutions[ids[j] * n_rows + row] = x[row * k + j];
+
+            if (compact)
+              {
+                for (unsigned int j = 0; j < kept_count; j++)
+                  {
+                    const C to = row * k + j;
+                    const C from = row * k + kept[j];
+
+                    p[to] = z[from] + beta[kept[j]] * p[from];
+                    x[to] = x[from];
+                    r[to] = r[from];
+                  }
+              }
+            else
+              {
+                for (unsigned int j = 0; j < kept_count; j++)
+                  p[row * k + j] = z[row * k + j] + beta[j] * p[row * k + j];
+              }
+          }
+      });
+
+      for (unsigned int j = 0; j < kept.size (); j++)
+        {
+          ids[j] = ids[kept[j]];
+          norm_b[j] = norm_b[kept[j]];
+          rz[j] = rz[kept[j]];
+        }
+
+      active = kept_count;
+    }
+
+  /// Without iterations (max_iterations = 0) solution is x0
+  if (active > 0)
+    {
+      run (0, [&] (C first, C last, T *) {
+        for (C row = first * bs; row < last * bs; row++)
+          for (unsigned int j = 0; j < active; j++)
+            solutions[ids[j] * n_rows + row] = x[row * k + j];
+      });
+    }
+
+  if (monitor)
+    monitor->finish ();
+
+  return solutions;
+}
+
+#define INSTANTIATE(DTYPE,ITYPE) \
+  template class cpu_batched_cg<DTYPE, ITYPE>;
+
+INSTANTIATE (float,  int)
+INSTANTIATE (double, int)
+INSTANTIATE (float,  std::int64_t)
+INSTANTIATE (double, std::int64_t)
+
+#undef INSTANTIATE
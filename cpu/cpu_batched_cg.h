@@ -0,0 +1,77 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_BATCHED_CG_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_BATCHED_CG_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cpu_linear_operator.h"
+#include "cpu_row_runner.h"
+#include "solver_monitor.h"
+#include "thread_pool.h"
+
+/**
+ * @brief Jacobi preconditioned CG for k systems with the same matrix (load cases), solved together
+ *
+ * Vectors of all systems are interleaved (element i of system j is at
+ * i * k + j), so every iteration reads the matrix once for the whole batch
+ * in cpu_linear_operator::apply_multiple and vector updates run over
+ * contiguous rows of k elements. Iteration takes the same three passes as
+ * cpu_cg, each reduction returns a sum per system.
+ *
+ * A system leaves the batch when it converges: its solution is copied out
+ * and columns of remaining systems are compacted in the pass that updates
+ * search directions, so the following SpMVs work on fewer columns.
+ */
+template <class T, class C=std::size_t>
+class cpu_batched_cg
+{
+public:
+  cpu_batched_cg () = delete;
+  cpu_batched_cg (const cpu_linear_operator<T, C> &A, bool use_precond, thread_pool &pool, unsigned int max_systems);
+
+  /**
+   * Right hand sides of k <= max_systems systems are stored one after
+   * another in b. Returns solutions in the same layout, which stay valid
+   * until the next call or destruction of solver.
+   */
+  T *solve (const cpu_linear_operator<T, C> &A, const T *b, unsigned int k, T epsilon, unsigned int max_iterations);
+
+  /// Of the last solve, per system
+  const std::vector<unsigned int> &get_iterations () const { return iterations; }
+  const std::vector<T> &get_relative_residuals () const { return relative_residuals; }
+
+  /// Monitor records the largest residual of active systems, should outlive solver
+  void set_monitor (solver_monitor *monitor_arg) { monitor = monitor_arg; }
+
+private:
+  /// Sums per system, so their count is known at runtime only
+  template <typename action_type>
+  const T *run (unsigned int sums_count, const action_type &action) { return runner.run (sums_count, action); }
+
+private:
+  const C n_rows = 0;  ///< Scalar rows
+  const C bs = 0;      ///< Scalar rows of operator unit
+  const unsigned int max_systems = 0;
+
+  cpu_row_runner<T, C> runner;  ///< Units of each thread from partition of A
+
+  std::vector<unsigned int> iterations;
+  std::vector<T> relative_residuals;
+  solver_monitor *monitor = nullptr;
+
+  std::unique_ptr<T[]> x;
+  std::unique_ptr<T[]> r;
+  std::unique_ptr<T[]> p;
+  std::unique_ptr<T[]> q;  ///< A p
+  std::unique_ptr<T[]> z;  ///< M^-1 r, alias of r without preconditioner
+  std::unique_ptr<T[]> P;  ///< Inverted diagonal, one for all systems
+
+  std::unique_ptr<T[]> solutions;
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_BATCHED_CG_H
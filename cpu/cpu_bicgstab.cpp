@@ -0,0 +1,509 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_bicgstab.h"
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+template <class T, class C>
+cpu_bicgstab<T, C>::cpu_bicgstab (
+  const cpu_linear_operator<T, C> &A,
+  bool use_precond,
+  thread_pool &pool_arg,
+  bicgstab_variant variant_arg)
+  : cpu_bicgstab (A, use_precond, nullptr, pool_arg, variant_arg)
+{
+}
+
+template <class T, class C>
+cpu_bicgstab<T, C>::cpu_bicgstab (
+  const cpu_linear_operator<T, C> &A,
+  const cpu_preconditioner<T, C> &precond_arg,
+  thread_pool &pool_arg,
+  bicgstab_variant variant_arg)
+  : cpu_bicgstab (A, false, &precond_arg, pool_arg, variant_arg)
+{
+}
+
+template <class T, class C>
+cpu_bicgstab<T, C>::cpu_bicgstab (
+  const cpu_linear_operator<T, C> &A,
+  bool use_precond,
+  const cpu_preconditioner<T, C> *precond_arg,
+  thread_pool &pool_arg,
+  bicgstab_variant variant_arg)
+  : variant (variant_arg)
+  , precond (precond_arg)
+  , block_jacobi (dynamic_cast<const cpu_block_jacobi<T, C> *> (precond_arg))
+  , n_rows (A.size ())
+  , bs (A.unit_rows ())
+  , runner (pool_arg, A.partition (pool_arg.size ()))
+  , x (new T[n_rows])
+  , r (new T[n_rows])
+  , v (new T[n_rows])
+  , p (new T[n_rows])
+  , s (new T[n_rows])
+  , t (new T[n_rows])
+  , rh (new T[n_rows])
+{
+  const bool is_pipelined = variant == bicgstab_variant::pipelined;
+
+  if (precond && precond->size () != n_rows)
+    throw std::runtime_error ("Error! Preconditioner size doesn't match matrix");
+  if (block_jacobi && block_jacobi->get_block_size () != bs)
+    block_jacobi = nullptr;
+
+  if (use_precond)
+    P.reset (new T[n_rows]);
+
+  if (use_precond || precond || is_pipelined)
+    {
+      q.reset (new T[n_rows]);
+      z.reset (new T[n_rows]);
+    }
+
+  if (is_pipelined)
+    {
+      w.reset (new T[n_rows]);
+      y.reset (new T[n_rows]);
+
+      if (use_precond || precond)
+        {
+          m.reset (new T[n_rows]);
+          mw.reset (new T[n_rows]);
+        }
+    }
+  else
+    {
+      h.reset (new T[n_rows]);
+    }
+
+  /// First touch by the thread that owns rows
+  run<0> ([&] (C first, C last, T *) {
+    for (T *vector: { x.get (), r.get (), v.get (), p.get (), h.get (), s.get (), t.get (), rh.get (), P.get (), q.get (), z.get (), w.get (), y.get (), m.get (), mw.get () })
+      if (vector)
+        std::fill (vector + first * bs, vector + last * bs, T {});
+  });
+}
+
+template <class T, class C>
+T *cpu_bicgstab<T, C>::solve (const cpu_linear_operator<T, C> &A, const T* b, T epsilon, unsigned int max_iterations)
+{
+  iterations = 0;
+  relative_residual = T {};
+
+  if (monitor)
+    monitor->start (variant == bicgstab_variant::pipelined ? "pbicgstab" : "bicgstab",
+                    { "rho", "beta", "alpha", "omega", "ts", "tt" }, max_iterations);
+
+  T *solution = variant == bicgstab_variant::pipelined
+              ? solve_pipelined (A, b, epsilon, max_iterations)
+              : solve_classic (A, b, epsilon, max_iterations);
+
+  if (monitor)
+    monitor->finish ();
+
+  return solution;
+}
+
+template <class T, class C>
+T *cpu_bicgstab<T, C>::solve_classic (const cpu_linear_operator<T, C> &A, const T* b, T epsilon, unsigned int max_iterations)
+{
+  T *x = this->x.get ();
+  T *r = this->r.get ();
+  T *v = this->v.get ();
+  T *p = this->p.get ();
+  T *h = this->h.get ();
+  T *s = this->s.get ();
+  T *t = this->t.get ();
+  T *rh = this->rh.get ();
+  T *P = this->P.get ();
+
+  /// Without preconditioner q and z are aliases of p and s
+  T *q = P || precond ? this->q.get () : p;
+  T *z = P || precond ? this->z.get () : s;
+
+  const bool is_local_precond = !precond || block_jacobi;
+
+  /// dst = M^-1 src on rows of thread, if preconditioner allows that
+  auto local_precond = [&] (C first, C last, const T *src, T *dst) {
+    if (P)
+      for (C row = first * bs; row < last * bs; row++)
+        dst[row] = P[row] * src[row];
+    else if (block_jacobi)
+      block_jacobi->apply (first, last, src, dst);
+  };
+
+  /// 0 - Jacobi preconditioner, clear arrays
+  /// 1 - r0 = b - A * x0 (x0 = 0 => r0 = b), (b, b) = (rh0, r0)
+  const auto [b_norm_square] = run<1> ([&] (C first, C last, T *sums) {
+    T bb {};
+
+    if (P)
+      A.diagonal (first, last, P);
+
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        if (P)
+          P[row] = std::abs (P[row]) < 1e-20 ? 1.0 : 1.0 / P[row];
+
+        x[row] = v[row] = p[row] = T {};
+        rh[row] = r[row] = b[row];
+        bb += b[row] * b[row];
+      }
+
+    sums[0] = bb;
+  });
+
+  const T norm_b = std::sqrt (b_norm_square);
+
+  T rho = b_norm_square;
+  T rho_prev = 1.0;
+  T omega = 1.0;
+  T alpha = 1.0;
+
+  for (unsigned int i = 0; i < max_iterations; )
+    {
+      i++;
+
+      /// 2 - beta = ...; 3 - pi = rp + beta (pp - omega * vp); q = M^-1 pi
+      const T beta = rho / rho_prev * alpha / omega;
+
+      run<0> ([&] (C first, C last, T *) {
+        for (C row = first * bs; row < last * bs; row++)
+          p[row] = r[row] + beta * (p[row] - omega * v[row]);
+
+        if (is_local_precond)
+          local_precond (first, last, p, q);
+      });
+
+      if (!is_local_precond)
+        precond->apply (p, q);
+
+      /// 4 - vi = A q; 5 - (rh0, vi)
+      const auto [rh_vi_prod] = run<1> ([&] (C first, C last, T *sums) {
+        T rh_v {};
+
+        A.apply (first, last, q, v);
+        for (C row = first * bs; row < last * bs; row++)
+          rh_v += rh[row] * v[row];
+
+        sums[0] = rh_v;
+      });
+
+      alpha = rho / rh_vi_prod;
+
+      /// 6 - h = xp + alpha * q; 7 - s = rp - alpha * vi; z = M^-1 s
+      run<0> ([&] (C first, C last, T *) {
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            h[row] = x[row] + alpha * q[row];
+            s[row] = r[row] - alpha * v[row];
+          }
+
+        if (is_local_precond)
+          local_precond (first, last, s, z);
+      });
+
+      if (!is_local_precond)
+        precond->apply (s, z);
+
+      /// 8 - t = A z; 9 - (t, s), (t, t)
+      const auto [ts, tt] = run<2> ([&] (C first, C last, T *sums) {
+        T ts_sum {};
+        T tt_sum {};
+
+        A.apply (first, last, z, t);
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            ts_sum += t[row] * s[row];
+            tt_sum += t[row] * t[row];
+          }
+
+        sums[0] = ts_sum;
+        sums[1] = tt_sum;
+      });
+
+      omega = ts / tt;
+
+      /// 10 - ri = s - omegai * t; 11 - xi = h + omegai * z
+      /// 12 - (ri, ri) for norm and (rh0, ri) = rho of the next iteration
+      const auto [rr, rh_r] = run<2> ([&] (C first, C last, T *sums) {
+        T rr_sum {};
+        T rh_r_sum {};
+
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            const T residual = s[row] - omega * t[row];
+
+            r[row] = residual;
+            x[row] = h[row] + omega * z[row];
+
+            rr_sum += residual * residual;
+            rh_r_sum += rh[row] * residual;
+          }
+
+        sums[0] = rr_sum;
+        sums[1] = rh_r_sum;
+      });
+
+      rho_prev = rho;
+      rho = rh_r;
+
+      const T norm_r = std::sqrt (rr);
+
+      if (monitor)
+        monitor->record (norm_r / norm_b, { rho_prev, beta, alpha, omega, ts, tt });
+
+      iterations = i;
+      relative_residual = norm_r / norm_b;
+
+      if (norm_r / norm_b < epsilon) break;
+
+      /// Unlike gpu_bicgstab, don't spend the rest of iterations on NaN
+      if (!std::isfinite (norm_r))
+        {
+          std::cout << "Breakdown at iteration " << i << std::endl;
+          break;
+        }
+    }
+
+  return x;
+}
+
+template <class T, class C>
+T *cpu_bicgstab<T, C>::solve_pipelined (const cpu_linear_operator<T, C> &A, const T* b, T epsilon, unsigned int max_iterations)
+{
+  T *x = this->x.get ();
+  T *r = this->r.get ();
+  T *rh = this->rh.get ();
+  T *w = this->w.get ();
+  T *t = this->t.get ();
+  T *p = this->p.get ();
+  T *s = this->s.get ();
+  T *z = this->z.get ();
+  T *q = this->q.get ();
+  T *y = this->y.get ();
+  T *v = this->v.get ();
+  T *P = this->P.get ();
+
+  /// Right preconditioning: solve (A M^-1) u = b, x = M^-1 u. SpMV inputs are r, w, z or M^-1 of them in m, mw
+  const bool has_precond = P || precond;
+  const bool is_local_precond = !precond || block_jacobi;
+
+  T *mr = has_precond ? this->m.get () : r;
+  T *mw = has_precond ? this->mw.get () : w;
+  T *mz = has_precond ? this->m.get () : z;
+
+  /// dst = M^-1 src on rows of thread, if preconditioner allows that
+  auto local_precond = [&] (C first, C last, const T *src, T *dst) {
+    if (P)
+      for (C row = first * bs; row < last * bs; row++)
+        dst[row] = P[row] * src[row];
+    else if (block_jacobi)
+      block_jacobi->apply (first, last, src, dst);
+  };
+
+  /// Preconditioners that need the whole vector take a pass of their own
+  auto global_precond = [&] (const T *src, T *dst) {
+    if (!is_local_precond)
+      precond->apply (src, dst);
+  };
+
+  /// r0 = b (x0 = 0), M^-1 r0
+  run<0> ([&] (C first, C last, T *) {
+    if (P)
+      A.diagonal (first, last, P);
+
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        if (P)
+          P[row] = std::abs (P[row]) < 1e-20 ? 1.0 : 1.0 / P[row];
+
+        x[row] = T {};
+        rh[row] = r[row] = b[row];
+      }
+
+    if (is_local_precond)
+      local_precond (first, last, r, mr);
+  });
+
+  global_precond (r, mr);
+
+  /// w0 = A M^-1 r0, M^-1 w0, (rh0, r0), (rh0, w0)
+  const auto [rh_r0, rh_w0] = run<2> ([&] (C first, C last, T *sums) {
+    T rh_r {};
+    T rh_w {};
+
+    A.apply (first, last, mr, w);
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        rh_r += rh[row] * r[row];
+        rh_w += rh[row] * w[row];
+      }
+
+    if (is_local_precond)
+      local_precond (first, last, w, mw);
+
+    sums[0] = rh_r;
+    sums[1] = rh_w;
+  });
+
+  global_precond (w, mw);
+
+  const T norm_b = std::sqrt (rh_r0);
+
+  T rho = rh_r0;
+  T alpha = rh_r0 / rh_w0;
+  T omega = 1.0;
+  T beta = 0.0;
+
+  /// t0 = A M^-1 w0; p0 = r0, s0 = w0, z0 = t0, M^-1 z0; q0 = r0 - alpha s0, y0 = w0 - alpha z0; (q0, y0), (y0, y0)
+  auto [qy, yy] = run<2> ([&] (C first, C last, T *sums) {
+    T qy_sum {};
+    T yy_sum {};
+
+    A.apply (first, last, mw, t);
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        p[row] = r[row];
+        s[row] = w[row];
+        z[row] = t[row];
+        q[row] = r[row] - alpha * s[row];
+        y[row] = w[row] - alpha * z[row];
+        v[row] = T {};
+
+        qy_sum += q[row] * y[row];
+        yy_sum += y[row] * y[row];
+      }
+
+    if (is_local_precond)
+      local_precond (first, last, z, mz);
+
+    sums[0] = qy_sum;
+    sums[1] = yy_sum;
+  });
+
+  global_precond (z, mz);
+
+  for (unsigned int i = 0; i < max_iterations; )
+    {
+      i++;
+
+      omega = qy / yy;
+
+      /// v = A M^-1 z; x += alpha p + omega q; r = q - omega y; w = y - omega (t - alpha v), M^-1 w
+      /// (rh0, r), (rh0, w), (rh0, s), (rh0, z), (r, r)
+      const auto [rh_r, rh_w, rh_s, rh_z, rr] = run<5> ([&] (C first, C last, T *sums) {
+        T rh_r_sum {};
+        T rh_w_sum {};
+        T rh_s_sum {};
+        T rh_z_sum {};
+        T rr_sum {};
+
+        A.apply (first, last, mz, v);
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            x[row] += alpha * p[row] + omega * q[row];
+            r[row] = q[row] - omega * y[row];
+            w[row] = y[row] - omega * (t[row] - alpha * v[row]);
+
+            rh_r_sum += rh[row] * r[row];
+            rh_w_sum += rh[row] * w[row];
+            rh_s_sum += rh[row] * s[row];
+            rh_z_sum += rh[row] * z[row];
+            rr_sum += r[row] * r[row];
+          }
+
+        if (is_local_precond)
+          local_precond (first, last, w, mw);
+
+        sums[0] = rh_r_sum;
+        sums[1] = rh_w_sum;
+        sums[2] = rh_s_sum;
+        sums[3] = rh_z_sum;
+        sums[4] = rr_sum;
+      });
+
+      const T norm_r = std::sqrt (rr);
+
+      if (monitor)
+        monitor->record (norm_r / norm_b, { rho, beta, alpha, omega, qy, yy });
+
+      iterations = i;
+      relative_residual = norm_r / norm_b;
+
+      if (norm_r / norm_b < epsilon) break;
+
+      /// Unlike gpu_bicgstab, don't spend the rest of iterations on NaN
+      if (!std::isfinite (norm_r))
+        {
+          std::cout << "Breakdown at iteration " << i << std::endl;
+          break;
+        }
+
+      global_precond (w, mw);
+
+      beta = alpha / omega * rh_r / rho;
+      rho = rh_r;
+      alpha = rh_r / (rh_w + beta * rh_s - beta * omega * rh_z);
+
+      /// t = A M^-1 w; p = r + beta (p - omega s); s = w + beta (s - omega z); z = t + beta (z - omega v), M^-1 z
+      /// q = r - alpha s; y = w - alpha z; (q, y), (y, y)
+      const auto [qy_next, yy_next] = run<2> ([&] (C first, C last, T *sums) {
+        T qy_sum {};
+        T yy_sum {};
+
+        A.apply (first, last, mw, t);
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            const T s_row = w[row] + beta * (s[row] - omega * z[row]);
+            const T z_row = t[row] + beta * (z[row] - omega * v[row]);
+
+            p[row] = r[row] + beta * (p[row] - omega * s[row]);
+            s[row] = s_row;
+            z[row] = z_row;
+            q[row] = r[row] - alpha * s_row;
+            y[row] = w[row] - alpha * z_row;
+
+            qy_sum += q[row] * y[row];
+            yy_sum += y[row] * y[row];
+          }
+
+        if (is_local_precond)
+          local_precond (first, last, z, mz);
+
+        sums[0] = qy_sum;
+        sums[1] = yy_sum;
+      });
+
+      global_precond (z, mz);
+
+      qy = qy_next;
+      yy = yy_next;
+    }
+
+  if (has_precond)
+    {
+      T *m = this->m.get ();
+
+      if (is_local_precond)
+        run<0> ([&] (C first, C last, T *) { local_precond (first, last, x, m); });
+      else
+        precond->apply (x, m);
+
+      std::swap (this->x, this->m);
+      x = this->x.get ();
+    }
+
+  return x;
+}
+
+template class cpu_bicgstab<float,  int>;
+template class cpu_bicgstab<double, int>;
+template class cpu_bicgstab<float,  std::int64_t>;
+template class cpu_bicgstab<double, std::int64_t>;
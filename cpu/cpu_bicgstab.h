@@ -0,0 +1,125 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_BICGSTAB_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_BICGSTAB_H
+
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cpu_linear_operator.h"
+#include "cpu_preconditioners.h"
+#include "cpu_row_runner.h"
+#include "solver_monitor.h"
+#include "thread_pool.h"
+
+enum class bicgstab_variant
+{
+  classic,   ///< Same steps as gpu_bicgstab, five passes and reductions per iteration
+  pipelined  ///< p-BiCGStab (Cools, Vanroose), two passes per iteration, each one SpMV fused with updates and reduction
+};
+
+/**
+ * @brief BiCGStab with optional Jacobi preconditioner on CPU, counterpart of gpu_bicgstab
+ *
+ * Every iteration takes five passes over memory instead of one per vector
+ * operation: update steps that gpu_bicgstab groups into kernels are fused
+ * into single loops together with the dot products that follow them
+ * (SpMV with (rh, v) and with (t, s), (t, t); residual update with (r, r)
+ * and next rho). Threads of pool keep the same rows in all passes, so with
+ * first touch in constructor each thread works on memory of its NUMA node.
+ *
+ * Pipelined variant adds two recurrences (w = A r, t = A w) so that SpMV
+ * doesn't depend on dot products of the same step: the SpMV pass also
+ * updates vectors with scalars reduced after the previous pass and computes
+ * dot products for the next one. Every iteration then has two barriers
+ * instead of five at the cost of more vector traffic. It solves
+ * (A M^-1) u = b, x = M^-1 u with preconditioner.
+ *
+ * Preconditioners local to units of the operator (Jacobi, cpu_block_jacobi
+ * with block size of units) are applied in the passes that produce inputs of
+ * SpMV. Others take separate passes: classic variant applies M^-1 to p and s,
+ * pipelined one before each SpMV.
+ *
+ * As in cpu_cg, SpMV runs the kernels of the active ISA level and fused
+ * vector loops are compiled for the base level.
+ */
+template <class T, class C=std::size_t>
+class cpu_bicgstab
+{
+public:
+  cpu_bicgstab () = delete;
+  cpu_bicgstab (
+    const cpu_linear_operator<T, C> &A,
+    bool use_precond,
+    thread_pool &pool,
+    bicgstab_variant variant = bicgstab_variant::classic);
+
+  /// Preconditioner should outlive solver
+  cpu_bicgstab (
+    const cpu_linear_operator<T, C> &A,
+    const cpu_preconditioner<T, C> &precond,
+    thread_pool &pool,
+    bicgstab_variant variant = bicgstab_variant::classic);
+
+  /// Returns solution, which stays valid until the next call or destruction of solver
+  T *solve (const cpu_linear_operator<T, C> &A, const T* b, T epsilon, unsigned int max_iterations);
+
+  /// Of the last solve
+  unsigned int get_iterations () const { return iterations; }
+  T get_relative_residual () const { return relative_residual; }
+
+  /// Monitor should outlive solver, null stops recording
+  void set_monitor (solver_monitor *monitor_arg) { monitor = monitor_arg; }
+
+private:
+  cpu_bicgstab (
+    const cpu_linear_operator<T, C> &A,
+    bool use_precond,
+    const cpu_preconditioner<T, C> *precond,
+    thread_pool &pool,
+    bicgstab_variant variant);
+
+  T *solve_classic (const cpu_linear_operator<T, C> &A, const T* b, T epsilon, unsigned int max_iterations);
+  T *solve_pipelined (const cpu_linear_operator<T, C> &A, const T* b, T epsilon, unsigned int max_iterations);
+
+  template <int sums_count, typename action_type>
+  std::array<T, sums_count> run (const action_type &action) { return runner.template run<sums_count> (action); }
+
+private:
+  const bicgstab_variant variant;
+  const cpu_preconditioner<T, C> *precond = nullptr;
+  const cpu_block_jacobi<T, C> *block_jacobi = nullptr;  ///< precond, if it can be fused
+  const C n_rows = 0;  ///< Scalar rows
+  const C bs = 0;      ///< Scalar rows of operator unit
+
+  unsigned int iterations {};
+  T relative_residual {};
+  solver_monitor *monitor = nullptr;
+
+  cpu_row_runner<T, C> runner;  ///< Units of each thread from partition of A
+
+  std::unique_ptr<T[]> x;
+  std::unique_ptr<T[]> r;
+  std::unique_ptr<T[]> v;
+  std::unique_ptr<T[]> p;
+  std::unique_ptr<T[]> h;
+  std::unique_ptr<T[]> s;
+  std::unique_ptr<T[]> t;
+  std::unique_ptr<T[]> rh;
+
+  std::unique_ptr<T[]> P;  ///< Inverted diagonal
+  std::unique_ptr<T[]> q;  ///< Classic: P p; pipelined: r - alpha s
+  std::unique_ptr<T[]> z;  ///< Classic: P s; pipelined: A s
+
+  /// Pipelined variant only
+  std::unique_ptr<T[]> w;
+  std::unique_ptr<T[]> y;
+  std::unique_ptr<T[]> m;   ///< M^-1 r, M^-1 z (with preconditioner)
+  std::unique_ptr<T[]> mw;  ///< M^-1 w (with preconditioner)
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_BICGSTAB_H
@@ -0,0 +1,231 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_cg.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+template <class T, class C>
+cpu_cg<T, C>::cpu_cg (const cpu_linear_operator<T, C> &A, bool use_precond, thread_pool &pool)
+  : cpu_cg (A, use_precond, nullptr, pool)
+{
+}
+
+template <class T, class C>
+cpu_cg<T, C>::cpu_cg (const cpu_linear_operator<T, C> &A, const cpu_preconditioner<T, C> &precond_arg, thread_pool &pool)
+  : cpu_cg (A, false, &precond_arg, pool)
+{
+}
+
+template <class T, class C>
+cpu_cg<T, C>::cpu_cg (
+  const cpu_linear_operator<T, C> &A,
+  bool use_precond,
+  const cpu_preconditioner<T, C> *precond_arg,
+  thread_pool &pool)
+  : n_rows (A.size ())
+  , bs (A.unit_rows ())
+  , precond (precond_arg)
+  , block_jacobi (dynamic_cast<const cpu_block_jacobi<T, C> *> (precond_arg))
+  , runner (pool, A.partition (pool.size ()))
+  , x (new T[n_rows])
+  , r (new T[n_rows])
+  , p (new T[n_rows])
+  , q (new T[n_rows])
+{
+  if (precond && precond->size () != n_rows)
+    throw std::runtime_error ("Error! Preconditioner size doesn't match matrix");
+  if (block_jacobi && block_jacobi->get_block_size () != bs)
+    block_jacobi = nullptr;
+
+  if (use_precond)
+    P.reset (new T[n_rows]);
+  if (use_precond || precond)
+    z.reset (new T[n_rows]);
+
+  /// First touch by the thread that owns rows
+  run<0> ([&] (C first, C last, T *) {
+    for (T *vector: { x.get (), r.get (), p.get (), q.get (), z.get (), P.get () })
+      if (vector)
+        std::fill (vector + first * bs, vector + last * bs, T {});
+  });
+}
+
+template <class T, class C>
+T *cpu_cg<T, C>::solve (const cpu_linear_operator<T, C> &A, const T* b, T epsilon, unsigned int max_iterations, const T *x0)
+{
+  T *x = this->x.get ();
+  T *r = this->r.get ();
+  T *p = this->p.get ();
+  T *q = this->q.get ();
+  T *P = this->P.get ();
+  T *z = this->z ? this->z.get () : r;
+
+  const bool is_local_precond = !precond || block_jacobi;
+
+  /// z = M^-1 r on rows of thread, if preconditioner allows that
+  auto local_precond = [&] (C first, C last) {
+    if (P)
+      for (C row = first * bs; row < last * bs; row++)
+        z[row] = P[row] * r[row];
+    else if (block_jacobi)
+      block_jacobi->apply (first, last, r, z);
+  };
+
+  iterations = 0;
+  relative_residual = T {};
+
+  if (monitor)
+    monitor->start ("cg", { "rz", "beta", "alpha", "pq" }, max_iterations);
+
+  /// x = x0, SpMV of the next pass reads rows of other threads
+  if (x0)
+    {
+      run<0> ([&] (C first, C last, T *) {
+        if (x0 != x)
+          std::copy (x0 + first * bs, x0 + last * bs, x + first * bs);
+      });
+    }
+
+  /// Jacobi preconditioner from diagonal of A; r0 = b - A x0 (x0 = 0 => r0 = b), z0 = M^-1 r0; (b, b)
+  const auto [b_norm_square] = run<1> ([&] (C first, C last, T *sums) {
+    T bb {};
+
+    if (P)
+      A.diagonal (first, last, P);
+
+    if (x0)
+      A.apply (first, last, x, q);
+
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        if (P)
+          P[row] = std::abs (P[row]) < 1e-20 ? 1.0 : 1.0 / P[row];
+
+        if (!x0)
+          x[row] = T {};
+
+        r[row] = x0 ? b[row] - q[row] : b[row];
+        bb += b[row] * b[row];
+      }
+
+    if (is_local_precond)
+      local_precond (first, last);
+
+    sums[0] = bb;
+  });
+
+  if (!is_local_precond)
+    precond->apply (r, z);
+
+  /// p0 = z0; (r0, z0)
+  auto [rz] = run<1> ([&] (C first, C last, T *sums) {
+    T rz_sum {};
+
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        p[row] = z[row];
+        rz_sum += r[row] * z[row];
+      }
+
+    sums[0] = rz_sum;
+  });
+
+  const T norm_b = std::sqrt (b_norm_square);
+  T beta {};
+
+  for (unsigned int i = 0; i < max_iterations; )
+    {
+      i++;
+
+      /// q = A p; (p, q)
+      const auto [pq] = run<1> ([&] (C first, C last, T *sums) {
+        sums[0] = A.apply_dot (first, last, p, q);
+      });
+
+      const T alpha = rz / pq;
+
+      /// x += alpha p; r -= alpha q; z = M^-1 r; (r, z), (r, r)
+      const auto [rz_next, rr] = run<2> ([&] (C first, C last, T *sums) {
+        T rz_sum {};
+        T rr_sum {};
+
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            x[row] += alpha * p[row];
+            r[row] -= alpha * q[row];
+          }
+
+        if (is_local_precond)
+          local_precond (first, last);
+
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            rz_sum += r[row] * z[row];
+            rr_sum += r[row] * r[row];
+          }
+
+        sums[0] = rz_sum;
+        sums[1] = rr_sum;
+      });
+
+      T rz_new = rz_next;
+
+      if (!is_local_precond)
+        {
+          precond->apply (r, z);
+
+          rz_new = run<1> ([&] (C first, C last, T *sums) {
+            T rz_sum {};
+            for (C row = first * bs; row < last * bs; row++)
+              rz_sum += r[row] * z[row];
+            sums[0] = rz_sum;
+          })[0];
+        }
+
+      const T norm_r = std::sqrt (rr);
+
+      if (monitor)
+        monitor->record (norm_r / norm_b, { rz_new, beta, alpha, pq });
+
+      iterations = i;
+      relative_residual = norm_r / norm_b;
+
+      if (norm_r / norm_b < epsilon) break;
+
+      if (!std::isfinite (norm_r))
+        {
+          std::cout << "Breakdown at iteration " << i << std::endl;
+          break;
+        }
+
+      beta = rz_new / rz;
+      rz = rz_new;
+
+      /// p = z + beta p
+      run<0> ([&] (C first, C last, T *) {
+        for (C row = first * bs; row < last * bs; row++)
+          p[row] = z[row] + beta * p[row];
+      });
+    }
+
+  if (monitor)
+    monitor->finish ();
+
+  return x;
+}
+
+#define INSTANTIATE(DTYPE,ITYPE) \
+  template class cpu_cg<DTYPE, ITYPE>;
+
+INSTANTIATE (float,  int)
+INSTANTIATE (double, int)
+INSTANTIATE (float,  std::int64_t)
+INSTANTIATE (double, std::int64_t)
+
+#undef INSTANTIATE
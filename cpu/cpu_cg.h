@@ -0,0 +1,83 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_CG_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_CG_H
+
+#include <array>
+#include <memory>
+
+#include "cpu_linear_operator.h"
+#include "cpu_preconditioners.h"
+#include "cpu_row_runner.h"
+#include "solver_monitor.h"
+#include "thread_pool.h"
+
+/**
+ * @brief Preconditioned conjugate gradient, for symmetric positive definite systems
+ *
+ * CG needs one SpMV and two reductions per iteration instead of two SpMVs and
+ * four reductions of BiCGStab. Every iteration takes three passes: SpMV with
+ * (p, A p) in the same loop (cpu_linear_operator::apply_dot); x, r updates
+ * with preconditioner and (r, z), (r, r); update of search direction. Threads
+ * own units of the operator (block rows of BCSR) balanced by its partition.
+ *
+ * Preconditioners local to units (Jacobi, cpu_block_jacobi with block size
+ * of units) are fused into the residual update, others take an extra pass for
+ * apply and one for (r, z). Only SpMV goes through the kernels of the active
+ * ISA level, vector loops are bandwidth bound and built for the base one.
+ */
+template <class T, class C=std::size_t>
+class cpu_cg
+{
+public:
+  cpu_cg () = delete;
+  cpu_cg (const cpu_linear_operator<T, C> &A, bool use_precond, thread_pool &pool);
+
+  /// Preconditioner should outlive solver
+  cpu_cg (const cpu_linear_operator<T, C> &A, const cpu_preconditioner<T, C> &precond, thread_pool &pool);
+
+  /**
+   * Starts from x0, or from zero if it's null. Solution of the previous call
+   * may be passed as x0 to warm start a sequence of close systems. Returns
+   * solution, which stays valid until the next call or destruction of solver.
+   */
+  T *solve (const cpu_linear_operator<T, C> &A, const T* b, T epsilon, unsigned int max_iterations, const T *x0 = nullptr);
+
+  /// Of the last solve
+  unsigned int get_iterations () const { return iterations; }
+  T get_relative_residual () const { return relative_residual; }
+
+  /// Monitor should outlive solver, null stops recording
+  void set_monitor (solver_monitor *monitor_arg) { monitor = monitor_arg; }
+
+private:
+  cpu_cg (const cpu_linear_operator<T, C> &A, bool use_precond, const cpu_preconditioner<T, C> *precond, thread_pool &pool);
+
+  template <int sums_count, typename action_type>
+  std::array<T, sums_count> run (const action_type &action) { return runner.template run<sums_count> (action); }
+
+private:
+  const C n_rows = 0;  ///< Scalar rows
+  const C bs = 0;      ///< Scalar rows of operator unit
+
+  const cpu_preconditioner<T, C> *precond = nullptr;
+  const cpu_block_jacobi<T, C> *block_jacobi = nullptr;  ///< precond, if it can be fused
+
+  unsigned int iterations {};
+  T relative_residual {};
+  solver_monitor *monitor = nullptr;
+
+  cpu_row_runner<T, C> runner;  ///< Units of each thread from partition of A
+
+  std::unique_ptr<T[]> x;
+  std::unique_ptr<T[]> r;
+  std::unique_ptr<T[]> p;
+  std::unique_ptr<T[]> q;  ///< A p
+  std::unique_ptr<T[]> z;  ///< M^-1 r, alias of r without preconditioner
+
+  std::unique_ptr<T[]> P;  ///< Inverted diagonal
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_CG_H
@@ -0,0 +1,247 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_chebyshev.h"
+#include "cpu_matrix_multiplier.h"
+#include "cpu_spmv_isa.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+/// Pseudo-random value in [-1, 1) of row (splitmix64 hash), so that vector doesn't depend on partition of rows
+double row_random (std::uint64_t row)
+{
+  std::uint64_t z = row + 0x9e3779b97f4a7c15ull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  z = z ^ (z >> 31);
+
+  return static_cast<double> (z >> 11) / static_cast<double> (1ull << 52) - 1.0;
+}
+
+/// Eigenvalues of symmetric tridiagonal matrix less than x, by signs of Sturm sequence
+template <class T>
+std::size_t eigenvalues_below (const std::vector<T> &diagonal, const std::vector<T> &off_diagonal, T x)
+{
+  std::size_t count = 0;
+  T q = 1;
+
+  for (std::size_t i = 0; i < diagonal.size (); i++)
+    {
+      q = diagonal[i] - x - (i > 0 ? off_diagonal[i - 1] * off_diagonal[i - 1] / q : T {});
+      if (q == T {})
+        q = -std::numeric_limits<T>::epsilon () * (std::abs (diagonal[i]) + std::abs (x) + 1);
+      if (q < T {})
+        count++;
+    }
+
+  return count;
+}
+
+/// k-th smallest eigenvalue of symmetric tridiagonal matrix by bisection of Gershgorin interval
+template <class T>
+T tridiagonal_eigenvalue (const std::vector<T> &diagonal, const std::vector<T> &off_diagonal, std::size_t k)
+{
+  T low = diagonal[0];
+  T high = diagonal[0];
+
+  for (std::size_t i = 0; i < diagonal.size (); i++)
+    {
+      const T radius = (i > 0 ? std::abs (off_diagonal[i - 1]) : T {})
+                     + (i + 1 < diagonal.size () ? std::abs (off_diagonal[i]) : T {});
+      low = std::min (low, diagonal[i] - radius);
+      high = std::max (high, diagonal[i] + radius);
+    }
+
+  for (int step = 0; step < 100; step++)
+    {
+      const T middle = (low + high) / 2;
+      if (eigenvalues_below (diagonal, off_diagonal, middle) > k)
+        high = middle;
+      else
+        low = middle;
+    }
+
+  return (low + high) / 2;
+}
+
+}
+
+template <class T, class C>
+cpu_chebyshev<T, C>::cpu_chebyshev (const bcsr_matrix_class<T, C> &A_arg, thread_pool &pool, chebyshev_settings settings_arg)
+  : A (A_arg)
+  , settings (settings_arg)
+  , n (A_arg.n_rows * A_arg.bs)
+  , D (A_arg, pool)
+  , runner (pool, nnz_balanced_ranges (A_arg.row_ptr.get (), A_arg.n_rows, pool.size ()))
+  , residual (new T[n])
+  , d (new T[n])
+  , d_next (new T[n])
+  , t (new T[n])
+{
+  if (settings.degree == 0)
+    throw std::runtime_error ("Error! Chebyshev degree should be positive");
+
+  const C bs = A.bs;
+  const auto spmv = get_cpu_spmv_functions<T, C> ().bcsr_row_major;
+
+  /// Block-Jacobi CG on pseudo-random b, vectors of apply are reused: r, z = D^-1 r, p, q = A p
+  T *r = residual.get ();
+  T *z = d.get ();
+  T *p = d_next.get ();
+  T *q = t.get ();
+
+  /// First touch by the thread that owns rows, r = b, z = p = D^-1 r; (r, z)
+  auto [rz] = runner.template run<1> ([&] (C first, C last, T *sums) {
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        r[row] = static_cast<T> (row_random (static_cast<std::uint64_t> (row)));
+        q[row] = T {};
+      }
+
+    D.apply (first, last, r, z);
+
+    T rz_sum {};
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        p[row] = z[row];
+        rz_sum += r[row] * z[row];
+      }
+
+    sums[0] = rz_sum;
+  });
+
+  /// Lanczos tridiagonal matrix from CG coefficients
+  std::vector<T> diagonal;
+  std::vector<T> off_diagonal;
+  T previous_alpha {};
+  T previous_beta {};
+
+  for (unsigned int step = 0; step < settings.lanczos_steps; step++)
+    {
+      /// q = A p; (p, q)
+      const auto [pq] = runner.template run<1> ([&] (C first, C last, T *sums) {
+        spmv (bs, first, last, A.row_ptr.get (), A.columns.get (), A.values.get (), p, q);
+
+        T pq_sum {};
+        for (C row = first * bs; row < last * bs; row++)
+          pq_sum += p[row] * q[row];
+        sums[0] = pq_sum;
+      });
+
+      if (!(pq > T {}) || !std::isfinite (pq))
+        break;
+
+      const T alpha = rz / pq;
+
+      diagonal.push_back (1 / alpha + (step > 0 ? previous_beta / previous_alpha : T {}));
+      if (step > 0)
+        off_diagonal.push_back (std::sqrt (previous_beta) / previous_alpha);
+
+      /// r -= alpha q; z = D^-1 r; (r, z)
+      const auto [rz_next] = runner.template run<1> ([&] (C first, C last, T *sums) {
+        for (C row = first * bs; row < last * bs; row++)
+          r[row] -= alpha * q[row];
+
+        D.apply (first, last, r, z);
+
+        T rz_sum {};
+        for (C row = first * bs; row < last * bs; row++)
+          rz_sum += r[row] * z[row];
+        sums[0] = rz_sum;
+      });
+
+      if (!(rz_next > T {}) || !std::isfinite (rz_next))
+        break;
+
+      const T beta = rz_next / rz;
+      rz = rz_next;
+      previous_alpha = alpha;
+      previous_beta = beta;
+
+      /// p = z + beta p
+      runner.template run<0> ([&] (C first, C last, T *) {
+        for (C row = first * bs; row < last * bs; row++)
+          p[row] = z[row] + beta * p[row];
+      });
+    }
+
+  if (diagonal.empty ())
+    throw std::runtime_error ("Error! Chebyshev eigenvalue estimation broke down, matrix isn't positive definite");
+
+  upper = static_cast<T> (settings.upper_safety) * tridiagonal_eigenvalue (diagonal, off_diagonal, diagonal.size () - 1);
+  lower = std::max (tridiagonal_eigenvalue (diagonal, off_diagonal, 0), upper / static_cast<T> (settings.max_condition));
+}
+
+template <class T, class C>
+void cpu_chebyshev<T, C>::apply (const T *r, T *z) const
+{
+  const C bs = A.bs;
+  const auto spmv = get_cpu_spmv_functions<T, C> ().bcsr_row_major;
+
+  T *residual = this->residual.get ();
+  T *d = this->d.get ();
+  T *d_next = this->d_next.get ();
+  T *t = this->t.get ();
+
+  /// d_0 = D^-1 r / theta; z = d_0; r_k+1 = r_k - A d_k; d_k+1 = alpha d_k + beta D^-1 r_k+1; z += d_k+1
+  const T theta = (upper + lower) / 2;
+  const T delta = (upper - lower) / 2;
+  const T sigma = theta / delta;
+  T rho = 1 / sigma;
+
+  runner.template run<0> ([&] (C first, C last, T *) {
+    D.apply (first, last, r, d);
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        d[row] /= theta;
+        z[row] = d[row];
+      }
+  });
+
+  for (unsigned int step = 1; step < settings.degree; step++)
+    {
+      const T rho_next = 1 / (2 * sigma - rho);
+      const T alpha = rho_next * rho;
+      const T beta = 2 * rho_next / delta;
+      rho = rho_next;
+
+      /// Residual of the first step is r, so that r isn't copied
+      const T *previous_residual = step == 1 ? r : residual;
+
+      runner.template run<0> ([&] (C first, C last, T *) {
+        spmv (bs, first, last, A.row_ptr.get (), A.columns.get (), A.values.get (), d, t);
+
+        for (C row = first * bs; row < last * bs; row++)
+          residual[row] = previous_residual[row] - t[row];
+
+        D.apply (first, last, residual, d_next);
+
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            d_next[row] = alpha * d[row] + beta * d_next[row];
+            z[row] += d_next[row];
+          }
+      });
+
+      std::swap (d, d_next);
+    }
+}
+
+#define INSTANTIATE(DTYPE,ITYPE) \
+  template class cpu_chebyshev<DTYPE, ITYPE>;
+
+INSTANTIATE (float,  int)
+INSTANTIATE (double, int)
+INSTANTIATE (float,  std::int64_t)
+INSTANTIATE (double, std::int64_t)
+
+#undef INSTANTIATE
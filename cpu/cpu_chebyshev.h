@@ -0,0 +1,71 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_CHEBYSHEV_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_CHEBYSHEV_H
+
+#include <memory>
+
+#include "cpu_preconditioners.h"
+#include "cpu_row_runner.h"
+#include "matrix_converters.h"
+#include "thread_pool.h"
+
+class chebyshev_settings
+{
+public:
+  unsigned int degree = 4;            ///< Polynomial degree, apply takes degree - 1 SpMVs
+  unsigned int lanczos_steps = 10;    ///< Steps of eigenvalue estimation in setup
+  double upper_safety = 1.1;          ///< Largest Ritz value underestimates lambda_max, Chebyshev diverges above interval
+  double max_condition = 1000.0;      ///< Lower bound of interval is at least lambda_max / max_condition
+};
+
+/**
+ * @brief Chebyshev polynomial preconditioner in D^-1 A with block-Jacobi D
+ *
+ * M^-1 = p (D^-1 A) D^-1, where p of degree (settings.degree - 1) is the
+ * best approximation of 1 / lambda on [lower, upper] in Chebyshev sense. The
+ * interval comes from the extreme Ritz values of a few block-Jacobi CG
+ * (Lanczos) steps on a pseudo-random right hand side, which is the only
+ * place with inner products. Apply is the three term Chebyshev recurrence,
+ * one pass per degree with BCSR SpMV of the active ISA and axpys fused over
+ * block rows balanced by nonzeros, so it has no reductions and a barrier per
+ * SpMV only. For symmetric positive definite A and D the preconditioner is
+ * symmetric and works with CG.
+ *
+ * Degrees are cheaper than iterations of outer solver as long as its
+ * reductions cost more than SpMV, which is the case on many threads.
+ */
+template <class T, class C>
+class cpu_chebyshev : public cpu_preconditioner<T, C>
+{
+public:
+  /// A should outlive preconditioner
+  cpu_chebyshev (const bcsr_matrix_class<T, C> &A, thread_pool &pool, chebyshev_settings settings = {});
+
+  C size () const override { return n; }
+  void apply (const T *r, T *z) const override;
+
+  /// Interval of D^-1 A spectrum the polynomial is built on
+  T get_lower () const { return lower; }
+  T get_upper () const { return upper; }
+
+private:
+  const bcsr_matrix_class<T, C> &A;
+  const chebyshev_settings settings;
+  const C n {};  ///< Scalar rows
+
+  cpu_block_jacobi<T, C> D;
+  mutable cpu_row_runner<T, C> runner;  ///< Block rows of A balanced by nonzero blocks
+
+  T lower {};
+  T upper {};
+
+  std::unique_ptr<T[]> residual;
+  std::unique_ptr<T[]> d;
+  std::unique_ptr<T[]> d_next;
+  std::unique_ptr<T[]> t;
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_CHEBYSHEV_H
@@ -0,0 +1,93 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_isa.h"
+
+#include <atomic>
+#include <stdexcept>
+
+std::string to_string (cpu_isa isa)
+{
+  switch (isa)
+    {
+      case cpu_isa::generic: return "generic";
+      case cpu_isa::sse4: return "sse4";
+      case cpu_isa::avx2: return "avx2";
+      case cpu_isa::avx512: return "avx512";
+    }
+
+  return {};
+}
+
+cpu_isa cpu_isa_from_string (const std::string &name)
+{
+  for (auto isa: { cpu_isa::generic, cpu_isa::sse4, cpu_isa::avx2, cpu_isa::avx512 })
+    if (to_string (isa) == name)
+      return isa;
+
+  throw std::runtime_error ("Error! Unknown ISA " + name);
+}
+
+std::string get_cpu_isa_flags (cpu_isa isa)
+{
+  switch (isa)
+    {
+      case cpu_isa::generic: return "";
+      case cpu_isa::sse4: return "-msse4.2 -mpopcnt";
+      case cpu_isa::avx2: return "-msse4.2 -mpopcnt -mavx2 -mfma";
+      case cpu_isa::avx512: return "-msse4.2 -mpopcnt -mavx2 -mfma -mavx512f -mavx512vl -mavx512bw -mavx512dq -mprefer-vector-width=512";
+    }
+
+  return {};
+}
+
+cpu_isa detect_cpu_isa ()
+{
+#if defined(CPU_ISA_DISPATCH) && (defined(__x86_64__) || defined(__i386__))
+  /// cpuid based, also checks that OS saves the extended registers (xgetbv)
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("avx512f") && __builtin_cpu_supports ("avx512vl")
+   && __builtin_cpu_supports ("avx512bw") && __builtin_cpu_supports ("avx512dq"))
+    return cpu_isa::avx512;
+
+  if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma"))
+    return cpu_isa::avx2;
+
+  if (__builtin_cpu_supports ("sse4.2") && __builtin_cpu_supports ("popcnt"))
+    return cpu_isa::sse4;
+#endif
+
+  return cpu_isa::generic;
+}
+
+namespace
+{
+std::atomic<cpu_isa> &get_active_isa ()
+{
+  static std::atomic<cpu_isa> isa { detect_cpu_isa () };
+  return isa;
+}
+
+std::atomic<bool> isa_is_forced { false };
+}
+
+cpu_isa get_cpu_isa ()
+{
+  return get_active_isa ().load (std::memory_order_relaxed);
+}
+
+bool is_cpu_isa_forced ()
+{
+  return isa_is_forced;
+}
+
+void force_cpu_isa (cpu_isa isa)
+{
+  if (static_cast<int> (isa) > static_cast<int> (detect_cpu_isa ()))
+    throw std::runtime_error ("Error! ISA " + to_string (isa) + " isn't supported (highest is " + to_string (detect_cpu_isa ()) + ")");
+
+  get_active_isa () = isa;
+  isa_is_forced = true;
+}
@@ -0,0 +1,38 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_ISA_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_ISA_H
+
+#include <string>
+
+/// Instruction set levels CPU kernels are built for, in increasing order
+enum class cpu_isa
+{
+  generic,  ///< Baseline of the target (SSE2 on x86-64)
+  sse4,     ///< SSE4.2, POPCNT (Nehalem and later)
+  avx2,     ///< AVX2, FMA (Haswell, Zen and later)
+  avx512    ///< AVX-512 F/VL/BW/DQ (Skylake-SP, Icelake and later)
+};
+
+std::string to_string (cpu_isa isa);
+
+/// Throws std::runtime_error for unknown names
+cpu_isa cpu_isa_from_string (const std::string &name);
+
+/// Compiler flags of level, the build uses the same ones for dispatched kernels
+std::string get_cpu_isa_flags (cpu_isa isa);
+
+/// Highest level supported by both processor (cpuid) and this build
+cpu_isa detect_cpu_isa ();
+
+/// Level used by kernels, detected once at startup unless forced
+cpu_isa get_cpu_isa ();
+
+bool is_cpu_isa_forced ();
+
+/// Use level for benchmarking. Throws std::runtime_error if processor doesn't support it.
+void force_cpu_isa (cpu_isa isa);
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_ISA_H
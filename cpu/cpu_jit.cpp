@@ -0,0 +1,241 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_jit.h"
+#include "cache_directory.h"
+#include "cpu_isa.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <typeinfo>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#ifndef CPU_JIT_COMPILER
+#define CPU_JIT_COMPILER "c++"
+#endif
+
+cpu_jit_library::cpu_jit_library (void *handle_arg, std::string path_arg)
+  : handle (handle_arg)
+  , path (std::move (path_arg))
+{ }
+
+cpu_jit_library::~cpu_jit_library ()
+{
+  if (handle)
+    dlclose (handle);
+}
+
+void *cpu_jit_library::get_symbol (const std::string &name) const
+{
+  void *symbol = dlsym (handle, name.c_str ());
+
+  if (!symbol)
+    throw std::runtime_error ("Error! Symbol " + name + " isn't found in " + path);
+
+  return symbol;
+}
+
+std::string cpu_jit_render (const std::string &text, const std::map<std::string, std::string> &parameters)
+{
+  std::string result;
+  size_t position = 0;
+
+  while (true)
+    {
+      const size_t begin = text.find ("{{", position);
+      if (begin == std::string::npos)
+        break;
+
+      const size_t end = text.find ("}}", begin);
+      if (end == std::string::npos)
+        break;
+
+      std::string name = text.substr (begin + 2, end - begin - 2);
+      name.erase (0, name.find_first_not_of (' '));
+      name.erase (name.find_last_not_of (' ') + 1);
+
+      auto parameter = parameters.find (name);
+      if (parameter == parameters.end ())
+        throw std::runtime_error ("Error! JIT parameter " + name + " isn't set");
+
+      result.append (text, position, begin - position);
+      result.append (parameter->second);
+      position = end + 2;
+    }
+
+  result.append (text, position, std::string::npos);
+  return result;
+}
+
+namespace
+{
+
+std::string get_isa_flags (const std::string &isa)
+{
+  if (isa == "native")
+    return "-march=native";
+
+  /// Same flags as kernels built ahead of time for this level
+  return get_cpu_isa_flags (cpu_isa_from_string (isa));
+}
+
+std::uint64_t hash_string (const std::string &text)
+{
+  /// FNV-1a
+  std::uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c: text)
+    {
+      hash ^= c;
+      hash *= 1099511628211ull;
+    }
+  return hash;
+}
+
+std::string to_hex (std::uint64_t value)
+{
+  const char digits[] = "0123456789abcdef";
+  std::string result (16, '0');
+
+  for (int i = 15; i >= 0; i--, value >>= 4)
+    result[i] = digits[value & 0xf];
+
+  return result;
+}
+
+template <typename type>
+std::string get_type_name ()
+{
+  if constexpr (std::is_same_v<type, float>) return "float";
+  else if constexpr (std::is_same_v<type, double>) return "double";
+  else if constexpr (std::is_same_v<type, int>) return "int";
+  else if constexpr (std::is_same_v<type, long>) return "long";
+  else if constexpr (std::is_same_v<type, long long>) return "long long";
+  else throw std::runtime_error (std::string ("Error! Type isn't supported by JIT: ") + typeid (type).name ());
+}
+
+const char *bcsr_spmv_source = R"(
+constexpr int bs = {{ bs }};
+
+using data_type = {{ data_type }};
+using index_type = {{ index_type }};
+
+extern "C" void spmv (
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  for (index_type block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      data_type sums[bs] {};
+
+      for (index_type block = row_ptr[block_row]; block < row_ptr[block_row + 1]; block++)
+        {
+          const data_type *block_data = data + block * bs * bs;
+          const data_type *block_x = x + col_ids[block] * bs;
+
+#pragma GCC unroll 64
+          for (int {{ outer }} = 0; {{ outer }} < bs; {{ outer }}++)
+#pragma GCC unroll 64
+            for (int {{ inner }} = 0; {{ inner }} < bs; {{ inner }}++)
+              sums[r] += block_data[{{ element }}] * block_x[c];
+        }
+
+#pragma GCC unroll 64
+      for (int r = 0; r < bs; r++)
+        y[block_row * bs + r] = sums[r];
+    }
+}
+)";
+
+}
+
+std::shared_ptr<cpu_jit_library> cpu_jit_compile (const std::string &source, const std::string &isa)
+{
+  /// Compilation of the same object from several threads would race on the output file
+  static std::mutex compile_lock;
+  std::lock_guard<std::mutex> guard (compile_lock);
+
+  const char *env_compiler = std::getenv ("CXX");
+  const std::string compiler = env_compiler && *env_compiler ? env_compiler : CPU_JIT_COMPILER;
+  const std::string flags = "-std=c++17 -O3 -shared -fPIC " + get_isa_flags (isa);
+
+  const auto directory = get_cache_directory () / "jit";
+  std::filesystem::create_directories (directory);
+
+  /// Native code of one node might not run on another one sharing the cache directory
+  const std::string host = isa == "native" ? get_host_name () : std::string ();
+  const std::string name = to_hex (hash_string (compiler + "\n" + flags + "\n" + host + "\n" + source));
+  const auto library_path = directory / (name + ".so");
+
+  if (!std::filesystem::exists (library_path))
+    {
+      /// Unique names let concurrent processes compile the same kernel, rename is atomic
+      const std::string suffix = "." + std::to_string (getpid ());
+      const auto source_path = directory / (name + suffix + ".cpp");
+      const auto temporary_path = directory / (name + suffix + ".so");
+
+      std::ofstream (source_path) << source;
+
+      const std::string command = compiler + " " + flags + " -o '" + temporary_path.string () + "' '" + source_path.string () + "'";
+      const int status = std::system (command.c_str ());
+
+      std::filesystem::remove (source_path);
+
+      if (status != 0)
+        {
+          std::filesystem::remove (temporary_path);
+          throw std::runtime_error ("Error! JIT compilation failed: " + command);
+        }
+
+      std::filesystem::rename (temporary_path, library_path);
+    }
+
+  void *handle = dlopen (library_path.c_str (), RTLD_NOW | RTLD_LOCAL);
+
+  if (!handle)
+    throw std::runtime_error ("Error! Can't load " + library_path.string () + ": " + dlerror ());
+
+  return std::make_shared<cpu_jit_library> (handle, library_path.string ());
+}
+
+template <typename data_type, typename index_type>
+cpu_jit_bcsr_spmv<data_type, index_type>::cpu_jit_bcsr_spmv (index_type bs, bool column_major, const std::string &isa)
+{
+  const std::string source = cpu_jit_render (bcsr_spmv_source, {
+    { "bs", std::to_string (bs) },
+    { "data_type", get_type_name<data_type> () },
+    { "index_type", get_type_name<index_type> () },
+    { "element", column_major ? "c * bs + r" : "r * bs + c" },
+    { "outer", column_major ? "c" : "r" }, ///< Traverse block in storage order
+    { "inner", column_major ? "r" : "c" },
+  });
+
+  /// Forced level is benchmarked the same way as precompiled kernels, otherwise use the whole processor
+  const std::string target_isa = !isa.empty () ? isa
+                               : is_cpu_isa_forced () ? to_string (get_cpu_isa ())
+                               : "native";
+
+  library = cpu_jit_compile (source, target_isa);
+  function = reinterpret_cast<function_type> (library->get_symbol ("spmv"));
+}
+
+#define INSTANTIATE(DTYPE,ITYPE) \
+  template class cpu_jit_bcsr_spmv<DTYPE, ITYPE>;
+
+INSTANTIATE (float,int)
+INSTANTIATE (double,int)
+INSTANTIATE (float,std::int64_t)
+INSTANTIATE (double,std::int64_t)
+
+#undef INSTANTIATE
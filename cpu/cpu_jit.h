@@ -0,0 +1,85 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_JIT_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_JIT_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+/// Shared object produced by cpu_jit_compile, closed when the last reference is gone
+class cpu_jit_library
+{
+public:
+  cpu_jit_library (void *handle_arg, std::string path_arg);
+  ~cpu_jit_library ();
+
+  cpu_jit_library (const cpu_jit_library &) = delete;
+  cpu_jit_library &operator= (const cpu_jit_library &) = delete;
+
+  /// Throws std::runtime_error if symbol isn't exported
+  void *get_symbol (const std::string &name) const;
+
+  const std::string &get_path () const { return path; }
+
+private:
+  void *handle {};
+  const std::string path;
+};
+
+/// Replace every {{ name }} in text with parameters[name], as cuda_jit does for device code
+std::string cpu_jit_render (const std::string &text, const std::map<std::string, std::string> &parameters);
+
+/**
+ * @brief Compile C++ source into a shared object with the system compiler and load it
+ *
+ * Objects are cached in get_cache_directory ()/jit by hash of source, compiler
+ * and flags, so each specialization is compiled once per machine. Compiler is
+ * $CXX if set, otherwise the one that built this library. isa is one of
+ * native, generic, sse4, avx2, avx512. Throws std::runtime_error if
+ * compilation fails.
+ */
+std::shared_ptr<cpu_jit_library> cpu_jit_compile (const std::string &source, const std::string &isa = "native");
+
+/**
+ * @brief BCSR SpMV over block rows [first, last) with block size and layout fixed at compile time
+ *
+ * Same contract as bcsr_spmv_row_major_template / bcsr_spmv_column_major_template,
+ * for any block size without instantiating it at build time.
+ */
+template <typename data_type, typename index_type>
+class cpu_jit_bcsr_spmv
+{
+public:
+  using function_type = void (*) (
+    index_type first_block_row,
+    index_type last_block_row,
+    const index_type *row_ptr,
+    const index_type *col_ids,
+    const data_type *data,
+    const data_type *x,
+    data_type *y);
+
+  /// Empty isa means the level forced by force_cpu_isa, or native if none is
+  cpu_jit_bcsr_spmv (index_type bs, bool column_major, const std::string &isa = "");
+
+  void operator () (
+    index_type first_block_row,
+    index_type last_block_row,
+    const index_type *row_ptr,
+    const index_type *col_ids,
+    const data_type *data,
+    const data_type *x,
+    data_type *y) const
+  {
+    function (first_block_row, last_block_row, row_ptr, col_ids, data, x, y);
+  }
+
+private:
+  std::shared_ptr<cpu_jit_library> library;
+  function_type function {};
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_JIT_H
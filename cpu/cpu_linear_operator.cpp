@@ -0,0 +1,151 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_linear_operator.h"
+#include "cpu_matrix_multiplier.h"
+#include "cpu_spmv_isa.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+template <class T, class C>
+T cpu_linear_operator<T, C>::apply_dot (C first, C last, const T *x, T *y) const
+{
+  apply (first, last, x, y);
+
+  const C unit = unit_rows ();
+  T dot {};
+
+  for (C row = first * unit; row < last * unit; row++)
+    dot += x[row] * y[row];
+
+  return dot;
+}
+
+template <class T, class C>
+cpu_csr_operator<T, C>::cpu_csr_operator (const csr_matrix_class<T, C> &A_arg)
+  : A (A_arg)
+{
+  if (A.n_rows != A.n_cols)
+    throw std::runtime_error ("Error! Linear operator should be square");
+}
+
+template <class T, class C>
+std::vector<std::pair<C, C>> cpu_csr_operator<T, C>::partition (unsigned int threads_count) const
+{
+  return nnz_balanced_ranges (A.row_ptr.get (), A.n_rows, threads_count);
+}
+
+template <class T, class C>
+void cpu_csr_operator<T, C>::apply (C first, C last, const T *x, T *y) const
+{
+  get_cpu_spmv_functions<T, C> ().csr (first, last, A.row_ptr.get (), A.columns.get (), A.values.get (), x, y);
+}
+
+template <class T, class C>
+void cpu_csr_operator<T, C>::apply_multiple (C first, C last, unsigned int k, unsigned int stride, const T *x, T *y) const
+{
+  get_cpu_spmv_functions<T, C> ().csr_multiple (first, last, A.row_ptr.get (), A.columns.get (), A.values.get (), k, stride, x, y);
+}
+
+template <class T, class C>
+void cpu_csr_operator<T, C>::diagonal (C first, C last, T *d) const
+{
+  for (C row = first; row < last; row++)
+    {
+      d[row] = T {};
+      for (C element = A.row_ptr[row]; element < A.row_ptr[row + 1]; element++)
+        if (A.columns[element] == row)
+          d[row] = A.values[element];
+    }
+}
+
+template <class T, class C>
+cpu_bcsr_operator<T, C>::cpu_bcsr_operator (const bcsr_matrix_class<T, C> &A_arg, matrix_format format_arg)
+  : A (A_arg)
+  , format (format_arg)
+{
+  if (A.n_rows != A.n_cols)
+    throw std::runtime_error ("Error! Linear operator should be square");
+
+  if (format == matrix_format::bcsr_column_major)
+    {
+      const C bs = A.bs;
+      column_major_values.reset (new T[A.size ()]);
+
+      for (C block = 0; block < A.nnzb; block++)
+        for (C i = 0; i < bs; i++)
+          for (C j = 0; j < bs; j++)
+            column_major_values[block * bs * bs + j * bs + i] = A.values[block * bs * bs + i * bs + j];
+    }
+  else if (format != matrix_format::bcsr_row_major)
+    {
+      throw std::runtime_error ("Error! BCSR operator supports row major and column major blocks only");
+    }
+}
+
+template <class T, class C>
+std::vector<std::pair<C, C>> cpu_bcsr_operator<T, C>::partition (unsigned int threads_count) const
+{
+  return nnz_balanced_ranges (A.row_ptr.get (), A.n_rows, threads_count);
+}
+
+template <class T, class C>
+void cpu_bcsr_operator<T, C>::apply (C first, C last, const T *x, T *y) const
+{
+  const auto &functions = get_cpu_spmv_functions<T, C> ();
+
+  if (column_major_values)
+    functions.bcsr_column_major (A.bs, first, last, A.row_ptr.get (), A.columns.get (), column_major_values.get (), x, y);
+  else
+    functions.bcsr_row_major (A.bs, first, last, A.row_ptr.get (), A.columns.get (), A.values.get (), x, y);
+}
+
+template <class T, class C>
+T cpu_bcsr_operator<T, C>::apply_dot (C first, C last, const T *x, T *y) const
+{
+  if (column_major_values)
+    return cpu_linear_operator<T, C>::apply_dot (first, last, x, y);
+
+  return get_cpu_spmv_functions<T, C> ().bcsr_row_major_dot (A.bs, first, last, A.row_ptr.get (), A.columns.get (), A.values.get (), x, y);
+}
+
+template <class T, class C>
+void cpu_bcsr_operator<T, C>::apply_multiple (C first, C last, unsigned int k, unsigned int stride, const T *x, T *y) const
+{
+  const auto &functions = get_cpu_spmv_functions<T, C> ();
+
+  if (column_major_values)
+    functions.bcsr_column_major_multiple (A.bs, first, last, A.row_ptr.get (), A.columns.get (), column_major_values.get (), k, stride, x, y);
+  else
+    functions.bcsr_row_major_multiple (A.bs, first, last, A.row_ptr.get (), A.columns.get (), A.values.get (), k, stride, x, y);
+}
+
+template <class T, class C>
+void cpu_bcsr_operator<T, C>::diagonal (C first, C last, T *d) const
+{
+  const C bs = A.bs;
+
+  for (C block_row = first; block_row < last; block_row++)
+    {
+      const C *diagonal = std::lower_bound (A.columns.get () + A.row_ptr[block_row], A.columns.get () + A.row_ptr[block_row + 1], block_row);
+      const bool has_diagonal = diagonal != A.columns.get () + A.row_ptr[block_row + 1] && *diagonal == block_row;
+
+      for (C i = 0; i < bs; i++)
+        d[block_row * bs + i] = has_diagonal ? A.values[(diagonal - A.columns.get ()) * bs * bs + i * bs + i] : T {};
+    }
+}
+
+#define INSTANTIATE(DTYPE,ITYPE) \
+  template class cpu_linear_operator<DTYPE, ITYPE>; \
+  template class cpu_csr_operator<DTYPE, ITYPE>; \
+  template class cpu_bcsr_operator<DTYPE, ITYPE>;
+
+INSTANTIATE (float,  int)
+INSTANTIATE (double, int)
+INSTANTIATE (float,  std::int64_t)
+INSTANTIATE (double, std::int64_t)
+
+#undef INSTANTIATE
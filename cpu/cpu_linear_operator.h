@@ -0,0 +1,107 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_LINEAR_OPERATOR_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_LINEAR_OPERATOR_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "matrix_converters.h"
+#include "spmv_kernel_registry.h"
+
+/**
+ * @brief Square matrix as CPU solvers see it: y = A x over ranges of rows
+ *
+ * Rows are handed out in units (block rows for block formats), so a solver
+ * thread owns the same unit range in every pass and fuses vector updates and
+ * reductions of its rows with the product. apply of a range reads any part of
+ * x and writes only rows of the range, which is true for every kernel that
+ * computes rows independently.
+ */
+template <class T, class C>
+class cpu_linear_operator
+{
+public:
+  virtual ~cpu_linear_operator () = default;
+
+  /// Scalar rows
+  virtual C size () const = 0;
+
+  /// Scalar rows in one unit
+  virtual C unit_rows () const = 0;
+
+  virtual matrix_format get_format () const = 0;
+
+  /// Unit ranges of threads with the same work of apply
+  virtual std::vector<std::pair<C, C>> partition (unsigned int threads_count) const = 0;
+
+  /// Rows of units [first, last) of y = A x
+  virtual void apply (C first, C last, const T *x, T *y) const = 0;
+
+  /// apply, returns (x, y) over rows of units [first, last)
+  virtual T apply_dot (C first, C last, const T *x, T *y) const;
+
+  /// apply to k interleaved vectors, element of vector j in row i is at i * stride + j
+  virtual void apply_multiple (C first, C last, unsigned int k, unsigned int stride, const T *x, T *y) const = 0;
+
+  /// Diagonal of A on rows of units [first, last), zero if it's not stored
+  virtual void diagonal (C first, C last, T *d) const = 0;
+};
+
+template <class T, class C>
+class cpu_csr_operator : public cpu_linear_operator<T, C>
+{
+public:
+  /// A should outlive operator
+  explicit cpu_csr_operator (const csr_matrix_class<T, C> &A);
+
+  C size () const override { return A.n_rows; }
+  C unit_rows () const override { return 1; }
+  matrix_format get_format () const override { return matrix_format::csr; }
+
+  std::vector<std::pair<C, C>> partition (unsigned int threads_count) const override;
+  void apply (C first, C last, const T *x, T *y) const override;
+  void apply_multiple (C first, C last, unsigned int k, unsigned int stride, const T *x, T *y) const override;
+  void diagonal (C first, C last, T *d) const override;
+
+private:
+  const csr_matrix_class<T, C> &A;
+};
+
+/**
+ * @brief BCSR matrix with blocks in row major or column major order
+ *
+ * Row major storage uses the matrix values as they are and fuses the dot
+ * product into SpMV (bcsr_row_major_dot of the active ISA level). Column
+ * major operator keeps its own copy of values with transposed blocks.
+ */
+template <class T, class C>
+class cpu_bcsr_operator : public cpu_linear_operator<T, C>
+{
+public:
+  /// A should outlive operator
+  explicit cpu_bcsr_operator (const bcsr_matrix_class<T, C> &A, matrix_format format = matrix_format::bcsr_row_major);
+
+  C size () const override { return A.n_rows * A.bs; }
+  C unit_rows () const override { return A.bs; }
+  matrix_format get_format () const override { return format; }
+
+  std::vector<std::pair<C, C>> partition (unsigned int threads_count) const override;
+  void apply (C first, C last, const T *x, T *y) const override;
+  T apply_dot (C first, C last, const T *x, T *y) const override;
+  void apply_multiple (C first, C last, unsigned int k, unsigned int stride, const T *x, T *y) const override;
+  void diagonal (C first, C last, T *d) const override;
+
+  const bcsr_matrix_class<T, C> &get_matrix () const { return A; }
+
+private:
+  const bcsr_matrix_class<T, C> &A;
+  const matrix_format format;
+
+  std::unique_ptr<T[]> column_major_values;
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_LINEAR_OPERATOR_H
@@ -0,0 +1,369 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_matrix_multiplier.h"
+#include "cpu_spmv_isa.h"
+
+#include <chrono>
+#include <cstdint>
+
+template <typename data_type, typename index_type>
+void cpu_csr_spmv_single_thread_naive (
+  const csr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y)
+{
+  const auto row_ptr = matrix.row_ptr.get ();
+  const auto col_ids = matrix.columns.get ();
+  const auto data = matrix.values.get ();
+
+  for (index_type row = 0; row < matrix.n_rows; row++)
+    {
+      const auto row_start = row_ptr[row];
+      const auto row_end = row_ptr[row + 1];
+
+      data_type dot = 0;
+      for (auto element = row_start; element < row_end; element++)
+        dot += data[element] * x[col_ids[element]];
+      y[row] = dot;
+    }
+}
+
+template <typename data_type, typename index_type>
+const cpu_spmv_functions<data_type, index_type> &get_cpu_spmv_functions (cpu_isa isa)
+{
+#ifdef CPU_ISA_DISPATCH
+  static const cpu_spmv_functions<data_type, index_type> functions[] = {
+    cpu_isa_generic::get_spmv_functions<data_type, index_type> (),
+    cpu_isa_sse4::get_spmv_functions<data_type, index_type> (),
+    cpu_isa_avx2::get_spmv_functions<data_type, index_type> (),
+    cpu_isa_avx512::get_spmv_functions<data_type, index_type> (),
+  };
+
+  return functions[static_cast<int> (isa)];
+#else
+  static const cpu_spmv_functions<data_type, index_type> functions = cpu_isa_generic::get_spmv_functions<data_type, index_type> ();
+
+  (void) isa;
+  return functions;
+#endif
+}
+
+template <typename data_type, typename index_type>
+void cpu_csr_spmv (
+  thread_pool &pool,
+  const csr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y)
+{
+  const index_type *row_ptr = matrix.row_ptr.get ();
+  const index_type *col_ids = matrix.columns.get ();
+  const data_type *data = matrix.values.get ();
+  const auto kernel = get_cpu_spmv_functions<data_type, index_type> ().csr;
+
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    const auto [first_row, last_row] = nnz_balanced_range (row_ptr, matrix.n_rows, thread_id, threads_count);
+    kernel (first_row, last_row, row_ptr, col_ids, data, x, y);
+  });
+}
+
+template <typename data_type, typename index_type>
+void cpu_bcsr_spmv_row_major (
+  thread_pool &pool,
+  const bcsr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y)
+{
+  const index_type *row_ptr = matrix.row_ptr.get ();
+  const index_type *col_ids = matrix.columns.get ();
+  const data_type *data = matrix.values.get ();
+  const auto kernel = get_cpu_spmv_functions<data_type, index_type> ().bcsr_row_major;
+
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    const auto [first, last] = nnz_balanced_range (row_ptr, matrix.n_rows, thread_id, threads_count);
+    kernel (matrix.bs, first, last, row_ptr, col_ids, data, x, y);
+  });
+}
+
+template <typename data_type, typename index_type>
+void cpu_bcsr_spmv_column_major (
+  thread_pool &pool,
+  const bcsr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y)
+{
+  const index_type *row_ptr = matrix.row_ptr.get ();
+  const index_type *col_ids = matrix.columns.get ();
+  const data_type *data = matrix.values.get ();
+  const auto kernel = get_cpu_spmv_functions<data_type, index_type> ().bcsr_column_major;
+
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    const auto [first, last] = nnz_balanced_range (row_ptr, matrix.n_rows, thread_id, threads_count);
+    kernel (matrix.bs, first, last, row_ptr, col_ids, data, x, y);
+  });
+}
+
+template <typename data_type, typename index_type>
+void cpu_bcsr_spmv_column_major_masked (
+  thread_pool &pool,
+  const bcsr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y)
+{
+  const index_type *row_ptr = matrix.row_ptr.get ();
+  const index_type *col_ids = matrix.columns.get ();
+  const data_type *data = matrix.values.get ();
+  const auto kernel = get_cpu_spmv_functions<data_type, index_type> ().bcsr_column_major_masked;
+
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    const auto [first, last] = nnz_balanced_range (row_ptr, matrix.n_rows, thread_id, threads_count);
+    kernel (matrix.bs, first, last, row_ptr, col_ids, data, x, y);
+  });
+}
+
+template <typename data_type, typename index_type>
+cpu_padded_bcsr_matrix<data_type, index_type>::cpu_padded_bcsr_matrix (const bcsr_matrix_class<data_type, index_type> &matrix)
+  : n_rows (matrix.n_rows)
+  , bs (matrix.bs)
+  , padded_bs (get_padded_block_size (matrix.bs))
+  , nnzb (matrix.nnzb)
+  , values (new data_type[size ()])
+  , columns (new index_type[nnzb])
+  , row_ptr (new index_type[n_rows + 1])
+{
+  std::copy_n (matrix.row_ptr.get (), n_rows + 1, row_ptr.get ());
+  std::copy_n (matrix.columns.get (), nnzb, columns.get ());
+  std::fill_n (values.get (), size (), data_type {});
+
+  for (index_type block = 0; block < nnzb; block++)
+    {
+      const data_type *source = matrix.values.get () + block * bs * bs;
+      data_type *target = values.get () + block * bs * padded_bs;
+
+      for (index_type r = 0; r < bs; r++)
+        for (index_type c = 0; c < bs; c++)
+          target[c * padded_bs + r] = source[r * bs + c];
+    }
+}
+
+template <typename data_type, typename index_type>
+void cpu_bcsr_spmv_padded (
+  thread_pool &pool,
+  const cpu_padded_bcsr_matrix<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y)
+{
+  const index_type *row_ptr = matrix.row_ptr.get ();
+  const index_type *col_ids = matrix.columns.get ();
+  const data_type *data = matrix.values.get ();
+  const auto kernel = get_cpu_spmv_functions<data_type, index_type> ().bcsr_padded;
+
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    const auto [first, last] = nnz_balanced_range (row_ptr, matrix.n_rows, thread_id, threads_count);
+    kernel (matrix.bs, first, last, row_ptr, col_ids, data, x, y);
+  });
+}
+
+template <typename data_type, typename index_type>
+index_type get_cpu_sliced_bcsr_width ()
+{
+  return get_cpu_spmv_functions<data_type, index_type> ().sliced_bcsr_width;
+}
+
+template <typename data_type, typename index_type>
+void cpu_sliced_bcsr_spmv (
+  thread_pool &pool,
+  const sliced_bcsr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y)
+{
+  const index_type *slice_ptr = matrix.slice_ptr.get ();
+  const index_type *col_ids = matrix.columns.get ();
+  const data_type *data = matrix.values.get ();
+  const auto kernel = get_cpu_spmv_functions<data_type, index_type> ().sliced_bcsr;
+
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    const auto [first, last] = nnz_balanced_range (slice_ptr, matrix.n_slices, thread_id, threads_count);
+    kernel (matrix.bs, matrix.slice_width, matrix.n_rows, first, last, slice_ptr, col_ids, data, x, y);
+  });
+}
+
+template <typename data_type, typename index_type>
+void cpu_bcsr_spmv_jit (
+  thread_pool &pool,
+  const cpu_jit_bcsr_spmv<data_type, index_type> &kernel,
+  const bcsr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y)
+{
+  const index_type *row_ptr = matrix.row_ptr.get ();
+  const index_type *col_ids = matrix.columns.get ();
+  const data_type *data = matrix.values.get ();
+
+  pool.run ([&] (unsigned int thread_id, unsigned int threads_count) {
+    const auto [first, last] = nnz_balanced_range (row_ptr, matrix.n_rows, thread_id, threads_count);
+    kernel (first, last, row_ptr, col_ids, data, x, y);
+  });
+}
+
+/// Registry kernel running action on its own y
+template <typename data_type, typename index_type>
+class cpu_registry_spmv_kernel : public spmv_kernel<data_type, index_type>
+{
+public:
+  using action_type = std::function<void (data_type *y)>;
+
+  cpu_registry_spmv_kernel (index_type y_size, action_type action_arg)
+    : y (new data_type[y_size])
+    , size (y_size)
+    , action (std::move (action_arg))
+  {
+    std::fill_n (y.get (), size, data_type {});
+  }
+
+  double run () override
+  {
+    auto begin = std::chrono::steady_clock::now ();
+    action (y.get ());
+    auto end = std::chrono::steady_clock::now ();
+
+    return std::chrono::duration<double> (end - begin).count ();
+  }
+
+  void copy_y (data_type *target) override
+  {
+    std::copy_n (y.get (), size, target);
+  }
+
+private:
+  std::unique_ptr<data_type[]> y;
+  const index_type size;
+  const action_type action;
+};
+
+template <typename data_type, typename index_type>
+void register_cpu_spmv_kernels (spmv_kernel_registry<data_type, index_type> &registry)
+{
+  using problem_type = spmv_problem<data_type, index_type>;
+  using kernel_ptr = std::unique_ptr<spmv_kernel<data_type, index_type>>;
+
+  registry.add ("CPU CSR", "CPU", matrix_format::csr, {}, [] (const problem_type &problem, thread_pool &) -> kernel_ptr {
+    return std::make_unique<cpu_registry_spmv_kernel<data_type, index_type>> (problem.get_y_size (), [&problem] (data_type *y) {
+      cpu_csr_spmv_single_thread_naive (problem.csr, problem.x, y);
+    });
+  });
+
+  registry.add ("CPU CSR (parallel)", "CPU", matrix_format::csr, {}, [] (const problem_type &problem, thread_pool &pool) -> kernel_ptr {
+    return std::make_unique<cpu_registry_spmv_kernel<data_type, index_type>> (problem.get_y_size (), [&problem, &pool] (data_type *y) {
+      cpu_csr_spmv (pool, problem.csr, problem.x, y);
+    });
+  }).threaded = true;
+
+  registry.add ("CPU BCSR (row major)", "CPU", matrix_format::bcsr_row_major, {}, [] (const problem_type &problem, thread_pool &pool) -> kernel_ptr {
+    return std::make_unique<cpu_registry_spmv_kernel<data_type, index_type>> (problem.get_y_size (), [&problem, &pool] (data_type *y) {
+      cpu_bcsr_spmv_row_major (pool, problem.bcsr, problem.x, y);
+    });
+  }).threaded = true;
+
+  registry.add ("CPU BCSR (column major)", "CPU", matrix_format::bcsr_column_major, {}, [] (const problem_type &problem, thread_pool &pool) -> kernel_ptr {
+    std::shared_ptr<bcsr_matrix_class<data_type, index_type>> matrix = csr_to_bcsr (problem.csr, problem.bcsr.bs);
+    std::copy_n (problem.column_major_values, matrix->size (), matrix->values.get ());
+
+    return std::make_unique<cpu_registry_spmv_kernel<data_type, index_type>> (problem.get_y_size (), [matrix, &problem, &pool] (data_type *y) {
+      cpu_bcsr_spmv_column_major (pool, *matrix, problem.x, y);
+    });
+  }).threaded = true;
+
+  /// Block sizes of FEM models that don't match SIMD width
+  const std::vector<index_type> small_block_sizes { 3, 5, 6 };
+
+  registry.add ("CPU BCSR (column major, masked)", "CPU", matrix_format::bcsr_column_major, small_block_sizes, [] (const problem_type &problem, thread_pool &pool) -> kernel_ptr {
+    std::shared_ptr<bcsr_matrix_class<data_type, index_type>> matrix = csr_to_bcsr (problem.csr, problem.bcsr.bs);
+    std::copy_n (problem.column_major_values, matrix->size (), matrix->values.get ());
+
+    return std::make_unique<cpu_registry_spmv_kernel<data_type, index_type>> (problem.get_y_size (), [matrix, &problem, &pool] (data_type *y) {
+      cpu_bcsr_spmv_column_major_masked (pool, *matrix, problem.x, y);
+    });
+  }).threaded = true;
+
+  auto &padded = registry.add ("CPU BCSR (column major, padded)", "CPU", matrix_format::bcsr_column_major, small_block_sizes, [] (const problem_type &problem, thread_pool &pool) -> kernel_ptr {
+    auto matrix = std::make_shared<cpu_padded_bcsr_matrix<data_type, index_type>> (problem.bcsr);
+
+    return std::make_unique<cpu_registry_spmv_kernel<data_type, index_type>> (problem.get_y_size (), [matrix, &problem, &pool] (data_type *y) {
+      cpu_bcsr_spmv_padded (pool, *matrix, problem.x, y);
+    });
+  });
+  padded.threaded = true;
+  padded.bytes_model = [] (const problem_type &problem) {
+    /// Zero rows of padded blocks are streamed as well
+    const double padding = problem.bcsr.nnzb * problem.bcsr.bs * (get_padded_block_size (problem.bcsr.bs) - problem.bcsr.bs);
+    return bcsr_spmv_bytes (problem) + padding * sizeof (data_type);
+  };
+
+  auto &sliced = registry.add ("CPU BCSR (sliced)", "CPU", matrix_format::sliced_bcsr, {}, [] (const problem_type &problem, thread_pool &pool) -> kernel_ptr {
+    auto matrix = std::make_shared<sliced_bcsr_matrix_class<data_type, index_type>> (problem.bcsr, get_cpu_sliced_bcsr_width<data_type, index_type> ());
+
+    return std::make_unique<cpu_registry_spmv_kernel<data_type, index_type>> (problem.get_y_size (), [matrix, &problem, &pool] (data_type *y) {
+      cpu_sliced_bcsr_spmv (pool, *matrix, problem.x, y);
+    });
+  });
+  sliced.threaded = true;
+  sliced.bytes_model = [] (const problem_type &problem) {
+    /// Padding blocks of slices are streamed as well
+    const auto &matrix = problem.bcsr;
+    const index_type width = get_cpu_sliced_bcsr_width<data_type, index_type> ();
+
+    double stored_blocks = 0;
+    for (index_type first_row = 0; first_row < matrix.n_rows; first_row += width)
+      {
+        index_type slice_length = 0;
+        for (index_type row = first_row; row < std::min (first_row + width, matrix.n_rows); row++)
+          slice_length = std::max (slice_length, matrix.row_ptr[row + 1] - matrix.row_ptr[row]);
+        stored_blocks += static_cast<double> (slice_length) * width;
+      }
+
+    const double padding = stored_blocks - matrix.nnzb;
+    return bcsr_spmv_bytes (problem) + padding * (matrix.bs * matrix.bs * sizeof (data_type) + sizeof (index_type));
+  };
+
+  /// Kernels are compiled in factory, outside of measured region
+  registry.add ("CPU BCSR (row major, jit)", "CPU", matrix_format::bcsr_row_major, {}, [] (const problem_type &problem, thread_pool &pool) -> kernel_ptr {
+    auto kernel = std::make_shared<cpu_jit_bcsr_spmv<data_type, index_type>> (problem.bcsr.bs, false);
+
+    return std::make_unique<cpu_registry_spmv_kernel<data_type, index_type>> (problem.get_y_size (), [kernel, &problem, &pool] (data_type *y) {
+      cpu_bcsr_spmv_jit (pool, *kernel, problem.bcsr, problem.x, y);
+    });
+  }).threaded = true;
+
+  registry.add ("CPU BCSR (column major, jit)", "CPU", matrix_format::bcsr_column_major, {}, [] (const problem_type &problem, thread_pool &pool) -> kernel_ptr {
+    auto kernel = std::make_shared<cpu_jit_bcsr_spmv<data_type, index_type>> (problem.bcsr.bs, true);
+    std::shared_ptr<bcsr_matrix_class<data_type, index_type>> matrix = csr_to_bcsr (problem.csr, problem.bcsr.bs);
+    std::copy_n (problem.column_major_values, matrix->size (), matrix->values.get ());
+
+    return std::make_unique<cpu_registry_spmv_kernel<data_type, index_type>> (problem.get_y_size (), [kernel, matrix, &problem, &pool] (data_type *y) {
+      cpu_bcsr_spmv_jit (pool, *kernel, *matrix, problem.x, y);
+    });
+  }).threaded = true;
+}
+
+#define INSTANTIATE(DTYPE,ITYPE) \
+  template const cpu_spmv_functions<DTYPE, ITYPE> &get_cpu_spmv_functions (cpu_isa); \
+  template void cpu_csr_spmv_single_thread_naive (const csr_matrix_class<DTYPE, ITYPE> &, const DTYPE *, DTYPE *); \
+  template void register_cpu_spmv_kernels (spmv_kernel_registry<DTYPE, ITYPE> &); \
+  template void cpu_csr_spmv (thread_pool &, const csr_matrix_class<DTYPE, ITYPE> &, const DTYPE *, DTYPE *); \
+  template void cpu_bcsr_spmv_row_major (thread_pool &, const bcsr_matrix_class<DTYPE, ITYPE> &, const DTYPE *, DTYPE *); \
+  template void cpu_bcsr_spmv_column_major (thread_pool &, const bcsr_matrix_class<DTYPE, ITYPE> &, const DTYPE *, DTYPE *); \
+  template class cpu_padded_bcsr_matrix<DTYPE, ITYPE>; \
+  template void cpu_bcsr_spmv_column_major_masked (thread_pool &, const bcsr_matrix_class<DTYPE, ITYPE> &, const DTYPE *, DTYPE *); \
+  template void cpu_bcsr_spmv_padded (thread_pool &, const cpu_padded_bcsr_matrix<DTYPE, ITYPE> &, const DTYPE *, DTYPE *); \
+  template ITYPE get_cpu_sliced_bcsr_width<DTYPE, ITYPE> (); \
+  template void cpu_sliced_bcsr_spmv (thread_pool &, const sliced_bcsr_matrix_class<DTYPE, ITYPE> &, const DTYPE *, DTYPE *); \
+  template void cpu_bcsr_spmv_jit (thread_pool &, const cpu_jit_bcsr_spmv<DTYPE, ITYPE> &, const bcsr_matrix_class<DTYPE, ITYPE> &, const DTYPE *, DTYPE *);
+
+INSTANTIATE (float,int)
+INSTANTIATE (double,int)
+INSTANTIATE (float,std::int64_t)
+INSTANTIATE (double,std::int64_t)
+
+#undef INSTANTIATE
@@ -0,0 +1,154 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_MATRIX_MULTIPLIER_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_MATRIX_MULTIPLIER_H
+
+#include "matrix_converters.h"
+#include "spmv_kernel_registry.h"
+#include "thread_pool.h"
+#include "cpu_jit.h"
+
+#include <algorithm>
+
+/**
+ * @brief Rows [first, second) of thread_id so that every thread gets about the same number of elements
+ *
+ * Works for both CSR (elements) and BCSR (blocks) row pointers.
+ */
+template <typename index_type>
+std::pair<index_type, index_type> nnz_balanced_range (
+  const index_type *row_ptr,
+  index_type n_rows,
+  unsigned int thread_id,
+  unsigned int threads_count)
+{
+  const auto nnz = static_cast<unsigned long long> (row_ptr[n_rows]);
+
+  auto first_row_with_offset = [&] (unsigned int id) -> index_type {
+    if (id == 0)
+      return 0;
+    if (id == threads_count)
+      return n_rows;
+
+    const auto target = static_cast<index_type> (nnz * id / threads_count);
+    return std::lower_bound (row_ptr, row_ptr + n_rows, target) - row_ptr;
+  };
+
+  return { first_row_with_offset (thread_id), first_row_with_offset (thread_id + 1) };
+}
+
+/// nnz_balanced_range of every thread
+template <typename index_type>
+std::vector<std::pair<index_type, index_type>> nnz_balanced_ranges (
+  const index_type *row_ptr,
+  index_type n_rows,
+  unsigned int threads_count)
+{
+  std::vector<std::pair<index_type, index_type>> ranges;
+  for (unsigned int thread_id = 0; thread_id < threads_count; thread_id++)
+    ranges.push_back (nnz_balanced_range (row_ptr, n_rows, thread_id, threads_count));
+  return ranges;
+}
+
+/// Reference implementation, results of all other kernels are compared against it
+template <typename data_type, typename index_type>
+void cpu_csr_spmv_single_thread_naive (
+  const csr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y);
+
+template <typename data_type, typename index_type>
+void cpu_csr_spmv (
+  thread_pool &pool,
+  const csr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y);
+
+/// Blocks are stored row by row (as in bcsr_matrix_class)
+template <typename data_type, typename index_type>
+void cpu_bcsr_spmv_row_major (
+  thread_pool &pool,
+  const bcsr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y);
+
+/// Blocks are stored column by column (see bcsr_matrix_class::transpose_blocks)
+template <typename data_type, typename index_type>
+void cpu_bcsr_spmv_column_major (
+  thread_pool &pool,
+  const bcsr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y);
+
+/**
+ * @brief BCSR with column major blocks padded to SIMD friendly height
+ *
+ * Each of bs block columns takes get_padded_block_size (bs) values, rows past
+ * bs are zero. Meant for block sizes that don't fill vector registers
+ * (3, 5, 6 of FEM models); for powers of two it's the column major layout.
+ */
+template <typename data_type, typename index_type>
+class cpu_padded_bcsr_matrix
+{
+public:
+  /// Blocks of matrix are stored row by row (as in bcsr_matrix_class)
+  explicit cpu_padded_bcsr_matrix (const bcsr_matrix_class<data_type, index_type> &matrix);
+
+  index_type size () const
+  {
+    return nnzb * bs * padded_bs;
+  }
+
+public:
+  const index_type n_rows {};
+  const index_type bs {};
+  const index_type padded_bs {};
+  const index_type nnzb {};
+
+  std::unique_ptr<data_type[]> values;
+  std::unique_ptr<index_type[]> columns;
+  std::unique_ptr<index_type[]> row_ptr;
+};
+
+/// Blocks are stored column by column; columns are read with masked SIMD loads for bs 3, 5 and 6
+template <typename data_type, typename index_type>
+void cpu_bcsr_spmv_column_major_masked (
+  thread_pool &pool,
+  const bcsr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y);
+
+template <typename data_type, typename index_type>
+void cpu_bcsr_spmv_padded (
+  thread_pool &pool,
+  const cpu_padded_bcsr_matrix<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y);
+
+/// Slice width of matrix should be get_cpu_sliced_bcsr_width for full speed, other widths use a scalar loop
+template <typename data_type, typename index_type>
+void cpu_sliced_bcsr_spmv (
+  thread_pool &pool,
+  const sliced_bcsr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y);
+
+/// Block rows per slice that fill SIMD registers of the active ISA level
+template <typename data_type, typename index_type>
+index_type get_cpu_sliced_bcsr_width ();
+
+/// Block size and layout are fixed by kernel (see cpu_jit_bcsr_spmv)
+template <typename data_type, typename index_type>
+void cpu_bcsr_spmv_jit (
+  thread_pool &pool,
+  const cpu_jit_bcsr_spmv<data_type, index_type> &kernel,
+  const bcsr_matrix_class<data_type, index_type> &matrix,
+  const data_type *x,
+  data_type *y);
+
+template <typename data_type, typename index_type>
+void register_cpu_spmv_kernels (spmv_kernel_registry<data_type, index_type> &registry);
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_MATRIX_MULTIPLIER_H
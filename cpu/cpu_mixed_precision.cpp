@@ -0,0 +1,155 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_mixed_precision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+template <class C>
+cpu_mixed_precision_solver<C>::cpu_mixed_precision_solver (
+  const cpu_linear_operator<double, C> &A,
+  const cpu_linear_operator<float, C> &A_low,
+  bool use_precond,
+  thread_pool &pool,
+  refinement_inner_solver inner)
+  : n_rows (A.size ())
+  , bs (A.unit_rows ())
+  , runner (pool, A.partition (pool.size ()))
+  , x (new double[n_rows])
+  , x_next (new double[n_rows])
+  , q (new double[n_rows])
+  , r_low (new float[n_rows])
+{
+  if (A_low.size () != A.size () || A_low.unit_rows () != A.unit_rows ())
+    throw std::runtime_error ("Error! Float copy of matrix doesn't match matrix");
+
+  if (inner == refinement_inner_solver::cg)
+    inner_cg = std::make_unique<cpu_cg<float, C>> (A_low, use_precond, pool);
+  else
+    inner_bicgstab = std::make_unique<cpu_bicgstab<float, C>> (
+      A_low, use_precond, pool,
+      inner == refinement_inner_solver::pipelined_bicgstab ? bicgstab_variant::pipelined : bicgstab_variant::classic);
+
+  /// First touch by the thread that owns rows
+  runner.template run<0> ([&] (C first, C last, double *) {
+    std::fill (x.get () + first * bs, x.get () + last * bs, 0.0);
+    std::fill (x_next.get () + first * bs, x_next.get () + last * bs, 0.0);
+    std::fill (q.get () + first * bs, q.get () + last * bs, 0.0);
+    std::fill (r_low.get () + first * bs, r_low.get () + last * bs, 0.0f);
+  });
+}
+
+template <class C>
+double *cpu_mixed_precision_solver<C>::solve (
+  const cpu_linear_operator<double, C> &A,
+  const cpu_linear_operator<float, C> &A_low,
+  const double *b,
+  double epsilon,
+  unsigned int max_iterations,
+  float inner_epsilon)
+{
+  double *x = this->x.get ();
+  double *x_next = this->x_next.get ();
+  double *q = this->q.get ();
+  float *r_low = this->r_low.get ();
+
+  iterations = 0;
+  outer_iterations = 0;
+  stagnated = false;
+
+  if (monitor)
+    monitor->start ("mixed-precision", { "inner_iterations" }, max_iterations);
+
+  /// x0 = 0, r0 = b; (b, b)
+  const auto [b_norm_square] = runner.template run<1> ([&] (C first, C last, double *sums) {
+    double bb {};
+
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        x[row] = 0.0;
+        r_low[row] = static_cast<float> (b[row]);
+        bb += b[row] * b[row];
+      }
+
+    sums[0] = bb;
+  });
+
+  const double norm_b = std::sqrt (b_norm_square);
+  relative_residual = norm_b > 0.0 ? 1.0 : 0.0;
+
+  while (iterations < max_iterations && relative_residual >= epsilon)
+    {
+      /// A d = r in float, inner solvers start from zero; the last one needs only reduction left to epsilon
+      const float inner_target = std::max (inner_epsilon, static_cast<float> (epsilon / relative_residual));
+      const float *d = nullptr;
+      unsigned int inner_iterations = 0;
+
+      if (inner_cg)
+        {
+          d = inner_cg->solve (A_low, r_low, inner_target, max_iterations - iterations);
+          inner_iterations = inner_cg->get_iterations ();
+        }
+      else
+        {
+          d = inner_bicgstab->solve (A_low, r_low, inner_target, max_iterations - iterations);
+          inner_iterations = inner_bicgstab->get_iterations ();
+        }
+
+      iterations += inner_iterations;
+      outer_iterations++;
+
+      /// x_next = x + d, SpMV of the next pass reads rows of other threads
+      runner.template run<0> ([&] (C first, C last, double *) {
+        for (C row = first * bs; row < last * bs; row++)
+          x_next[row] = x[row] + d[row];
+      });
+
+      /// r = b - A x_next in double; (r, r)
+      const auto [rr] = runner.template run<1> ([&] (C first, C last, double *sums) {
+        double rr_sum {};
+
+        A.apply (first, last, x_next, q);
+
+        for (C row = first * bs; row < last * bs; row++)
+          {
+            const double r = b[row] - q[row];
+            r_low[row] = static_cast<float> (r);
+            rr_sum += r * r;
+          }
+
+        sums[0] = rr_sum;
+      });
+
+      const double residual = std::sqrt (rr) / norm_b;
+
+      if (monitor)
+        monitor->record (residual, { static_cast<double> (inner_iterations) });
+
+      /// Float solve can't reduce residual any more (or broke down), correction is dropped and x is kept
+      if (!std::isfinite (residual) || residual >= relative_residual || inner_iterations == 0)
+        {
+          stagnated = true;
+          break;
+        }
+
+      relative_residual = residual;
+      std::swap (x, x_next);
+    }
+
+  if (monitor)
+    monitor->finish ();
+
+  return x;
+}
+
+#define INSTANTIATE(ITYPE) \
+  template class cpu_mixed_precision_solver<ITYPE>;
+
+INSTANTIATE (int)
+INSTANTIATE (std::int64_t)
+
+#undef INSTANTIATE
@@ -0,0 +1,100 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_MIXED_PRECISION_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_MIXED_PRECISION_H
+
+#include <memory>
+
+#include "cpu_bicgstab.h"
+#include "cpu_cg.h"
+#include "cpu_linear_operator.h"
+#include "cpu_row_runner.h"
+#include "solver_monitor.h"
+#include "thread_pool.h"
+
+enum class refinement_inner_solver
+{
+  cg,                 ///< cpu_cg, symmetric positive definite systems
+  bicgstab,           ///< cpu_bicgstab, classic variant
+  pipelined_bicgstab  ///< cpu_bicgstab, pipelined variant
+};
+
+/**
+ * @brief Iterative refinement with inner Krylov solves in float and residuals in double
+ *
+ * Every outer iteration computes r = b - A x with the double matrix, solves
+ * A d = r to relative residual inner_epsilon with float solver on a float
+ * copy of the matrix and adds d to x in double. Inner iterations read half
+ * the bytes of double ones, while the stopping test is done on the double
+ * residual, so the solution is as accurate as that of a double solver as
+ * long as float solves reduce the residual at all (condition number well
+ * below 1 / float epsilon). Otherwise refinement stops on stagnation and
+ * returns the last x that reduced the residual.
+ *
+ * Outer iteration takes two passes: x_next = x + d; SpMV with
+ * r = b - A x_next, float copy of r and (r, r). x_next replaces x only if
+ * its residual is smaller.
+ */
+template <class C=std::size_t>
+class cpu_mixed_precision_solver
+{
+public:
+  cpu_mixed_precision_solver () = delete;
+  cpu_mixed_precision_solver (
+    const cpu_linear_operator<double, C> &A,
+    const cpu_linear_operator<float, C> &A_low,
+    bool use_precond,
+    thread_pool &pool,
+    refinement_inner_solver inner = refinement_inner_solver::bicgstab);
+
+  /**
+   * A_low is float copy of A. max_iterations bounds inner iterations of all
+   * outer ones together, so it's comparable with max_iterations of double
+   * solvers. inner_epsilon should stay well above float epsilon times
+   * condition number: float solves don't get below that and run to
+   * max_iterations. Returns solution, which stays valid until the next call
+   * or destruction of solver.
+   */
+  double *solve (
+    const cpu_linear_operator<double, C> &A,
+    const cpu_linear_operator<float, C> &A_low,
+    const double *b,
+    double epsilon,
+    unsigned int max_iterations,
+    float inner_epsilon = 1e-3f);
+
+  /// Of the last solve, iterations are inner ones of all outer iterations
+  unsigned int get_iterations () const { return iterations; }
+  unsigned int get_outer_iterations () const { return outer_iterations; }
+  double get_relative_residual () const { return relative_residual; }
+
+  /// Last solve stopped because correction of the last outer iteration didn't reduce residual
+  bool is_stagnated () const { return stagnated; }
+
+  /// Monitor records outer iterations with inner iterations of each, should outlive solver
+  void set_monitor (solver_monitor *monitor_arg) { monitor = monitor_arg; }
+
+private:
+  const C n_rows = 0;  ///< Scalar rows
+  const C bs = 0;      ///< Scalar rows of operator unit
+
+  unsigned int iterations {};
+  unsigned int outer_iterations {};
+  double relative_residual {};
+  bool stagnated {};
+  solver_monitor *monitor = nullptr;
+
+  cpu_row_runner<double, C> runner;
+
+  std::unique_ptr<cpu_cg<float, C>> inner_cg;
+  std::unique_ptr<cpu_bicgstab<float, C>> inner_bicgstab;
+
+  std::unique_ptr<double[]> x;
+  std::unique_ptr<double[]> x_next;  ///< x + d, until its residual is known
+  std::unique_ptr<double[]> q;       ///< A x
+  std::unique_ptr<float[]> r_low;    ///< b - A x in float, right hand side of inner solve
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_MIXED_PRECISION_H
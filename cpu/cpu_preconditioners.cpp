@@ -0,0 +1,445 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_preconditioners.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+template <class T, class C>
+bool invert_dense_matrix (C n, T *matrix, T *buffer)
+{
+  /// buffer = [matrix | I], reduced to [I | matrix^-1]
+  const C width = 2 * n;
+
+  for (C row = 0; row < n; row++)
+    for (C column = 0; column < n; column++)
+      {
+        buffer[row * width + column] = matrix[row * n + column];
+        buffer[row * width + n + column] = row == column ? T {1} : T {};
+      }
+
+  for (C column = 0; column < n; column++)
+    {
+      C pivot = column;
+      for (C row = column + 1; row < n; row++)
+        if (std::abs (buffer[row * width + column]) > std::abs (buffer[pivot * width + column]))
+          pivot = row;
+
+      if (std::abs (buffer[pivot * width + column]) < 1e-20)
+        return false;
+
+      if (pivot != column)
+        std::swap_ranges (buffer + pivot * width, buffer + (pivot + 1) * width, buffer + column * width);
+
+      const T inverted_pivot = T {1} / buffer[column * width + column];
+      for (C j = 0; j < width; j++)
+        buffer[column * width + j] *= inverted_pivot;
+
+      for (C row = 0; row < n; row++)
+        {
+          if (row == column)
+            continue;
+
+          const T factor = buffer[row * width + column];
+          if (factor == T {})
+            continue;
+
+          for (C j = 0; j < width; j++)
+            buffer[row * width + j] -= factor * buffer[column * width + j];
+        }
+    }
+
+  for (C row = 0; row < n; row++)
+    for (C column = 0; column < n; column++)
+      matrix[row * n + column] = buffer[row * width + n + column];
+
+  return true;
+}
+
+namespace
+{
+
+template <int bs, class T, class C>
+void block_jacobi_apply (C first_block_row, C last_block_row, const T * __restrict__ blocks, const T *r, T *z)
+{
+  for (C block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      const T *block = blocks + block_row * bs * bs;
+
+      T r_block[bs];
+      for (int i = 0; i < bs; i++)
+        r_block[i] = r[block_row * bs + i];
+
+      for (int i = 0; i < bs; i++)
+        {
+          T sum {};
+          for (int j = 0; j < bs; j++)
+            sum += block[i * bs + j] * r_block[j];
+          z[block_row * bs + i] = sum;
+        }
+    }
+}
+
+template <class T, class C>
+void block_jacobi_apply (C bs, C first_block_row, C last_block_row, const T * __restrict__ blocks, const T *r, T *z)
+{
+  for (C block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      const T *block = blocks + block_row * bs * bs;
+      const T *r_block = r + block_row * bs;
+
+      for (C i = 0; i < bs; i++)
+        {
+          T sum {};
+          for (C j = 0; j < bs; j++)
+            sum += block[i * bs + j] * r_block[j];
+          z[block_row * bs + i] = sum;
+        }
+    }
+}
+
+/// c -= a b for row major n x n blocks
+template <class T, class C>
+void block_mult_sub (C n, const T *a, const T *b, T *c)
+{
+  for (C i = 0; i < n; i++)
+    for (C k = 0; k < n; k++)
+      {
+        const T a_ik = a[i * n + k];
+        for (C j = 0; j < n; j++)
+          c[i * n + j] -= a_ik * b[k * n + j];
+      }
+}
+
+/// c = a b for row major n x n blocks
+template <class T, class C>
+void block_mult (C n, const T *a, const T *b, T *c)
+{
+  std::fill_n (c, n * n, T {});
+  for (C i = 0; i < n; i++)
+    for (C k = 0; k < n; k++)
+      {
+        const T a_ik = a[i * n + k];
+        for (C j = 0; j < n; j++)
+          c[i * n + j] += a_ik * b[k * n + j];
+      }
+}
+
+/// z_row = r_row - sum L_row,k z_k, fixed_bs = 0 for block size known at runtime only
+template <int fixed_bs, class T, class C>
+void ilu_forward_row (C bs_arg, C row, const C *row_ptr, const C *columns, const C *diag_ptr, const T *factors, const T *r, T *z, T *buffer)
+{
+  const C bs = fixed_bs ? fixed_bs : bs_arg;
+
+  for (C i = 0; i < bs; i++)
+    buffer[i] = r[row * bs + i];
+
+  for (C block = row_ptr[row]; block < diag_ptr[row]; block++)
+    {
+      const T *L = factors + block * bs * bs;
+      const T *z_column = z + columns[block] * bs;
+
+      for (C i = 0; i < bs; i++)
+        for (C j = 0; j < bs; j++)
+          buffer[i] -= L[i * bs + j] * z_column[j];
+    }
+
+  for (C i = 0; i < bs; i++)
+    z[row * bs + i] = buffer[i];
+}
+
+/// z_row = U_row,row^-1 (z_row - sum U_row,j z_j)
+template <int fixed_bs, class T, class C>
+void ilu_backward_row (C bs_arg, C row, const C *row_ptr, const C *columns, const C *diag_ptr, const T *factors, T *z, T *buffer)
+{
+  const C bs = fixed_bs ? fixed_bs : bs_arg;
+
+  for (C i = 0; i < bs; i++)
+    buffer[i] = z[row * bs + i];
+
+  for (C block = diag_ptr[row] + 1; block < row_ptr[row + 1]; block++)
+    {
+      const T *U = factors + block * bs * bs;
+      const T *z_column = z + columns[block] * bs;
+
+      for (C i = 0; i < bs; i++)
+        for (C j = 0; j < bs; j++)
+          buffer[i] -= U[i * bs + j] * z_column[j];
+    }
+
+  const T *inverted_diagonal = factors + diag_ptr[row] * bs * bs;
+  for (C i = 0; i < bs; i++)
+    {
+      T sum {};
+      for (C j = 0; j < bs; j++)
+        sum += inverted_diagonal[i * bs + j] * buffer[j];
+      z[row * bs + i] = sum;
+    }
+}
+
+/// Identity if block is singular, same as in block-Jacobi
+template <class T, class C>
+void invert_block_or_identity (C n, T *block, T *buffer)
+{
+  if (!invert_dense_matrix (n, block, buffer))
+    for (C i = 0; i < n; i++)
+      for (C j = 0; j < n; j++)
+        block[i * n + j] = i == j ? T {1} : T {};
+}
+
+}
+
+template <class T, class C>
+cpu_block_jacobi<T, C>::cpu_block_jacobi (const bcsr_matrix_class<T, C> &A, thread_pool &pool_arg)
+  : pool (pool_arg)
+  , n_rows (A.n_rows)
+  , bs (A.bs)
+  , inverted_blocks (new T[static_cast<std::size_t> (A.n_rows) * A.bs * A.bs])
+{
+  for (unsigned int thread_id = 0; thread_id < pool.size (); thread_id++)
+    ranges.push_back (thread_range (n_rows, thread_id, pool.size ()));
+
+  /// Blocks are inverted by the thread that applies them, which is also the first touch
+  pool.run ([&] (unsigned int thread_id, unsigned int) {
+    std::unique_ptr<T[]> buffer (new T[2 * bs * bs]);
+
+    for (C block_row = ranges[thread_id].first; block_row < ranges[thread_id].second; block_row++)
+      {
+        T *block = inverted_blocks.get () + block_row * bs * bs;
+
+        const C *first = A.columns.get () + A.row_ptr[block_row];
+        const C *last = A.columns.get () + A.row_ptr[block_row + 1];
+        const C *diagonal = std::lower_bound (first, last, block_row);
+
+        if (diagonal != last && *diagonal == block_row)
+          std::copy_n (A.values.get () + (diagonal - A.columns.get ()) * bs * bs, bs * bs, block);
+        else
+          std::fill_n (block, bs * bs, T {});
+
+        invert_block_or_identity (bs, block, buffer.get ());
+      }
+  });
+}
+
+template <class T, class C>
+void cpu_block_jacobi<T, C>::apply (C first_block_row, C last_block_row, const T *r, T *z) const
+{
+  const T *blocks = inverted_blocks.get ();
+
+  switch (bs)
+    {
+      case 1: block_jacobi_apply<1> (first_block_row, last_block_row, blocks, r, z); break;
+      case 2: block_jacobi_apply<2> (first_block_row, last_block_row, blocks, r, z); break;
+      case 3: block_jacobi_apply<3> (first_block_row, last_block_row, blocks, r, z); break;
+      case 4: block_jacobi_apply<4> (first_block_row, last_block_row, blocks, r, z); break;
+      case 5: block_jacobi_apply<5> (first_block_row, last_block_row, blocks, r, z); break;
+      case 6: block_jacobi_apply<6> (first_block_row, last_block_row, blocks, r, z); break;
+      case 8: block_jacobi_apply<8> (first_block_row, last_block_row, blocks, r, z); break;
+      default: block_jacobi_apply (bs, first_block_row, last_block_row, blocks, r, z); break;
+    }
+}
+
+template <class T, class C>
+void cpu_block_jacobi<T, C>::apply (const T *r, T *z) const
+{
+  pool.run ([&] (unsigned int thread_id, unsigned int) {
+    apply (ranges[thread_id].first, ranges[thread_id].second, r, z);
+  });
+}
+
+template <class C>
+level_schedule<C>::level_schedule (C n_rows, const C *row_ptr, const C *columns, const C *diag_ptr, bool lower)
+{
+  std::vector<C> row_level (n_rows);
+  C levels = 0;
+
+  for (C step = 0; step < n_rows; step++)
+    {
+      const C row = lower ? step : n_rows - 1 - step;
+      const C first = lower ? row_ptr[row] : diag_ptr[row] + 1;
+      const C last = lower ? diag_ptr[row] : row_ptr[row + 1];
+
+      C level = 0;
+      for (C block = first; block < last; block++)
+        level = std::max (level, row_level[columns[block]] + 1);
+
+      row_level[row] = level;
+      levels = std::max (levels, level + 1);
+    }
+
+  level_ptr.assign (levels + 1, 0);
+  for (C row = 0; row < n_rows; row++)
+    level_ptr[row_level[row] + 1]++;
+  for (C level = 0; level < levels; level++)
+    level_ptr[level + 1] += level_ptr[level];
+
+  /// Rows of a level stay in increasing order, so threads read neighbouring parts of vectors
+  rows.resize (n_rows);
+  std::vector<C> offsets (level_ptr.begin (), level_ptr.end () - 1);
+  for (C row = 0; row < n_rows; row++)
+    rows[offsets[row_level[row]]++] = row;
+}
+
+template <class T, class C>
+cpu_block_ilu0<T, C>::cpu_block_ilu0 (const bcsr_matrix_class<T, C> &A, thread_pool &pool_arg)
+  : pool (pool_arg)
+  , n_rows (A.n_rows)
+  , bs (A.bs)
+  , row_ptr (new C[A.n_rows + 1])
+  , columns (new C[A.nnzb])
+  , diag_ptr (new C[A.n_rows])
+  , factors (new T[static_cast<std::size_t> (A.nnzb) * A.bs * A.bs])
+{
+  std::copy_n (A.row_ptr.get (), n_rows + 1, row_ptr.get ());
+  std::copy_n (A.columns.get (), A.nnzb, columns.get ());
+
+  for (C row = 0; row < n_rows; row++)
+    {
+      const C *first = columns.get () + row_ptr[row];
+      const C *last = columns.get () + row_ptr[row + 1];
+      const C *diagonal = std::lower_bound (first, last, row);
+
+      if (diagonal == last || *diagonal != row)
+        throw std::runtime_error ("Error! BILU(0) needs diagonal block in every row");
+
+      diag_ptr[row] = diagonal - columns.get ();
+    }
+
+  lower = level_schedule<C> (n_rows, row_ptr.get (), columns.get (), diag_ptr.get (), true);
+  upper = level_schedule<C> (n_rows, row_ptr.get (), columns.get (), diag_ptr.get (), false);
+
+  const C max_levels = std::max (lower.levels_count (), upper.levels_count ());
+  is_level_parallel = pool.size () > 1 && n_rows >= max_levels * min_level_rows_per_thread * static_cast<C> (pool.size ());
+
+  /// Row i only reads rows of L dependencies, which are finished by previous levels
+  spin_barrier barrier (is_level_parallel ? pool.size () : 1);
+
+  auto factorize = [&] (unsigned int thread_id, unsigned int threads_count) {
+    const C block_size = bs * bs;
+    std::unique_ptr<T[]> buffer (new T[2 * block_size]);
+    std::unique_ptr<T[]> l_block (new T[block_size]);
+
+    for (C level = 0; level < lower.levels_count (); level++)
+      {
+        const C level_size = lower.level_ptr[level + 1] - lower.level_ptr[level];
+        const auto [first, last] = thread_range (level_size, thread_id, threads_count);
+
+        for (C position = lower.level_ptr[level] + first; position < lower.level_ptr[level] + last; position++)
+          {
+            const C row = lower.rows[position];
+
+            std::copy_n (A.values.get () + row_ptr[row] * block_size, (row_ptr[row + 1] - row_ptr[row]) * block_size, factors.get () + row_ptr[row] * block_size);
+
+            for (C block = row_ptr[row]; block < diag_ptr[row]; block++)
+              {
+                const C k = columns[block];
+
+                /// L_ik = A_ik U_kk^-1
+                T *L = factors.get () + block * block_size;
+                block_mult (bs, L, factors.get () + diag_ptr[k] * block_size, l_block.get ());
+                std::copy_n (l_block.get (), block_size, L);
+
+                /// A_ij -= L_ik U_kj for j > k present in both rows
+                C row_block = block + 1;
+                C k_block = diag_ptr[k] + 1;
+
+                while (row_block < row_ptr[row + 1] && k_block < row_ptr[k + 1])
+                  {
+                    if (columns[row_block] < columns[k_block])
+                      row_block++;
+                    else if (columns[row_block] > columns[k_block])
+                      k_block++;
+                    else
+                      block_mult_sub (bs, L, factors.get () + k_block++ * block_size, factors.get () + row_block++ * block_size);
+                  }
+              }
+
+            invert_block_or_identity (bs, factors.get () + diag_ptr[row] * block_size, buffer.get ());
+          }
+
+        barrier.wait ();
+      }
+  };
+
+  if (is_level_parallel)
+    pool.run (factorize);
+  else
+    factorize (0, 1);
+}
+
+template <class T, class C>
+template <int fixed_bs>
+void cpu_block_ilu0<T, C>::apply_levels (const T *r, T *z) const
+{
+  spin_barrier barrier (is_level_parallel ? pool.size () : 1);
+
+  auto solve = [&] (unsigned int thread_id, unsigned int threads_count) {
+    std::unique_ptr<T[]> buffer (new T[bs]);
+
+    for (C level = 0; level < lower.levels_count (); level++)
+      {
+        const C level_size = lower.level_ptr[level + 1] - lower.level_ptr[level];
+        const auto [first, last] = thread_range (level_size, thread_id, threads_count);
+
+        for (C position = lower.level_ptr[level] + first; position < lower.level_ptr[level] + last; position++)
+          ilu_forward_row<fixed_bs> (bs, lower.rows[position], row_ptr.get (), columns.get (), diag_ptr.get (), factors.get (), r, z, buffer.get ());
+
+        barrier.wait ();
+      }
+
+    for (C level = 0; level < upper.levels_count (); level++)
+      {
+        const C level_size = upper.level_ptr[level + 1] - upper.level_ptr[level];
+        const auto [first, last] = thread_range (level_size, thread_id, threads_count);
+
+        for (C position = upper.level_ptr[level] + first; position < upper.level_ptr[level] + last; position++)
+          ilu_backward_row<fixed_bs> (bs, upper.rows[position], row_ptr.get (), columns.get (), diag_ptr.get (), factors.get (), z, buffer.get ());
+
+        barrier.wait ();
+      }
+  };
+
+  if (is_level_parallel)
+    pool.run (solve);
+  else
+    solve (0, 1);
+}
+
+template <class T, class C>
+void cpu_block_ilu0<T, C>::apply (const T *r, T *z) const
+{
+  switch (bs)
+    {
+      case 1: apply_levels<1> (r, z); break;
+      case 2: apply_levels<2> (r, z); break;
+      case 3: apply_levels<3> (r, z); break;
+      case 4: apply_levels<4> (r, z); break;
+      case 5: apply_levels<5> (r, z); break;
+      case 6: apply_levels<6> (r, z); break;
+      case 8: apply_levels<8> (r, z); break;
+      default: apply_levels<0> (r, z); break;
+    }
+}
+
+#define INSTANTIATE(DTYPE,ITYPE) \
+  template class cpu_block_jacobi<DTYPE, ITYPE>; \
+  template class cpu_block_ilu0<DTYPE, ITYPE>;
+
+INSTANTIATE (float,  int)
+INSTANTIATE (double, int)
+INSTANTIATE (float,  std::int64_t)
+INSTANTIATE (double, std::int64_t)
+
+#undef INSTANTIATE
+
+template bool invert_dense_matrix (int, float *, float *);
+template bool invert_dense_matrix (int, double *, double *);
+template bool invert_dense_matrix (std::int64_t, float *, float *);
+template bool invert_dense_matrix (std::int64_t, double *, double *);
+
+template class level_schedule<int>;
+template class level_schedule<std::int64_t>;
@@ -0,0 +1,141 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_PRECONDITIONERS_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_PRECONDITIONERS_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "matrix_converters.h"
+#include "thread_pool.h"
+
+/// Invert row major n x n matrix in place by Gauss-Jordan elimination with partial pivoting, buffer has 2 n^2 elements. Returns false if it's singular.
+template <class T, class C>
+bool invert_dense_matrix (C n, T *matrix, T *buffer);
+
+/**
+ * @brief Preconditioner M of CPU solvers
+ *
+ * Solvers call apply once per preconditioned vector. Implementations split
+ * the work between threads of the pool they were built with.
+ */
+template <class T, class C>
+class cpu_preconditioner
+{
+public:
+  virtual ~cpu_preconditioner () = default;
+
+  /// Scalar rows of M
+  virtual C size () const = 0;
+
+  /// z = M^-1 r, z and r don't overlap
+  virtual void apply (const T *r, T *z) const = 0;
+};
+
+/**
+ * @brief Block-Jacobi preconditioner built from the diagonal blocks of BCSR matrix
+ *
+ * Scalar Jacobi ignores coupling of unknowns of one node (x and y
+ * displacements of the bridge). Here each bs x bs diagonal block is inverted
+ * by Gauss-Jordan elimination with partial pivoting, so apply is a batch of
+ * small dense products with kernels specialized for common block sizes.
+ * Blocks that are singular (or missing) are replaced with identity, as zero
+ * diagonal elements are in scalar Jacobi.
+ */
+template <class T, class C>
+class cpu_block_jacobi : public cpu_preconditioner<T, C>
+{
+public:
+  cpu_block_jacobi (const bcsr_matrix_class<T, C> &A, thread_pool &pool);
+
+  C size () const override { return n_rows * bs; }
+  void apply (const T *r, T *z) const override;
+
+  /// Rows [first_block_row, last_block_row) of z = M^-1 r, for solvers that fuse it into their own loops
+  void apply (C first_block_row, C last_block_row, const T *r, T *z) const;
+
+  C get_block_size () const { return bs; }
+  const T *get_inverted_blocks () const { return inverted_blocks.get (); }
+
+private:
+  thread_pool &pool;
+
+  const C n_rows {};  ///< Block rows
+  const C bs {};
+
+  std::vector<std::pair<C, C>> ranges;  ///< Block rows of each thread
+  std::unique_ptr<T[]> inverted_blocks; ///< Row major, bs * bs per block row
+};
+
+/// Rows of triangular solve grouped so that rows of one level depend only on previous levels
+template <class C>
+class level_schedule
+{
+public:
+  level_schedule () = default;
+
+  /// Dependencies of row are columns [row_ptr[row], diag_ptr[row]) for lower, (diag_ptr[row], row_ptr[row + 1]) for upper
+  level_schedule (C n_rows, const C *row_ptr, const C *columns, const C *diag_ptr, bool lower);
+
+  C levels_count () const { return static_cast<C> (level_ptr.size ()) - 1; }
+
+public:
+  std::vector<C> level_ptr; ///< Level l has rows[level_ptr[l]] ... rows[level_ptr[l + 1] - 1]
+  std::vector<C> rows;
+};
+
+/**
+ * @brief Block ILU(0) preconditioner on the pattern of BCSR matrix
+ *
+ * Factors are stored in a copy of the matrix values: strictly lower blocks
+ * hold L (unit diagonal is implied), upper ones U and diagonal blocks the
+ * inverted diagonal of U. Singular pivot blocks are replaced by identity.
+ *
+ * Level sets of L and U are computed once in the constructor. Rows of a
+ * level are split between threads and levels are separated by spin_barrier
+ * inside a single thread_pool::run, both in factorization (which has the
+ * dependencies of L) and in apply. Matrices in natural FEM ordering often
+ * have narrow levels (the bridge has ~2.5 block rows per level), where a
+ * barrier costs more than the rows it separates. If levels have fewer than
+ * min_level_rows_per_thread rows per thread on average, factorization and
+ * solves run sequentially in the calling thread instead.
+ */
+template <class T, class C>
+class cpu_block_ilu0 : public cpu_preconditioner<T, C>
+{
+public:
+  cpu_block_ilu0 (const bcsr_matrix_class<T, C> &A, thread_pool &pool);
+
+  C size () const override { return n_rows * bs; }
+  void apply (const T *r, T *z) const override;
+
+  /// Levels of forward and backward solves
+  std::pair<C, C> get_levels_count () const { return { lower.levels_count (), upper.levels_count () }; }
+  bool is_parallel () const { return is_level_parallel; }
+
+  static constexpr C min_level_rows_per_thread = 64;
+
+private:
+  template <int fixed_bs>
+  void apply_levels (const T *r, T *z) const;
+
+private:
+  thread_pool &pool;
+
+  const C n_rows {};  ///< Block rows
+  const C bs {};
+
+  std::unique_ptr<C[]> row_ptr;
+  std::unique_ptr<C[]> columns;
+  std::unique_ptr<C[]> diag_ptr;  ///< Position of diagonal block in row
+  std::unique_ptr<T[]> factors;   ///< Row major blocks, see class description
+
+  level_schedule<C> lower;
+  level_schedule<C> upper;
+  bool is_level_parallel = false;
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_PRECONDITIONERS_H
@@ -0,0 +1,581 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#include "cpu_recycling_cg.h"
+#include "cpu_preconditioners.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+/// Eigenvalues and eigenvectors (columns) of symmetric row major n x n matrix a by cyclic Jacobi rotations, a is destroyed
+void symmetric_eigen (unsigned int n, std::vector<double> &a, std::vector<double> &values, std::vector<double> &vectors)
+{
+  vectors.assign (n * n, 0.0);
+  for (unsigned int i = 0; i < n; i++)
+    vectors[i * n + i] = 1.0;
+
+  for (unsigned int sweep = 0; sweep < 64; sweep++)
+    {
+      double diagonal {};
+      double off_diagonal {};
+
+      for (unsigned int i = 0; i < n; i++)
+        for (unsigned int j = 0; j < n; j++)
+          (i == j ? diagonal : off_diagonal) += a[i * n + j] * a[i * n + j];
+
+      if (off_diagonal <= 1e-30 * diagonal)
+        break;
+
+      for (unsigned int p = 0; p < n; p++)
+        for (unsigned int q = p + 1; q < n; q++)
+          {
+            const double apq = a[p * n + q];
+            if (apq == 0.0)
+              continue;
+
+            /// Rotation in (p, q) plane that zeroes a[p][q]
+            const double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+            const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs (theta) + std::sqrt (theta * theta + 1.0));
+            const double c = 1.0 / std::sqrt (t * t + 1.0);
+            const double s = t * c;
+
+            for (unsigned int k = 0; k < n; k++)
+              {
+                const double akp = a[k * n + p];
+                const double akq = a[k * n + q];
+                a[k * n + p] = c * akp - s * akq;
+                a[k * n + q] = s * akp + c * akq;
+              }
+
+            for (unsigned int k = 0; k < n; k++)
+              {
+                const double apk = a[p * n + k];
+                const double aqk = a[q * n + k];
+                a[p * n + k] = c * apk - s * aqk;
+                a[q * n + k] = s * apk + c * aqk;
+              }
+
+            for (unsigned int k = 0; k < n; k++)
+              {
+                const double vkp = vectors[k * n + p];
+                const double vkq = vectors[k * n + q];
+                vectors[k * n + p] = c * vkp - s * vkq;
+                vectors[k * n + q] = s * vkp + c * vkq;
+              }
+          }
+    }
+
+  values.resize (n);
+  for (unsigned int i = 0; i < n; i++)
+    values[i] = a[i * n + i];
+}
+
+}
+
+template <class T, class C>
+cpu_recycling_cg<T, C>::cpu_recycling_cg (const cpu_linear_operator<T, C> &A, bool use_precond, thread_pool &pool, unsigned int max_recycled_arg)
+  : n_rows (A.size ())
+  , bs (A.unit_rows ())
+  , max_recycled (max_recycled_arg)
+  , runner (pool, A.partition (pool.size ()))
+  , x (new T[n_rows])
+  , r (new T[n_rows])
+  , p (new T[n_rows])
+  , q (new T[n_rows])
+{
+  if (use_precond)
+    {
+      P.reset (new T[n_rows]);
+      z.reset (new T[n_rows]);
+    }
+
+  if (max_recycled > max_recycled_limit)
+    throw std::runtime_error ("Error! Recycled subspace is limited to " + std::to_string (max_recycled_limit) + " vectors");
+
+  if (max_recycled > 0)
+    {
+      W.reset (new T[n_rows * max_recycled]);
+      AW.reset (new T[n_rows * max_recycled]);
+      W_next.reset (new T[n_rows * max_recycled]);
+      AW_next.reset (new T[n_rows * max_recycled]);
+      S.reset (new T[n_rows * max_recycled]);
+      AS.reset (new T[n_rows * max_recycled]);
+    }
+
+  /// First touch by the thread that owns rows
+  runner.template run<0> ([&] (C first, C last, T *) {
+    for (T *vector: { x.get (), r.get (), p.get (), q.get (), z.get (), P.get () })
+      if (vector)
+        std::fill (vector + first * bs, vector + last * bs, T {});
+    for (T *vectors: { W.get (), AW.get (), W_next.get (), AW_next.get (), S.get (), AS.get () })
+      if (vectors)
+        std::fill (vectors + first * bs * max_recycled, vectors + last * bs * max_recycled, T {});
+  });
+}
+
+template <class T, class C>
+void cpu_recycling_cg<T, C>::reset ()
+{
+  recycled = 0;
+  has_solution = false;
+  refreshing = true;
+  best_iterations = 0;
+  stalled_solves = 0;
+  E_inverse.clear ();
+}
+
+template <class T, class C>
+T *cpu_recycling_cg<T, C>::solve (const cpu_linear_operator<T, C> &A, const T *b, T epsilon, unsigned int max_iterations)
+{
+  T *x = this->x.get ();
+  T *r = this->r.get ();
+  T *p = this->p.get ();
+  T *q = this->q.get ();
+  T *P = this->P.get ();
+  T *z = P ? this->z.get () : r;
+  T *W = this->W.get ();
+  T *AW = this->AW.get ();
+  T *W_next = this->W_next.get ();
+  T *AW_next = this->AW_next.get ();
+  T *S = this->S.get ();
+  T *AS = this->AS.get ();
+
+  const unsigned int m = recycled;
+  const unsigned int ld = max_recycled;
+  const bool refresh = ld > 0 && refreshing;
+  const bool warm_start = has_solution;
+
+  std::vector<T> coefficients (m);
+
+  /// coefficients = E^-1 v for v = W^T r or (A W)^T z
+  auto project = [&] (const T *v) {
+    for (unsigned int i = 0; i < m; i++)
+      {
+        double sum {};
+        for (unsigned int j = 0; j < m; j++)
+          sum += E_inverse[i * m + j] * v[j];
+        coefficients[i] = static_cast<T> (sum);
+      }
+  };
+
+  iterations = 0;
+  relative_residual = T {};
+  candidates = m;
+
+  if (monitor)
+    monitor->start ("recycling-cg", { "rz", "beta", "alpha", "pq" }, max_iterations);
+
+  /// Jacobi preconditioner; r0 = b - A x0 for previous solution x0 or r0 = b (x0 = 0); (b, b), W^T r0; candidates start from W when refreshed
+  const T *initial_sums = runner.run (1 + m, [&] (C first, C last, T *sums) {
+    if (P)
+      {
+        A.diagonal (first, last, P);
+        for (C row = first * bs; row < last * bs; row++)
+          P[row] = std::abs (P[row]) < 1e-20 ? 1.0 : 1.0 / P[row];
+      }
+
+    if (warm_start)
+      A.apply (first, last, x, q);
+
+    T bb {};
+    T wr[max_recycled_limit] {};
+
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        if (!warm_start)
+          x[row] = T {};
+
+        r[row] = warm_start ? b[row] - q[row] : b[row];
+        bb += b[row] * b[row];
+
+        for (unsigned int j = 0; j < m; j++)
+          {
+            wr[j] += W[row * ld + j] * r[row];
+
+            if (refresh)
+              {
+                W_next[row * ld + j] = W[row * ld + j];
+                AW_next[row * ld + j] = AW[row * ld + j];
+              }
+          }
+      }
+
+    sums[0] = bb;
+    std::copy_n (wr, m, sums + 1);
+  });
+
+  const T norm_b = std::sqrt (initial_sums[0]);
+
+  if (norm_b == T {})
+    {
+      runner.template run<0> ([&] (C first, C last, T *) {
+        std::fill (x + first * bs, x + last * bs, T {});
+      });
+
+      has_solution = true;
+
+      if (monitor)
+        monitor->finish ();
+
+      return x;
+    }
+
+  project (initial_sums + 1);
+
+  /// x += alpha p; r -= alpha q; z = M^-1 r; (r, z), (r, r), (A W)^T z, with alpha = 1, p = W c, q = A W c to start
+  auto update_residual = [&] (T alpha, bool from_subspace) {
+    return runner.run (2 + m, [&] (C first, C last, T *sums) {
+      T rz_sum {};
+      T rr_sum {};
+      T awz[max_recycled_limit] {};
+
+      for (C row = first * bs; row < last * bs; row++)
+        {
+          if (from_subspace)
+            {
+              T wc {};
+              T awc {};
+              for (unsigned int j = 0; j < m; j++)
+                {
+                  wc += W[row * ld + j] * coefficients[j];
+                  awc += AW[row * ld + j] * coefficients[j];
+                }
+
+              x[row] += wc;
+              r[row] -= awc;
+            }
+          else
+            {
+              x[row] += alpha * p[row];
+              r[row] -= alpha * q[row];
+            }
+
+          if (P)
+            z[row] = P[row] * r[row];
+
+          rz_sum += r[row] * z[row];
+          rr_sum += r[row] * r[row];
+
+          for (unsigned int j = 0; j < m; j++)
+            awz[j] += AW[row * ld + j] * z[row];
+        }
+
+      sums[0] = rz_sum;
+      sums[1] = rr_sum;
+      std::copy_n (awz, m, sums + 2);
+    });
+  };
+
+  /// p = z + beta p - W mu for mu = E^-1 (A W)^T z
+  auto update_direction = [&] (T beta) {
+    runner.template run<0> ([&] (C first, C last, T *) {
+      for (C row = first * bs; row < last * bs; row++)
+        {
+          T w_mu {};
+          for (unsigned int j = 0; j < m; j++)
+            w_mu += W[row * ld + j] * coefficients[j];
+          p[row] = z[row] + beta * p[row] - w_mu;
+        }
+    });
+  };
+
+  /// x0 += W c, r0 -= A W c for c = E^-1 W^T r0, so r0 is orthogonal to W
+  const T *sums = update_residual (T {}, true);
+
+  T rz = sums[0];
+  relative_residual = std::sqrt (sums[1]) / norm_b;
+
+  project (sums + 2);
+  update_direction (T {});
+
+  unsigned int stored = 0;
+  bool breakdown = false;
+  T beta {};
+
+  for (unsigned int i = 0; i < max_iterations && relative_residual >= epsilon; )
+    {
+      i++;
+
+      /// q = A p; (p, q); search directions are kept for candidates of the next subspace
+      const auto [pq] = runner.template run<1> ([&] (C first, C last, T *thread_sums) {
+        thread_sums[0] = A.apply_dot (first, last, p, q);
+
+        if (refresh)
+          for (C row = first * bs; row < last * bs; row++)
+            {
+              S[stored * n_rows + row] = p[row];
+              AS[stored * n_rows + row] = q[row];
+            }
+      });
+
+      if (refresh)
+        stored++;
+
+      const T alpha = rz / pq;
+
+      sums = update_residual (alpha, false);
+
+      const T rz_new = sums[0];
+      const T norm_r = std::sqrt (sums[1]);
+
+      if (monitor)
+        monitor->record (norm_r / norm_b, { rz_new, beta, alpha, pq });
+
+      iterations = i;
+      relative_residual = norm_r / norm_b;
+
+      if (relative_residual < epsilon) break;
+
+      if (!std::isfinite (norm_r))
+        {
+          std::cout << "Breakdown at iteration " << i << std::endl;
+          breakdown = true;
+          break;
+        }
+
+      beta = rz_new / rz;
+      rz = rz_new;
+
+      project (sums + 2);
+      update_direction (beta);
+
+      if (refresh && stored == ld)
+        {
+          update_candidates (stored);
+          stored = 0;
+        }
+    }
+
+  if (monitor)
+    monitor->finish ();
+
+  if (breakdown)
+    {
+      reset ();
+      return x;
+    }
+
+  if (refresh)
+    {
+      if (stored > 0)
+        update_candidates (stored);
+
+      std::swap (this->W, this->W_next);
+      std::swap (this->AW, this->AW_next);
+      recycled = candidates;
+      E_inverse = E_next_inverse;
+
+      /// Slow modes belong to the matrix, not to the load, once solves stop gaining on the best one subspace is kept as is.
+      /// Ritz vectors of short (loose epsilon) solves converge over several of them, so a single solve without gain isn't enough.
+      if (best_iterations == 0 || iterations < refresh_gain * best_iterations)
+        stalled_solves = 0;
+      else if (++stalled_solves >= refresh_patience)
+        refreshing = false;
+      if (best_iterations == 0 || iterations < best_iterations)
+        best_iterations = iterations;
+    }
+
+  has_solution = true;
+
+  return x;
+}
+
+template <class T, class C>
+void cpu_recycling_cg<T, C>::update_candidates (unsigned int stored)
+{
+  const unsigned int m = candidates;
+  const unsigned int ld = max_recycled;
+  const unsigned int n = m + stored;
+
+  T *P = this->P.get ();
+  T *W = this->W_next.get ();
+  T *AW = this->AW_next.get ();
+  T *S = this->S.get ();
+  T *AS = this->AS.get ();
+
+  /// Row of Z = [W_next, S] and A Z
+  auto load_row = [&] (C row, T *z_row, T *az_row) {
+    for (unsigned int j = 0; j < m; j++)
+      {
+        z_row[j] = W[row * ld + j];
+        az_row[j] = AW[row * ld + j];
+      }
+    for (unsigned int j = 0; j < stored; j++)
+      {
+        z_row[m + j] = S[j * n_rows + row];
+        az_row[m + j] = AS[j * n_rows + row];
+      }
+  };
+
+  /// Upper triangles of F = Z^T M Z and G = Z^T A Z
+  const unsigned int triangle = n * (n + 1) / 2;
+  const T *gram = runner.run (2 * triangle, [&] (C first, C last, T *sums) {
+    T z_row[2 * max_recycled_limit];
+    T az_row[2 * max_recycled_limit];
+
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        load_row (row, z_row, az_row);
+        const T weight = P ? T {1} / P[row] : T {1};
+
+        unsigned int id = 0;
+        for (unsigned int a = 0; a < n; a++)
+          {
+            const T weighted = weight * z_row[a];
+            for (unsigned int b = a; b < n; b++, id++)
+              {
+                sums[id] += weighted * z_row[b];
+                sums[triangle + id] += z_row[a] * az_row[b];
+              }
+          }
+      }
+  });
+
+  std::vector<double> F (n * n);
+  std::vector<double> G (n * n);
+
+  for (unsigned int a = 0, id = 0; a < n; a++)
+    for (unsigned int b = a; b < n; b++, id++)
+      {
+        F[a * n + b] = F[b * n + a] = gram[id];
+        G[a * n + b] = G[b * n + a] = gram[triangle + id];
+      }
+
+  /// Columns of Z are scaled to unit M-norm, so that the rank threshold is relative to each of them
+  std::vector<double> scale (n);
+  for (unsigned int a = 0; a < n; a++)
+    scale[a] = F[a * n + a] > 0.0 ? 1.0 / std::sqrt (F[a * n + a]) : 0.0;
+
+  for (unsigned int a = 0; a < n; a++)
+    for (unsigned int b = 0; b < n; b++)
+      {
+        F[a * n + b] *= scale[a] * scale[b];
+        G[a * n + b] *= scale[a] * scale[b];
+      }
+
+  /// M-orthonormal basis B = U_k Lambda_k^-1/2 of span Z, directions of small eigenvalues of F are dependent
+  std::vector<double> lambda;
+  std::vector<double> U;
+  std::vector<double> F_copy = F;
+  symmetric_eigen (n, F_copy, lambda, U);
+
+  const double lambda_max = *std::max_element (lambda.begin (), lambda.end ());
+  std::vector<unsigned int> independent;
+  for (unsigned int i = 0; i < n; i++)
+    if (lambda[i] > 1e-10 * lambda_max)
+      independent.push_back (i);
+
+  const unsigned int k = static_cast<unsigned int> (independent.size ());
+
+  std::vector<double> B (n * k);
+  for (unsigned int a = 0; a < n; a++)
+    for (unsigned int i = 0; i < k; i++)
+      B[a * k + i] = U[a * n + independent[i]] / std::sqrt (lambda[independent[i]]);
+
+  /// Ritz values and vectors: H = B^T G B = V Theta V^T
+  std::vector<double> GB (n * k);
+  for (unsigned int a = 0; a < n; a++)
+    for (unsigned int i = 0; i < k; i++)
+      {
+        double sum {};
+        for (unsigned int b = 0; b < n; b++)
+          sum += G[a * n + b] * B[b * k + i];
+        GB[a * k + i] = sum;
+      }
+
+  std::vector<double> H (k * k);
+  for (unsigned int i = 0; i < k; i++)
+    for (unsigned int j = 0; j < k; j++)
+      {
+        double sum {};
+        for (unsigned int a = 0; a < n; a++)
+          sum += B[a * k + i] * GB[a * k + j];
+        H[i * k + j] = sum;
+      }
+
+  std::vector<double> theta;
+  std::vector<double> V;
+  symmetric_eigen (k, H, theta, V);
+
+  std::vector<unsigned int> order (k);
+  std::iota (order.begin (), order.end (), 0u);
+  std::sort (order.begin (), order.end (), [&] (unsigned int lhs, unsigned int rhs) { return theta[lhs] < theta[rhs]; });
+
+  /// A is SPD, non positive Ritz values come from rounding
+  std::vector<unsigned int> selected;
+  for (unsigned int i: order)
+    if (theta[i] > 0.0 && selected.size () < ld)
+      selected.push_back (i);
+
+  const unsigned int count = static_cast<unsigned int> (selected.size ());
+
+  /// Ritz vectors Z Y for Y = D B V in coefficients of unscaled Z; Y^T G Y is diagonal of Ritz values up to rounding
+  std::vector<T> Y (n * count);
+  std::vector<double> E (count * count, 0.0);
+  std::vector<double> buffer (2 * count * count);
+
+  for (unsigned int j = 0; j < count; j++)
+    {
+      E[j * count + j] = theta[selected[j]];
+
+      for (unsigned int a = 0; a < n; a++)
+        {
+          double sum {};
+          for (unsigned int i = 0; i < k; i++)
+            sum += B[a * k + i] * V[i * k + selected[j]];
+          Y[a * count + j] = static_cast<T> (scale[a] * sum);
+        }
+    }
+
+  if (count == 0 || !invert_dense_matrix (static_cast<C> (count), E.data (), buffer.data ()))
+    {
+      candidates = 0;
+      E_next_inverse.clear ();
+      return;
+    }
+
+  runner.template run<0> ([&] (C first, C last, T *) {
+    T z_row[2 * max_recycled_limit];
+    T az_row[2 * max_recycled_limit];
+
+    for (C row = first * bs; row < last * bs; row++)
+      {
+        load_row (row, z_row, az_row);
+
+        for (unsigned int j = 0; j < count; j++)
+          {
+            T w {};
+            T aw {};
+            for (unsigned int a = 0; a < n; a++)
+              {
+                w += z_row[a] * Y[a * count + j];
+                aw += az_row[a] * Y[a * count + j];
+              }
+            W[row * ld + j] = w;
+            AW[row * ld + j] = aw;
+          }
+      }
+  });
+
+  candidates = count;
+  E_next_inverse = std::move (E);
+}
+
+#define INSTANTIATE(DTYPE,ITYPE) \
+  template class cpu_recycling_cg<DTYPE, ITYPE>;
+
+INSTANTIATE (float,  int)
+INSTANTIATE (double, int)
+INSTANTIATE (float,  std::int64_t)
+INSTANTIATE (double, std::int64_t)
+
+#undef INSTANTIATE
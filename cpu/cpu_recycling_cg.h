@@ -0,0 +1,107 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_RECYCLING_CG_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_RECYCLING_CG_H
+
+#include <memory>
+#include <vector>
+
+#include "cpu_linear_operator.h"
+#include "cpu_row_runner.h"
+#include "solver_monitor.h"
+#include "thread_pool.h"
+
+/**
+ * @brief Deflated CG for a sequence of systems with the same matrix (moving load)
+ *
+ * Solver keeps a recycled subspace W of up to max_recycled vectors together
+ * with A W. Every solve starts from the previous solution, corrects it on W
+ * and keeps search directions A-orthogonal to W: p = z + beta p - W mu with
+ * (W^T A W) mu = (A W)^T z. Components of the solution along W are never
+ * searched for again, so slow modes of the spectrum found by one solve don't
+ * slow down the next ones.
+ *
+ * Subspace for the next solve starts from W and every max_recycled
+ * iterations is replaced by Ritz vectors of the smallest Ritz values of
+ * (A, M) on its span and the latest search directions (M is the Jacobi
+ * preconditioner or identity), so it follows the slowest modes through the
+ * whole sequence. Stored A p avoid extra SpMVs, an update takes one pass for
+ * Gram matrices and one for new vectors. Once refresh_patience solves in a
+ * row take no less than refresh_gain of iterations of the best one, the
+ * subspace is kept as is until reset and iterations don't pay for stored
+ * directions and updates.
+ *
+ * Iteration is cpu_cg with (A W)^T z reduced in the residual pass and W mu
+ * subtracted in the search direction pass.
+ */
+template <class T, class C=std::size_t>
+class cpu_recycling_cg
+{
+public:
+  cpu_recycling_cg () = delete;
+  cpu_recycling_cg (const cpu_linear_operator<T, C> &A, bool use_precond, thread_pool &pool, unsigned int max_recycled = 8);
+
+  /// Starts from the solution of the previous call (zero for the first one), returns solution that stays valid until the next call
+  T *solve (const cpu_linear_operator<T, C> &A, const T *b, T epsilon, unsigned int max_iterations);
+
+  /// Forget previous solution and recycled subspace, e.g. after matrix changed
+  void reset ();
+
+  /// Of the last solve
+  unsigned int get_iterations () const { return iterations; }
+  T get_relative_residual () const { return relative_residual; }
+
+  /// Vectors in recycled subspace for the next solve
+  unsigned int get_recycled_count () const { return recycled; }
+
+  /// Monitor should outlive solver, null stops recording
+  void set_monitor (solver_monitor *monitor_arg) { monitor = monitor_arg; }
+
+  static constexpr unsigned int max_recycled_limit = 32;
+  static constexpr double refresh_gain = 0.95;
+  static constexpr unsigned int refresh_patience = 2;
+
+private:
+  /// W_next = [W_next, S] Y for Ritz vectors Y of the smallest Ritz values
+  void update_candidates (unsigned int stored);
+
+private:
+  const C n_rows = 0;  ///< Scalar rows
+  const C bs = 0;      ///< Scalar rows of operator unit
+  const unsigned int max_recycled = 0;
+
+  unsigned int recycled = 0;    ///< Columns of W in use
+  unsigned int candidates = 0;  ///< Columns of W_next in use
+  bool has_solution = false;
+  bool refreshing = true;                ///< Candidates are updated during solves
+  unsigned int best_iterations = 0;      ///< Fewest iterations of refreshed solves
+  unsigned int stalled_solves = 0;       ///< Refreshed solves in a row without gain on best_iterations
+
+  unsigned int iterations {};
+  T relative_residual {};
+  solver_monitor *monitor = nullptr;
+
+  cpu_row_runner<T, C> runner;
+
+  std::unique_ptr<T[]> x;
+  std::unique_ptr<T[]> r;
+  std::unique_ptr<T[]> p;
+  std::unique_ptr<T[]> q;  ///< A p
+  std::unique_ptr<T[]> z;  ///< M^-1 r, alias of r without preconditioner
+  std::unique_ptr<T[]> P;  ///< Inverted diagonal
+
+  /// Element of column j in row i is at i * max_recycled + j
+  std::unique_ptr<T[]> W;
+  std::unique_ptr<T[]> AW;
+  std::unique_ptr<T[]> W_next;  ///< Candidates for the next solve
+  std::unique_ptr<T[]> AW_next;
+  std::unique_ptr<T[]> S;       ///< Search directions since the last update of candidates
+  std::unique_ptr<T[]> AS;
+
+  std::vector<double> E_inverse;       ///< (W^T A W)^-1, recycled x recycled
+  std::vector<double> E_next_inverse;  ///< (W_next^T A W_next)^-1
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_RECYCLING_CG_H
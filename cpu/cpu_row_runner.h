@@ -0,0 +1,92 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_ROW_RUNNER_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_ROW_RUNNER_H
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.h"
+
+/**
+ * @brief Fused loops of CPU solvers: every thread runs an action on its rows and sums of actions are reduced
+ *
+ * Threads keep the same rows in all calls, so with first touch through run
+ * each thread works on memory of its NUMA node. Partial sums of threads are
+ * kept a cache line apart and reduced in thread order, which keeps results
+ * reproducible for the same threads count.
+ */
+template <class T, class C>
+class cpu_row_runner
+{
+public:
+  cpu_row_runner (thread_pool &pool_arg, std::vector<std::pair<C, C>> ranges_arg)
+    : pool (pool_arg)
+    , ranges (std::move (ranges_arg))
+    , partial_sums (pool_arg.size () * sums_stride)
+  {
+  }
+
+  /// Run action (first_row, last_row, sums) on rows of every thread and return sums reduced over threads
+  template <int sums_count, typename action_type>
+  std::array<T, sums_count> run (const action_type &action)
+  {
+    static_assert (sums_count <= static_cast<int> (sums_stride), "Partial sums don't fit cache line");
+
+    pool.run ([&] (unsigned int thread_id, unsigned int) {
+      T *sums = partial_sums.data () + thread_id * sums_stride;
+      std::fill_n (sums, sums_count, T {});
+      action (ranges[thread_id].first, ranges[thread_id].second, sums);
+    });
+
+    std::array<T, sums_count> result {};
+    for (unsigned int thread_id = 0; thread_id < pool.size (); thread_id++)
+      for (int i = 0; i < sums_count; i++)
+        result[i] += partial_sums[thread_id * sums_stride + i];
+
+    return result;
+  }
+
+  /// Run with sums_count known at runtime only, returned sums stay valid until the next call
+  template <typename action_type>
+  const T *run (unsigned int sums_count, const action_type &action)
+  {
+    const unsigned int stride = (sums_count + sums_stride - 1) / sums_stride * sums_stride;
+    if (dynamic_partial_sums.size () < pool.size () * stride)
+      dynamic_partial_sums.resize (pool.size () * stride);
+    if (dynamic_sums.size () < sums_count)
+      dynamic_sums.resize (sums_count);
+
+    pool.run ([&] (unsigned int thread_id, unsigned int) {
+      T *sums = dynamic_partial_sums.data () + thread_id * stride;
+      std::fill_n (sums, sums_count, T {});
+      action (ranges[thread_id].first, ranges[thread_id].second, sums);
+    });
+
+    std::fill_n (dynamic_sums.begin (), sums_count, T {});
+    for (unsigned int thread_id = 0; thread_id < pool.size (); thread_id++)
+      for (unsigned int i = 0; i < sums_count; i++)
+        dynamic_sums[i] += dynamic_partial_sums[thread_id * stride + i];
+
+    return dynamic_sums.data ();
+  }
+
+  thread_pool &get_pool () const { return pool; }
+  const std::vector<std::pair<C, C>> &get_ranges () const { return ranges; }
+
+private:
+  static constexpr unsigned int sums_stride = 64 / sizeof (T);
+
+  thread_pool &pool;
+  const std::vector<std::pair<C, C>> ranges;
+  std::vector<T> partial_sums;
+
+  std::vector<T> dynamic_partial_sums;
+  std::vector<T> dynamic_sums;
+};
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_ROW_RUNNER_H
@@ -0,0 +1,903 @@
+//
+// Created by egi on 10/18/26.
+//
+
+/**
+ * Compiled once per instruction set level with CPU_ISA_NAME set to the level
+ * and matching flags (see cpu/CMakeLists.txt). Everything except
+ * get_spmv_functions has internal linkage and no standard library templates
+ * are used: an inline function emitted with AVX-512 instructions here could
+ * otherwise be merged by linker into code that runs on older processors.
+ */
+
+#include "cpu_spmv_isa.h"
+
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#ifndef CPU_ISA_NAME
+#define CPU_ISA_NAME generic
+#endif
+
+#define CPU_ISA_CONCAT_IMPL(PREFIX, NAME) PREFIX##NAME
+#define CPU_ISA_CONCAT(PREFIX, NAME) CPU_ISA_CONCAT_IMPL (PREFIX, NAME)
+#define CPU_ISA_NAMESPACE CPU_ISA_CONCAT (cpu_isa_, CPU_ISA_NAME)
+
+namespace CPU_ISA_NAMESPACE
+{
+
+namespace
+{
+
+#if defined(__AVX512F__)
+constexpr int simd_bytes = 64;
+#elif defined(__AVX__)
+constexpr int simd_bytes = 32;
+#else
+constexpr int simd_bytes = 16;
+#endif
+
+template <typename data_type, typename index_type>
+void csr_spmv (
+  index_type first_row,
+  index_type last_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  for (index_type row = first_row; row < last_row; row++)
+    {
+      data_type dot = 0;
+      for (index_type element = row_ptr[row]; element < row_ptr[row + 1]; element++)
+        dot += data[element] * x[col_ids[element]];
+      y[row] = dot;
+    }
+}
+
+template <typename data_type, typename index_type, int bs>
+void bcsr_spmv_row_major_template (
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  for (index_type block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      data_type sums[bs] {};
+
+      for (index_type block = row_ptr[block_row]; block < row_ptr[block_row + 1]; block++)
+        {
+          const data_type *block_data = data + block * bs * bs;
+          const data_type *block_x = x + col_ids[block] * bs;
+
+          for (int r = 0; r < bs; r++)
+            for (int c = 0; c < bs; c++)
+              sums[r] += block_data[r * bs + c] * block_x[c];
+        }
+
+      for (int r = 0; r < bs; r++)
+        y[block_row * bs + r] = sums[r];
+    }
+}
+
+template <typename data_type, typename index_type>
+void bcsr_spmv_row_major_generic (
+  index_type bs,
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  for (index_type block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      data_type *block_y = y + block_row * bs;
+      for (index_type r = 0; r < bs; r++)
+        block_y[r] = 0;
+
+      for (index_type block = row_ptr[block_row]; block < row_ptr[block_row + 1]; block++)
+        {
+          const data_type *block_data = data + block * bs * bs;
+          const data_type *block_x = x + col_ids[block] * bs;
+
+          for (index_type r = 0; r < bs; r++)
+            {
+              data_type dot = 0;
+              for (index_type c = 0; c < bs; c++)
+                dot += block_data[r * bs + c] * block_x[c];
+              block_y[r] += dot;
+            }
+        }
+    }
+}
+
+template <typename data_type, typename index_type, int bs>
+data_type bcsr_spmv_row_major_dot_template (
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  data_type result = 0;
+
+  for (index_type block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      data_type sums[bs] {};
+
+      for (index_type block = row_ptr[block_row]; block < row_ptr[block_row + 1]; block++)
+        {
+          const data_type *block_data = data + block * bs * bs;
+          const data_type *block_x = x + col_ids[block] * bs;
+
+          for (int r = 0; r < bs; r++)
+            for (int c = 0; c < bs; c++)
+              sums[r] += block_data[r * bs + c] * block_x[c];
+        }
+
+      for (int r = 0; r < bs; r++)
+        {
+          y[block_row * bs + r] = sums[r];
+          result += x[block_row * bs + r] * sums[r];
+        }
+    }
+
+  return result;
+}
+
+template <typename data_type, typename index_type>
+data_type bcsr_spmv_row_major_dot_generic (
+  index_type bs,
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  bcsr_spmv_row_major_generic (bs, first_block_row, last_block_row, row_ptr, col_ids, data, x, y);
+
+  data_type result = 0;
+  for (index_type row = first_block_row * bs; row < last_block_row * bs; row++)
+    result += x[row] * y[row];
+
+  return result;
+}
+
+template <typename data_type, typename index_type, int bs>
+void bcsr_spmv_column_major_template (
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  for (index_type block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      data_type sums[bs] {};
+
+      for (index_type block = row_ptr[block_row]; block < row_ptr[block_row + 1]; block++)
+        {
+          const data_type *block_data = data + block * bs * bs;
+          const data_type *block_x = x + col_ids[block] * bs;
+
+          /// Each column is scaled by x value and added to the whole block row (axpy over contiguous data)
+          for (int c = 0; c < bs; c++)
+            for (int r = 0; r < bs; r++)
+              sums[r] += block_data[c * bs + r] * block_x[c];
+        }
+
+      for (int r = 0; r < bs; r++)
+        y[block_row * bs + r] = sums[r];
+    }
+}
+
+template <typename data_type, typename index_type>
+void bcsr_spmv_column_major_generic (
+  index_type bs,
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  for (index_type block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      data_type *block_y = y + block_row * bs;
+      for (index_type r = 0; r < bs; r++)
+        block_y[r] = 0;
+
+      for (index_type block = row_ptr[block_row]; block < row_ptr[block_row + 1]; block++)
+        {
+          const data_type *block_data = data + block * bs * bs;
+          const data_type *block_x = x + col_ids[block] * bs;
+
+          for (index_type c = 0; c < bs; c++)
+            for (index_type r = 0; r < bs; r++)
+              block_y[r] += block_data[c * bs + r] * block_x[c];
+        }
+    }
+}
+
+#if defined(__AVX512F__)
+
+/// Columns of up to 16 floats / 8 doubles are loaded at once, lanes past bs are masked out
+template <typename data_type> class simd_vector;
+
+template <>
+class simd_vector<float>
+{
+public:
+  using type = __m512;
+  static constexpr int lanes = 16;
+
+  static type zero () { return _mm512_setzero_ps (); }
+  static type broadcast (float value) { return _mm512_set1_ps (value); }
+  static type fmadd (type a, type b, type c) { return _mm512_fmadd_ps (a, b, c); }
+  static type load (const float *data, int count) { return _mm512_maskz_loadu_ps (mask (count), data); }
+  static void store (float *data, int count, type value) { _mm512_mask_storeu_ps (data, mask (count), value); }
+
+private:
+  static __mmask16 mask (int count) { return static_cast<__mmask16> ((1u << count) - 1); }
+};
+
+template <>
+class simd_vector<double>
+{
+public:
+  using type = __m512d;
+  static constexpr int lanes = 8;
+
+  static type zero () { return _mm512_setzero_pd (); }
+  static type broadcast (double value) { return _mm512_set1_pd (value); }
+  static type fmadd (type a, type b, type c) { return _mm512_fmadd_pd (a, b, c); }
+  static type load (const double *data, int count) { return _mm512_maskz_loadu_pd (mask (count), data); }
+  static void store (double *data, int count, type value) { _mm512_mask_storeu_pd (data, mask (count), value); }
+
+private:
+  static __mmask8 mask (int count) { return static_cast<__mmask8> ((1u << count) - 1); }
+};
+
+#define CPU_SPMV_MASKED_LOADS
+
+#elif defined(__AVX2__)
+
+template <typename data_type> class simd_vector;
+
+template <>
+class simd_vector<float>
+{
+public:
+  using type = __m256;
+  static constexpr int lanes = 8;
+
+  static type zero () { return _mm256_setzero_ps (); }
+  static type broadcast (float value) { return _mm256_set1_ps (value); }
+  static type fmadd (type a, type b, type c) { return _mm256_fmadd_ps (a, b, c); }
+  static type load (const float *data, int count) { return _mm256_maskload_ps (data, mask (count)); }
+  static void store (float *data, int count, type value) { _mm256_maskstore_ps (data, mask (count), value); }
+
+private:
+  static __m256i mask (int count) { return _mm256_cmpgt_epi32 (_mm256_set1_epi32 (count), _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7)); }
+};
+
+template <>
+class simd_vector<double>
+{
+public:
+  using type = __m256d;
+  static constexpr int lanes = 4;
+
+  static type zero () { return _mm256_setzero_pd (); }
+  static type broadcast (double value) { return _mm256_set1_pd (value); }
+  static type fmadd (type a, type b, type c) { return _mm256_fmadd_pd (a, b, c); }
+  static type load (const double *data, int count) { return _mm256_maskload_pd (data, mask (count)); }
+  static void store (double *data, int count, type value) { _mm256_maskstore_pd (data, mask (count), value); }
+
+private:
+  static __m256i mask (int count) { return _mm256_cmpgt_epi64 (_mm256_set1_epi64x (count), _mm256_setr_epi64x (0, 1, 2, 3)); }
+};
+
+#define CPU_SPMV_MASKED_LOADS
+
+#endif
+
+#ifdef CPU_SPMV_MASKED_LOADS
+
+/**
+ * Column major blocks without padding: each column is bs contiguous values, so
+ * it's read with masked loads that neither fault on nor use lanes past the
+ * block. Block row of y stays in registers.
+ */
+template <typename data_type, typename index_type, int bs>
+void bcsr_spmv_column_major_masked_template (
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  using vector = simd_vector<data_type>;
+  constexpr int lanes = vector::lanes;
+  constexpr int count = (bs + lanes - 1) / lanes;
+
+  for (index_type block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      typename vector::type sums[count];
+      for (int v = 0; v < count; v++)
+        sums[v] = vector::zero ();
+
+      for (index_type block = row_ptr[block_row]; block < row_ptr[block_row + 1]; block++)
+        {
+          const data_type *block_data = data + block * bs * bs;
+          const data_type *block_x = x + col_ids[block] * bs;
+
+          for (int c = 0; c < bs; c++)
+            {
+              const auto x_value = vector::broadcast (block_x[c]);
+
+              for (int v = 0; v < count; v++)
+                {
+                  constexpr int last_lanes = bs - (count - 1) * lanes;
+                  const int lanes_count = v == count - 1 ? last_lanes : lanes;
+                  sums[v] = vector::fmadd (vector::load (block_data + c * bs + v * lanes, lanes_count), x_value, sums[v]);
+                }
+            }
+        }
+
+      for (int v = 0; v < count; v++)
+        {
+          constexpr int last_lanes = bs - (count - 1) * lanes;
+          const int lanes_count = v == count - 1 ? last_lanes : lanes;
+          vector::store (y + block_row * bs + v * lanes, lanes_count, sums[v]);
+        }
+    }
+}
+
+#else
+
+/// No masked loads below AVX2, plain column major kernel is the best option
+template <typename data_type, typename index_type, int bs>
+void bcsr_spmv_column_major_masked_template (
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type *row_ptr,
+  const index_type *col_ids,
+  const data_type *data,
+  const data_type *x,
+  data_type *y)
+{
+  bcsr_spmv_column_major_template<data_type, index_type, bs> (first_block_row, last_block_row, row_ptr, col_ids, data, x, y);
+}
+
+#endif
+
+/**
+ * Column major blocks whose columns are padded with zeros to padded_bs
+ * values: every column is a whole number of SIMD vectors, so loops
+ * vectorize without remainder or masks at the cost of extra bytes.
+ */
+template <typename data_type, typename index_type, int bs>
+void bcsr_spmv_padded_template (
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  constexpr int padded_bs = get_padded_block_size (bs);
+
+  for (index_type block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      data_type sums[padded_bs] {};
+
+      for (index_type block = row_ptr[block_row]; block < row_ptr[block_row + 1]; block++)
+        {
+          const data_type *block_data = data + block * bs * padded_bs;
+          const data_type *block_x = x + col_ids[block] * bs;
+
+          for (int c = 0; c < bs; c++)
+            for (int r = 0; r < padded_bs; r++)
+              sums[r] += block_data[c * padded_bs + r] * block_x[c];
+        }
+
+      for (int r = 0; r < bs; r++)
+        y[block_row * bs + r] = sums[r];
+    }
+}
+
+template <typename data_type, typename index_type>
+void bcsr_spmv_padded_generic (
+  index_type bs,
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  const index_type padded_bs = get_padded_block_size (bs);
+
+  for (index_type block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      data_type *block_y = y + block_row * bs;
+      for (index_type r = 0; r < bs; r++)
+        block_y[r] = 0;
+
+      for (index_type block = row_ptr[block_row]; block < row_ptr[block_row + 1]; block++)
+        {
+          const data_type *block_data = data + block * bs * padded_bs;
+          const data_type *block_x = x + col_ids[block] * bs;
+
+          for (index_type c = 0; c < bs; c++)
+            for (index_type r = 0; r < bs; r++)
+              block_y[r] += block_data[c * padded_bs + r] * block_x[c];
+        }
+    }
+}
+
+/**
+ * Lanes are block rows of a slice: element (r, c) of the same block slot is
+ * contiguous for all rows, x values are gathered. Fills vector registers for
+ * block sizes much smaller than SIMD width.
+ */
+template <typename data_type, typename index_type, int bs, int width>
+void sliced_bcsr_spmv_template (
+  index_type n_rows,
+  index_type first_slice,
+  index_type last_slice,
+  const index_type * __restrict__ slice_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  for (index_type slice = first_slice; slice < last_slice; slice++)
+    {
+      data_type sums[bs][width] {};
+
+      for (index_type slot = slice_ptr[slice]; slot < slice_ptr[slice + 1]; slot += width)
+        {
+          const index_type *slot_columns = col_ids + slot;
+          const data_type *slot_data = data + slot * bs * bs;
+
+          /// Transpose x blocks of the slot into lanes, each block is a contiguous read
+          data_type x_values[bs][width];
+          for (int lane = 0; lane < width; lane++)
+            {
+              const data_type *block_x = x + slot_columns[lane] * bs;
+              for (int c = 0; c < bs; c++)
+                x_values[c][lane] = block_x[c];
+            }
+
+          for (int r = 0; r < bs; r++)
+            for (int c = 0; c < bs; c++)
+              for (int lane = 0; lane < width; lane++)
+                sums[r][lane] += slot_data[(r * bs + c) * width + lane] * x_values[c][lane];
+        }
+
+      const index_type first_row = slice * width;
+      const index_type rows_count = n_rows - first_row < width ? n_rows - first_row : width;
+
+      for (index_type lane = 0; lane < rows_count; lane++)
+        for (int r = 0; r < bs; r++)
+          y[(first_row + lane) * bs + r] = sums[r][lane];
+    }
+}
+
+template <typename data_type, typename index_type>
+void sliced_bcsr_spmv_generic (
+  index_type bs,
+  index_type width,
+  index_type n_rows,
+  index_type first_slice,
+  index_type last_slice,
+  const index_type * __restrict__ slice_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  for (index_type slice = first_slice; slice < last_slice; slice++)
+    {
+      const index_type first_row = slice * width;
+      const index_type rows_count = n_rows - first_row < width ? n_rows - first_row : width;
+
+      for (index_type lane = 0; lane < rows_count; lane++)
+        {
+          data_type *block_y = y + (first_row + lane) * bs;
+          for (index_type r = 0; r < bs; r++)
+            block_y[r] = 0;
+
+          for (index_type slot = slice_ptr[slice]; slot < slice_ptr[slice + 1]; slot += width)
+            {
+              const data_type *slot_data = data + slot * bs * bs;
+              const data_type *block_x = x + col_ids[slot + lane] * bs;
+
+              for (index_type r = 0; r < bs; r++)
+                for (index_type c = 0; c < bs; c++)
+                  block_y[r] += slot_data[(r * bs + c) * width + lane] * block_x[c];
+            }
+        }
+    }
+}
+
+template <typename data_type>
+constexpr int get_sliced_bcsr_width ()
+{
+  return simd_bytes / static_cast<int> (sizeof (data_type));
+}
+
+template <typename data_type, typename index_type>
+void sliced_bcsr_spmv (
+  index_type bs,
+  index_type width,
+  index_type n_rows,
+  index_type first,
+  index_type last,
+  const index_type *slice_ptr,
+  const index_type *col_ids,
+  const data_type *data,
+  const data_type *x,
+  data_type *y)
+{
+  constexpr int w = get_sliced_bcsr_width<data_type> ();
+
+  if (width != w)
+    {
+      sliced_bcsr_spmv_generic<data_type, index_type> (bs, width, n_rows, first, last, slice_ptr, col_ids, data, x, y);
+      return;
+    }
+
+  switch (bs)
+    {
+      case  1: sliced_bcsr_spmv_template<data_type, index_type, 1, w> (n_rows, first, last, slice_ptr, col_ids, data, x, y); break;
+      case  2: sliced_bcsr_spmv_template<data_type, index_type, 2, w> (n_rows, first, last, slice_ptr, col_ids, data, x, y); break;
+      case  3: sliced_bcsr_spmv_template<data_type, index_type, 3, w> (n_rows, first, last, slice_ptr, col_ids, data, x, y); break;
+      case  4: sliced_bcsr_spmv_template<data_type, index_type, 4, w> (n_rows, first, last, slice_ptr, col_ids, data, x, y); break;
+      default: sliced_bcsr_spmv_generic<data_type, index_type> (bs, width, n_rows, first, last, slice_ptr, col_ids, data, x, y); break;
+    }
+}
+
+template <typename data_type, typename index_type>
+void csr_spmv_multiple (
+  index_type first_row,
+  index_type last_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  unsigned int k,
+  unsigned int stride,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  for (index_type row = first_row; row < last_row; row++)
+    {
+      data_type *row_y = y + row * stride;
+      for (unsigned int j = 0; j < k; j++)
+        row_y[j] = 0;
+
+      for (index_type element = row_ptr[row]; element < row_ptr[row + 1]; element++)
+        {
+          const data_type value = data[element];
+          const data_type *row_x = x + col_ids[element] * stride;
+
+          for (unsigned int j = 0; j < k; j++)
+            row_y[j] += value * row_x[j];
+        }
+    }
+}
+
+/**
+ * Vectors are processed in groups of width: sums of a block row for a group
+ * stay in registers while blocks of the row are read, the last group may be
+ * narrower. Element (r, c) of a block is at r * row_step + c * column_step,
+ * fixed_bs = 0 for block size known at runtime only.
+ */
+template <typename data_type, typename index_type, int fixed_bs, bool column_major>
+void bcsr_spmv_multiple_template (
+  index_type bs_arg,
+  index_type first_block_row,
+  index_type last_block_row,
+  const index_type * __restrict__ row_ptr,
+  const index_type * __restrict__ col_ids,
+  const data_type * __restrict__ data,
+  unsigned int k,
+  unsigned int stride,
+  const data_type * __restrict__ x,
+  data_type * __restrict__ y)
+{
+  constexpr unsigned int width = 4;
+  constexpr int sums_bs = fixed_bs ? fixed_bs : 1;
+
+  const index_type bs = fixed_bs ? fixed_bs : bs_arg;
+  const index_type row_step = column_major ? 1 : bs;
+  const index_type column_step = column_major ? bs : 1;
+
+  for (index_type block_row = first_block_row; block_row < last_block_row; block_row++)
+    {
+      data_type *block_y = y + block_row * bs * stride;
+      unsigned int j = 0;
+
+      if (fixed_bs)
+        {
+          for (; j + width <= k; j += width)
+            {
+              data_type sums[sums_bs][width] {};
+
+              for (index_type block = row_ptr[block_row]; block < row_ptr[block_row + 1]; block++)
+                {
+                  const data_type *block_data = data + block * bs * bs;
+                  const data_type *block_x = x + col_ids[block] * bs * stride + j;
+
+                  for (int c = 0; c < sums_bs; c++)
+                    for (int r = 0; r < sums_bs; r++)
+                      {
+                        const data_type value = block_data[r * row_step + c * column_step];
+                        for (unsigned int l = 0; l < width; l++)
+                          sums[r][l] += value * block_x[c * stride + l];
+                      }
+                }
+
+              for (int r = 0; r < sums_bs; r++)
+                for (unsigned int l = 0; l < width; l++)
+                  block_y[r * stride + j + l] = sums[r][l];
+            }
+        }
+
+      if (j == k)
+        continue;
+
+      for (index_type r = 0; r < bs; r++)
+        for (unsigned int l = j; l < k; l++)
+          block_y[r * stride + l] = 0;
+
+      for (index_type block = row_ptr[block_row]; block < row_ptr[block_row + 1]; block++)
+        {
+          const data_type *block_data = data + block * bs * bs;
+          const data_type *block_x = x + col_ids[block] * bs * stride;
+
+          for (index_type c = 0; c < bs; c++)
+            for (index_type r = 0; r < bs; r++)
+              {
+                const data_type value = block_data[r * row_step + c * column_step];
+                for (unsigned int l = j; l < k; l++)
+                  block_y[r * stride + l] += value * block_x[c * stride + l];
+              }
+        }
+    }
+}
+
+template <typename data_type, typename index_type, bool column_major>
+void bcsr_spmv_multiple (
+  index_type bs,
+  index_type first,
+  index_type last,
+  const index_type *row_ptr,
+  const index_type *col_ids,
+  const data_type *data,
+  unsigned int k,
+  unsigned int stride,
+  const data_type *x,
+  data_type *y)
+{
+  switch (bs)
+    {
+      case  1: bcsr_spmv_multiple_template<data_type, index_type, 1, column_major> (bs, first, last, row_ptr, col_ids, data, k, stride, x, y); break;
+      case  2: bcsr_spmv_multiple_template<data_type, index_type, 2, column_major> (bs, first, last, row_ptr, col_ids, data, k, stride, x, y); break;
+      case  3: bcsr_spmv_multiple_template<data_type, index_type, 3, column_major> (bs, first, last, row_ptr, col_ids, data, k, stride, x, y); break;
+      case  4: bcsr_spmv_multiple_template<data_type, index_type, 4, column_major> (bs, first, last, row_ptr, col_ids, data, k, stride, x, y); break;
+      case  5: bcsr_spmv_multiple_template<data_type, index_type, 5, column_major> (bs, first, last, row_ptr, col_ids, data, k, stride, x, y); break;
+      case  6: bcsr_spmv_multiple_template<data_type, index_type, 6, column_major> (bs, first, last, row_ptr, col_ids, data, k, stride, x, y); break;
+      case  8: bcsr_spmv_multiple_template<data_type, index_type, 8, column_major> (bs, first, last, row_ptr, col_ids, data, k, stride, x, y); break;
+      default: bcsr_spmv_multiple_template<data_type, index_type, 0, column_major> (bs, first, last, row_ptr, col_ids, data, k, stride, x, y); break;
+    }
+}
+
+template <typename data_type, typename index_type>
+void bcsr_spmv_row_major (
+  index_type bs,
+  index_type first,
+  index_type last,
+  const index_type *row_ptr,
+  const index_type *col_ids,
+  const data_type *data,
+  const data_type *x,
+  data_type *y)
+{
+  switch (bs)
+    {
+      case  1: bcsr_spmv_row_major_template<data_type, index_type,  1> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  2: bcsr_spmv_row_major_template<data_type, index_type,  2> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  3: bcsr_spmv_row_major_template<data_type, index_type,  3> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  4: bcsr_spmv_row_major_template<data_type, index_type,  4> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  5: bcsr_spmv_row_major_template<data_type, index_type,  5> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  6: bcsr_spmv_row_major_template<data_type, index_type,  6> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  8: bcsr_spmv_row_major_template<data_type, index_type,  8> (first, last, row_ptr, col_ids, data, x, y); break;
+      case 16: bcsr_spmv_row_major_template<data_type, index_type, 16> (first, last, row_ptr, col_ids, data, x, y); break;
+      case 32: bcsr_spmv_row_major_template<data_type, index_type, 32> (first, last, row_ptr, col_ids, data, x, y); break;
+      default: bcsr_spmv_row_major_generic<data_type, index_type> (bs, first, last, row_ptr, col_ids, data, x, y); break;
+    }
+}
+
+template <typename data_type, typename index_type>
+data_type bcsr_spmv_row_major_dot (
+  index_type bs,
+  index_type first,
+  index_type last,
+  const index_type *row_ptr,
+  const index_type *col_ids,
+  const data_type *data,
+  const data_type *x,
+  data_type *y)
+{
+  switch (bs)
+    {
+      case  1: return bcsr_spmv_row_major_dot_template<data_type, index_type,  1> (first, last, row_ptr, col_ids, data, x, y);
+      case  2: return bcsr_spmv_row_major_dot_template<data_type, index_type,  2> (first, last, row_ptr, col_ids, data, x, y);
+      case  3: return bcsr_spmv_row_major_dot_template<data_type, index_type,  3> (first, last, row_ptr, col_ids, data, x, y);
+      case  4: return bcsr_spmv_row_major_dot_template<data_type, index_type,  4> (first, last, row_ptr, col_ids, data, x, y);
+      case  5: return bcsr_spmv_row_major_dot_template<data_type, index_type,  5> (first, last, row_ptr, col_ids, data, x, y);
+      case  6: return bcsr_spmv_row_major_dot_template<data_type, index_type,  6> (first, last, row_ptr, col_ids, data, x, y);
+      case  8: return bcsr_spmv_row_major_dot_template<data_type, index_type,  8> (first, last, row_ptr, col_ids, data, x, y);
+      case 16: return bcsr_spmv_row_major_dot_template<data_type, index_type, 16> (first, last, row_ptr, col_ids, data, x, y);
+      case 32: return bcsr_spmv_row_major_dot_template<data_type, index_type, 32> (first, last, row_ptr, col_ids, data, x, y);
+      default: return bcsr_spmv_row_major_dot_generic<data_type, index_type> (bs, first, last, row_ptr, col_ids, data, x, y);
+    }
+}
+
+template <typename data_type, typename index_type>
+void bcsr_spmv_column_major (
+  index_type bs,
+  index_type first,
+  index_type last,
+  const index_type *row_ptr,
+  const index_type *col_ids,
+  const data_type *data,
+  const data_type *x,
+  data_type *y)
+{
+  switch (bs)
+    {
+      case  1: bcsr_spmv_column_major_template<data_type, index_type,  1> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  2: bcsr_spmv_column_major_template<data_type, index_type,  2> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  3: bcsr_spmv_column_major_template<data_type, index_type,  3> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  4: bcsr_spmv_column_major_template<data_type, index_type,  4> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  5: bcsr_spmv_column_major_template<data_type, index_type,  5> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  6: bcsr_spmv_column_major_template<data_type, index_type,  6> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  8: bcsr_spmv_column_major_template<data_type, index_type,  8> (first, last, row_ptr, col_ids, data, x, y); break;
+      case 16: bcsr_spmv_column_major_template<data_type, index_type, 16> (first, last, row_ptr, col_ids, data, x, y); break;
+      case 32: bcsr_spmv_column_major_template<data_type, index_type, 32> (first, last, row_ptr, col_ids, data, x, y); break;
+      default: bcsr_spmv_column_major_generic<data_type, index_type> (bs, first, last, row_ptr, col_ids, data, x, y); break;
+    }
+}
+
+template <typename data_type, typename index_type>
+void bcsr_spmv_column_major_masked (
+  index_type bs,
+  index_type first,
+  index_type last,
+  const index_type *row_ptr,
+  const index_type *col_ids,
+  const data_type *data,
+  const data_type *x,
+  data_type *y)
+{
+  switch (bs)
+    {
+      case  3: bcsr_spmv_column_major_masked_template<data_type, index_type, 3> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  5: bcsr_spmv_column_major_masked_template<data_type, index_type, 5> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  6: bcsr_spmv_column_major_masked_template<data_type, index_type, 6> (first, last, row_ptr, col_ids, data, x, y); break;
+      default: bcsr_spmv_column_major<data_type, index_type> (bs, first, last, row_ptr, col_ids, data, x, y); break;
+    }
+}
+
+template <typename data_type, typename index_type>
+void bcsr_spmv_padded (
+  index_type bs,
+  index_type first,
+  index_type last,
+  const index_type *row_ptr,
+  const index_type *col_ids,
+  const data_type *data,
+  const data_type *x,
+  data_type *y)
+{
+  switch (bs)
+    {
+      case  3: bcsr_spmv_padded_template<data_type, index_type, 3> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  5: bcsr_spmv_padded_template<data_type, index_type, 5> (first, last, row_ptr, col_ids, data, x, y); break;
+      case  6: bcsr_spmv_padded_template<data_type, index_type, 6> (first, last, row_ptr, col_ids, data, x, y); break;
+      default: bcsr_spmv_padded_generic<data_type, index_type> (bs, first, last, row_ptr, col_ids, data, x, y); break;
+    }
+}
+
+#if defined(__FMA__)
+float multiply_add (float a, float b, float c) { return __builtin_fmaf (a, b, c); }
+double multiply_add (double a, double b, double c) { return __builtin_fma (a, b, c); }
+#else
+template <typename data_type>
+data_type multiply_add (data_type a, data_type b, data_type c) { return a * b + c; }
+#endif
+
+/// Eight registers of independent chains cover latency of two FMA ports
+template <typename data_type>
+double peak_flops (unsigned long long iterations, data_type *sink)
+{
+  constexpr int chains = 8 * simd_bytes / static_cast<int> (sizeof (data_type));
+  data_type acc[chains];
+
+  for (int j = 0; j < chains; j++)
+    acc[j] = static_cast<data_type> (j);
+
+  const data_type mul = static_cast<data_type> (0.999999);
+  const data_type add = static_cast<data_type> (1e-7);
+
+  for (unsigned long long i = 0; i < iterations; i++)
+    for (int j = 0; j < chains; j++)
+      acc[j] = multiply_add (acc[j], mul, add);
+
+  data_type sum {};
+  for (int j = 0; j < chains; j++)
+    sum += acc[j];
+  *sink = sum;
+
+  return 2.0 * chains * iterations;
+}
+
+}
+
+template <typename data_type, typename index_type>
+cpu_spmv_functions<data_type, index_type> get_spmv_functions ()
+{
+  cpu_spmv_functions<data_type, index_type> functions;
+
+  functions.csr = csr_spmv<data_type, index_type>;
+  functions.bcsr_row_major = bcsr_spmv_row_major<data_type, index_type>;
+  functions.bcsr_row_major_dot = bcsr_spmv_row_major_dot<data_type, index_type>;
+  functions.bcsr_column_major = bcsr_spmv_column_major<data_type, index_type>;
+  functions.bcsr_column_major_masked = bcsr_spmv_column_major_masked<data_type, index_type>;
+  functions.bcsr_padded = bcsr_spmv_padded<data_type, index_type>;
+  functions.sliced_bcsr = sliced_bcsr_spmv<data_type, index_type>;
+  functions.sliced_bcsr_width = get_sliced_bcsr_width<data_type> ();
+  functions.csr_multiple = csr_spmv_multiple<data_type, index_type>;
+  functions.bcsr_row_major_multiple = bcsr_spmv_multiple<data_type, index_type, false>;
+  functions.bcsr_column_major_multiple = bcsr_spmv_multiple<data_type, index_type, true>;
+  functions.peak = peak_flops<data_type>;
+
+  return functions;
+}
+
+#define INSTANTIATE(DTYPE,ITYPE) \
+  template cpu_spmv_functions<DTYPE, ITYPE> get_spmv_functions ();
+
+INSTANTIATE (float,int)
+INSTANTIATE (double,int)
+INSTANTIATE (float,std::int64_t)
+INSTANTIATE (double,std::int64_t)
+
+#undef INSTANTIATE
+
+}
@@ -0,0 +1,142 @@
+//
+// Created by egi on 10/18/26.
+//
+
+#ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_SPMV_ISA_H
+#define BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_SPMV_ISA_H
+
+#include "cpu_isa.h"
+
+/// Column length of padded blocks: next power of two, so that a column fills whole SIMD registers (3 -> 4, 5, 6 -> 8)
+constexpr int get_padded_block_size (int bs)
+{
+  int padded_bs = 1;
+  while (padded_bs < bs)
+    padded_bs *= 2;
+  return padded_bs;
+}
+
+/**
+ * @brief Row range kernels of one instruction set level
+ *
+ * cpu_spmv_isa.cpp is compiled once per level into its own namespace. Thread
+ * pool and matrix classes stay in cpu_matrix_multiplier.cpp. Callers look up
+ * the table of the active level (see get_cpu_isa) once in the calling thread
+ * and pass its function pointers to the workers of pool.run.
+ *
+ * Only kernels that read the matrix and the probe of peak FLOP rate are
+ * here. Vector loops of solvers (axpy, dot products fused with updates) are
+ * compiled at the base level: they are bound by memory bandwidth, which wider
+ * registers don't change.
+ */
+template <typename data_type, typename index_type>
+class cpu_spmv_functions
+{
+public:
+  /// Rows [first_row, last_row) of CSR matrix
+  using csr_type = void (*) (
+    index_type first_row,
+    index_type last_row,
+    const index_type *row_ptr,
+    const index_type *col_ids,
+    const data_type *data,
+    const data_type *x,
+    data_type *y);
+
+  /// Block rows [first_block_row, last_block_row) of BCSR matrix
+  using bcsr_type = void (*) (
+    index_type bs,
+    index_type first_block_row,
+    index_type last_block_row,
+    const index_type *row_ptr,
+    const index_type *col_ids,
+    const data_type *data,
+    const data_type *x,
+    data_type *y);
+
+  /// As bcsr_type, returns (x, y) over rows of the range
+  using bcsr_dot_type = data_type (*) (
+    index_type bs,
+    index_type first_block_row,
+    index_type last_block_row,
+    const index_type *row_ptr,
+    const index_type *col_ids,
+    const data_type *data,
+    const data_type *x,
+    data_type *y);
+
+  /// Slices [first_slice, last_slice) of sliced_bcsr_matrix_class
+  using sliced_bcsr_type = void (*) (
+    index_type bs,
+    index_type slice_width,
+    index_type n_rows,
+    index_type first_slice,
+    index_type last_slice,
+    const index_type *slice_ptr,
+    const index_type *col_ids,
+    const data_type *data,
+    const data_type *x,
+    data_type *y);
+
+  /// Rows [first_row, last_row) of CSR matrix times k vectors, element of vector j in row i is at i * stride + j
+  using csr_multiple_type = void (*) (
+    index_type first_row,
+    index_type last_row,
+    const index_type *row_ptr,
+    const index_type *col_ids,
+    const data_type *data,
+    unsigned int k,
+    unsigned int stride,
+    const data_type *x,
+    data_type *y);
+
+  /// Block rows [first_block_row, last_block_row) of BCSR matrix times k vectors, interleaved as in csr_multiple_type
+  using bcsr_multiple_type = void (*) (
+    index_type bs,
+    index_type first_block_row,
+    index_type last_block_row,
+    const index_type *row_ptr,
+    const index_type *col_ids,
+    const data_type *data,
+    unsigned int k,
+    unsigned int stride,
+    const data_type *x,
+    data_type *y);
+
+  /// Independent FMA chains in registers of the level for iterations, result goes to sink; returns operations count
+  using peak_type = double (*) (unsigned long long iterations, data_type *sink);
+
+  csr_type csr {};
+  bcsr_type bcsr_row_major {};
+  bcsr_dot_type bcsr_row_major_dot {};   ///< Row major storage, SpMV fused with dot product of CG
+  bcsr_type bcsr_column_major {};
+  bcsr_type bcsr_column_major_masked {}; ///< Column major storage, masked SIMD loads of columns (bs 3, 5, 6)
+  bcsr_type bcsr_padded {};              ///< Column major blocks with get_padded_block_size (bs) rows
+  sliced_bcsr_type sliced_bcsr {};
+  csr_multiple_type csr_multiple {};
+  bcsr_multiple_type bcsr_row_major_multiple {};
+  bcsr_multiple_type bcsr_column_major_multiple {};
+  peak_type peak {};                     ///< Peak FLOP rate probe of the level (see machine_limits)
+
+  index_type sliced_bcsr_width {};       ///< Slice width that fills SIMD registers of the level
+};
+
+#define DECLARE_CPU_ISA_FUNCTIONS(ISA) \
+  namespace cpu_isa_##ISA \
+  { \
+    template <typename data_type, typename index_type> \
+    cpu_spmv_functions<data_type, index_type> get_spmv_functions (); \
+  }
+
+DECLARE_CPU_ISA_FUNCTIONS (generic)
+DECLARE_CPU_ISA_FUNCTIONS (sse4)
+DECLARE_CPU_ISA_FUNCTIONS (avx2)
+DECLARE_CPU_ISA_FUNCTIONS (avx512)
+
+#undef DECLARE_CPU_ISA_FUNCTIONS
+
+/// Kernels built for isa (generic ones if the build has no dispatch)
+template <typename data_type, typename index_type>
+const cpu_spmv_functions<data_type, index_type> &get_cpu_spmv_functions (cpu_isa isa = get_cpu_isa ());
+
+#endif // BLOCK_MATRIX_FORMAT_PERFORMANCE_CPU_SPMV_ISA_H
@@ -172,16 +172,7 @@ public:
     calculate_local_stiffness_matrices ();
     assemble_matrix ();
 
-    const index_type bs = use_frames ? 3 : 2;
-
-    for (index_type segment_id = 0; segment_id < segments_count; segment_id++)
-      {
-        const index_type n_1 = segment_id * 4 + 0;
-        const index_type n_2 = segment_id * 4 + 1;
-
-        std::tie (forces_rhs[n_1 * bs + 0], forces_rhs[n_1 * bs + 1]) = load (nodes_xs[n_1]);
-        std::tie (forces_rhs[n_2 * bs + 0], forces_rhs[n_2 * bs + 1]) = load (nodes_xs[n_2]);
-      }
+    apply_load (load, forces_rhs.get ());
 
     // export nodes
     {
@@ -236,6 +227,22 @@ public:
     }
   }
 
+  /// Set forces of load (x -> (fx, fy)) at road nodes of rhs, other elements of rhs are left as they are
+  template <typename function_type>
+  void apply_load (const function_type &load, data_type *rhs) const
+  {
+    const index_type bs = use_frames ? 3 : 2;
+
+    for (index_type segment_id = 0; segment_id < segments_count; segment_id++)
+      {
+        const index_type n_1 = segment_id * 4 + 0;
+        const index_type n_2 = segment_id * 4 + 1;
+
+        std::tie (rhs[n_1 * bs + 0], rhs[n_1 * bs + 1]) = load (nodes_xs[n_1]);
+        std::tie (rhs[n_2 * bs + 0], rhs[n_2 * bs + 1]) = load (nodes_xs[n_2]);
+      }
+  }
+
   void write_vtk (const std::string &filename, const data_type *displacement = nullptr)
   {
     std::ofstream vtk (filename);
@@ -265,19 +265,24 @@ __global__ void bicgstab_init_kernel (
   T *s,
   T *t,
   T *rh,
+  const bool has_x0,
   const unsigned int n)
 {
   unsigned int row = threadIdx.x + blockIdx.x * blockDim.x;
   const unsigned int stride = blockDim.x * gridDim.x;
 
-  /// 0 - Clear arrays
+  /// 0 - Clear arrays, x0 is in h and A * x0 in t if it's given
   /// 1 - r0 = b - A * x0 (x0 = 0 => r0 = b)
   while (row < n)
     {
-      x[row] = r[row] = v[row] = p[row] = 0.0;
+      const T x0 = has_x0 ? h[row] : 0.0;
+      const T ax0 = has_x0 ? t[row] : 0.0;
+
+      x[row] = x0;
+      r[row] = v[row] = p[row] = 0.0;
       h[row] = s[row] = t[row] = 0.0;
 
-      rh[row] = r[row] = b[row];
+      rh[row] = r[row] = b[row] - ax0;
 
       row += stride;
     }
@@ -386,7 +391,7 @@ void dbg_print (const T *data, unsigned int n, const std::string &label)
 
 #define matrix_block_size 18
 template <class T, class C>
-T *gpu_bicgstab<T, C>::solve (const csr_matrix_class<T, C> &A_cpu, const T* b, T epsilon, unsigned int max_iterations)
+T *gpu_bicgstab<T, C>::solve (const csr_matrix_class<T, C> &A_cpu, const T* b, T epsilon, unsigned int max_iterations, const T *x0)
 {
   cudaEvent_t start, stop;
 
@@ -421,7 +426,19 @@ T *gpu_bicgstab<T, C>::solve (const csr_matrix_class<T, C> &A_cpu, const T* b, T
 
   if (P)
     calculate_jacobi_preconditioner<T,C> <<<blocks, threads>>> (A, offsets_to_rows_begin, column_indices, P, n_rows);
-  bicgstab_init_kernel<T> <<<blocks, threads>>> (rhs, x, r, v, p, h, s, t, rh, n_rows);
+  if (x0)
+    {
+      gpuCheck(cudaMemcpy (h, x0, n_rows * sizeof (T), cudaMemcpyDefault));
+      gpu_matrix_vector_multiplication<T, C, matrix_block_size> (A, h, t, offsets_to_rows_begin, column_indices, n_rows);
+    }
+  bicgstab_init_kernel<T> <<<blocks, threads>>> (rhs, x, r, v, p, h, s, t, rh, x0 != nullptr, n_rows);
+
+  /// Iteration i writes x into half i % 2
+  T *x_last = x;
+  iterations = 0;
+
+  if (monitor)
+    monitor->start ("gpu-bicgstab", { "rho", "beta", "alpha", "omega", "ts", "tt" }, max_iterations);
 
   for (unsigned int i = 0; i < max_iterations; )
     {
@@ -492,6 +509,8 @@ T *gpu_bicgstab<T, C>::solve (const csr_matrix_class<T, C> &A_cpu, const T* b, T
 
       /// 11 - xi = h + omegai * s
       bicgstab_1012_kernel<T> <<<blocks, threads>>> (h, z, xc, omegac, n_rows);
+      x_last = xc;
+      iterations = i;
 
       /// 12 Check norms
       dot_product_kernel<T, 32> <<<blocks, threads>>> (rc, rc, tmp + 4, n_rows);
@@ -500,19 +519,16 @@ T *gpu_bicgstab<T, C>::solve (const csr_matrix_class<T, C> &A_cpu, const T* b, T
       gpuCheck(cudaMemcpy (&norm_r, tmp + 4, sizeof (T), cudaMemcpyDefault));
       norm_r = std::sqrt (norm_r);
 
-      std::cout << "i: " << i
-                << "; rhs norm: " << norm_r / norm_b
-                << "; rho: " << rhoc
-                << "; beta: " << beta
-                << "; alpha: " << alpha
-                << "; omegac: " << omegac
-                << "; tc: " << ts_and_tt_prod[0]
-                << "; tt: " << ts_and_tt_prod[1] << "\n";
+      if (monitor)
+        monitor->record (norm_r / norm_b, { rhoc, beta, alpha, omegac, ts_and_tt_prod[0], ts_and_tt_prod[1] });
 
       if (norm_r / norm_b < epsilon) break;
     }
 
-  gpuCheck(cudaMemcpy (h_x, x, n_rows * sizeof (T), cudaMemcpyDefault));
+  if (monitor)
+    monitor->finish ();
+
+  gpuCheck(cudaMemcpy (h_x, x_last, n_rows * sizeof (T), cudaMemcpyDefault));
 
   cudaEventRecord (stop);
 
@@ -8,6 +8,7 @@
 #include <memory>
 
 #include "matrix_converters.h"
+#include "solver_monitor.h"
 
 template <class T, class C=std::size_t>
 class gpu_bicgstab
@@ -17,10 +18,19 @@ public:
   explicit gpu_bicgstab (const csr_matrix_class<T, C> &A_b, bool use_precond);
   ~gpu_bicgstab ();
 
-  T *solve (const csr_matrix_class<T, C> &A, const T* b, T epsilon, unsigned int max_iterations);
+  /// Starts from x0 (host memory), or from zero if it's null. Returned solution of the previous call may be passed as x0.
+  T *solve (const csr_matrix_class<T, C> &A, const T* b, T epsilon, unsigned int max_iterations, const T *x0 = nullptr);
+
+  /// Of the last solve
+  unsigned int get_iterations () const { return iterations; }
+
+  /// Monitor should outlive solver, null stops recording
+  void set_monitor (solver_monitor *monitor_arg) { monitor = monitor_arg; }
 
 private:
   unsigned int n_rows = 0;
+  unsigned int iterations = 0;
+  solver_monitor *monitor = nullptr;
   const C n_elements = 0;
 
   /// Host data
@@ -85,83 +85,6 @@ __global__ void csr_spmv_kernel (
     }
 }
 
-template <typename data_type, typename index_type>
-measurement_class gpu_csr_spmv (
-  const csr_matrix_class<data_type, index_type> &matrix,
-  const data_type *reference_y)
-{
-  const index_type matrix_size = matrix.nnz;
-  const index_type columns_size = matrix_size;
-  const index_type row_ptr_size = matrix.n_rows + 1;
-  const index_type x_size = matrix.n_cols;
-  const index_type y_size = matrix.n_rows;
-
-  data_type *d_values {};
-  data_type *d_y {};
-  data_type *d_x {};
-
-  index_type *d_row_ptr {};
-  index_type *d_columns {};
-
-  cudaMalloc (&d_values, matrix_size * sizeof (data_type));
-  cudaMalloc (&d_x, x_size * sizeof (data_type));
-  cudaMalloc (&d_y, y_size * sizeof (data_type));
-
-  cudaMalloc (&d_row_ptr, row_ptr_size * sizeof (index_type));
-  cudaMalloc (&d_columns, columns_size * sizeof (index_type));
-
-  cudaMemcpy (d_values, matrix.values.get (), matrix_size * sizeof (data_type), cudaMemcpyHostToDevice);
-  cudaMemcpy (d_columns, matrix.columns.get (), columns_size * sizeof (index_type), cudaMemcpyHostToDevice);
-  cudaMemcpy (d_row_ptr, matrix.row_ptr.get (), row_ptr_size * sizeof (index_type), cudaMemcpyHostToDevice);
-
-  {
-    dim3 block_size = dim3 (512);
-    dim3 grid_size {};
-
-    grid_size.x = (x_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (x_size, d_x, 1.0);
-  }
-
-  cudaEvent_t start, stop;
-  cudaEventCreate (&start);
-  cudaEventCreate (&stop);
-
-  cudaDeviceSynchronize ();
-  cudaEventRecord (start);
-
-  {
-    dim3 block_size = dim3 (512);
-    dim3 grid_size {};
-
-    grid_size.x = (matrix.n_rows + block_size.x - 1) / block_size.x;
-
-    csr_spmv_kernel<data_type, index_type> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y);
-  }
-
-  cudaEventRecord (stop);
-  cudaEventSynchronize (stop);
-
-  float milliseconds = 0;
-  cudaEventElapsedTime (&milliseconds, start, stop);
-  const double elapsed = milliseconds / 1000;
-
-  cudaEventDestroy (start);
-  cudaEventDestroy (stop);
-
-  std::unique_ptr<data_type[]> cpu_y (new data_type[y_size]);
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-
-  compare_results (y_size, reference_y, cpu_y.get ());
-
-  cudaFree (d_values);
-  cudaFree (d_x);
-  cudaFree (d_y);
-  cudaFree (d_row_ptr);
-  cudaFree (d_columns);
-
-  return measurement_class ("GPU CSR", elapsed, 0, 0);
-}
-
 template <typename data_type, typename index_type>
 __global__ void csr_spmv_vector_kernel (
   index_type n_rows,
@@ -195,83 +118,6 @@ __global__ void csr_spmv_vector_kernel (
     }
 }
 
-template <typename data_type, typename index_type>
-measurement_class gpu_csr_vector_spmv (
-  const csr_matrix_class<data_type, index_type> &matrix,
-  const data_type *reference_y)
-{
-  const index_type matrix_size = matrix.nnz;
-  const index_type columns_size = matrix_size;
-  const index_type row_ptr_size = matrix.n_rows + 1;
-  const index_type x_size = matrix.n_cols;
-  const index_type y_size = matrix.n_rows;
-
-  data_type *d_values {};
-  data_type *d_y {};
-  data_type *d_x {};
-
-  index_type *d_row_ptr {};
-  index_type *d_columns {};
-
-  cudaMalloc (&d_values, matrix_size * sizeof (data_type));
-  cudaMalloc (&d_x, x_size * sizeof (data_type));
-  cudaMalloc (&d_y, y_size * sizeof (data_type));
-
-  cudaMalloc (&d_row_ptr, row_ptr_size * sizeof (index_type));
-  cudaMalloc (&d_columns, columns_size * sizeof (index_type));
-
-  cudaMemcpy (d_values, matrix.values.get (), matrix_size * sizeof (data_type), cudaMemcpyHostToDevice);
-  cudaMemcpy (d_columns, matrix.columns.get (), columns_size * sizeof (index_type), cudaMemcpyHostToDevice);
-  cudaMemcpy (d_row_ptr, matrix.row_ptr.get (), row_ptr_size * sizeof (index_type), cudaMemcpyHostToDevice);
-
-  {
-    dim3 block_size = dim3 (512);
-    dim3 grid_size {};
-
-    grid_size.x = (x_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (x_size, d_x, 1.0);
-  }
-
-  cudaEvent_t start, stop;
-  cudaEventCreate (&start);
-  cudaEventCreate (&stop);
-
-  cudaDeviceSynchronize ();
-  cudaEventRecord (start);
-
-  {
-    dim3 block_size = dim3 (512);
-    dim3 grid_size {};
-
-    grid_size.x = (matrix.n_rows * 32 + block_size.x - 1) / block_size.x;
-
-    csr_spmv_vector_kernel<data_type, index_type> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y);
-  }
-
-  cudaEventRecord (stop);
-  cudaEventSynchronize (stop);
-
-  float milliseconds = 0;
-  cudaEventElapsedTime (&milliseconds, start, stop);
-  const double elapsed = milliseconds / 1000;
-
-  cudaEventDestroy (start);
-  cudaEventDestroy (stop);
-
-  std::unique_ptr<data_type[]> cpu_y (new data_type[y_size]);
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-
-  compare_results (y_size, reference_y, cpu_y.get ());
-
-  cudaFree (d_values);
-  cudaFree (d_x);
-  cudaFree (d_y);
-  cudaFree (d_row_ptr);
-  cudaFree (d_columns);
-
-  return measurement_class ("GPU CSR-Vector", elapsed, 0, 0);
-}
-
 template <typename data_type, typename index_type>
 __global__ void bcsr_spmv_kernel_block_per_block_row_thread_per_row_row_major_matrix (
   index_type n_block_rows,
@@ -733,607 +579,320 @@ void cusparse_bsrmv (
     x, &beta, y);
 }
 
-template <typename data_type, typename index_type>
-std::vector<measurement_class> gpu_bcsr_spmv (
-  bcsr_matrix_class<data_type, index_type> &matrix,
-  const data_type *column_major_matrix,
-  const data_type *reference_y)
-{
-  std::vector<measurement_class> results;
-
-  const index_type matrix_size = matrix.nnzb * matrix.bs * matrix.bs;
-  const index_type columns_size = matrix.nnzb;
-  const index_type row_ptr_size = matrix.n_rows + 1;
-  const index_type x_size = matrix.n_cols * matrix.bs;
-  const index_type y_size = matrix.n_rows * matrix.bs;
-
-  data_type *d_values {};
-  data_type *d_y {};
-  data_type *d_x {};
-
-  index_type *d_row_ptr {};
-  index_type *d_columns {};
-
-  cudaMalloc (&d_values, matrix_size * sizeof (data_type));
-  cudaMalloc (&d_x, x_size * sizeof (data_type));
-  cudaMalloc (&d_y, y_size * sizeof (data_type));
-
-  cudaMalloc (&d_row_ptr, row_ptr_size * sizeof (index_type));
-  cudaMalloc (&d_columns, columns_size * sizeof (index_type));
 
-  cudaMemcpy (d_values, matrix.values.get (), matrix_size * sizeof (data_type), cudaMemcpyHostToDevice);
-  cudaMemcpy (d_columns, matrix.columns.get (), columns_size * sizeof (index_type), cudaMemcpyHostToDevice);
-  cudaMemcpy (d_row_ptr, matrix.row_ptr.get (), row_ptr_size * sizeof (index_type), cudaMemcpyHostToDevice);
-
-  {
-    dim3 block_size = dim3 (512);
-    dim3 grid_size {};
-
-    grid_size.x = (x_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (x_size, d_x, 1.0);
-  }
-
-  {
-    cudaEvent_t start, stop;
-    cudaEventCreate (&start);
-    cudaEventCreate (&stop);
-
-    cudaDeviceSynchronize ();
-    cudaEventRecord (start);
-
-    {
-      dim3 block_size = 512;
-      dim3 grid_size {};
-
-      grid_size.x = (matrix.n_rows * matrix.bs + block_size.x - 1) / block_size.x;
-
-      bcsr_spmv_kernel_block_per_block_row_thread_per_row_row_major_matrix<data_type, index_type> <<<grid_size, block_size>>> (
-        matrix.n_rows, matrix.bs, d_columns, d_row_ptr, d_values, d_x, d_y);
+/// Template kernels are instantiated for these block sizes, BS is visible in call
+#define BS_SWITCH(bs, CALL) \
+  switch (bs) \
+    { \
+      case  1: { constexpr index_type BS =  1; CALL; break; } \
+      case  2: { constexpr index_type BS =  2; CALL; break; } \
+      case  3: { constexpr index_type BS =  3; CALL; break; } \
+      case  4: { constexpr index_type BS =  4; CALL; break; } \
+      case  8: { constexpr index_type BS =  8; CALL; break; } \
+      case 16: { constexpr index_type BS = 16; CALL; break; } \
+      case 32: { constexpr index_type BS = 32; CALL; break; } \
     }
 
-    cudaEventRecord (stop);
-    cudaEventSynchronize (stop);
-
-    float milliseconds = 0;
-    cudaEventElapsedTime (&milliseconds, start, stop);
-    const double elapsed = milliseconds / 1000;
-
-    cudaEventDestroy (start);
-    cudaEventDestroy (stop);
-
-    results.emplace_back ("GPU BCSR (row major, thread per row)", elapsed, 0, 0);
-  }
-
-  std::unique_ptr<data_type[]> cpu_y (new data_type[y_size]);
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-
-  compare_results (y_size, reference_y, cpu_y.get ());
-
-  {
-    dim3 block_size = dim3 (512);
-    dim3 grid_size {};
-
-    grid_size.x = (x_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (x_size, d_x, 1.0);
-  }
+#define TEMPLATE_BLOCK_SIZES { 1, 2, 3, 4, 8, 16, 32 }
 
+/**
+ * @brief Device copy of problem in one format, timed with cuda events
+ *
+ * For BCSR formats n_rows and nnz are block rows and blocks.
+ */
+template <typename data_type, typename index_type>
+class gpu_spmv_kernel : public spmv_kernel<data_type, index_type>
+{
+public:
+  using launcher_type = std::function<void (const gpu_spmv_kernel &)>;
+
+  gpu_spmv_kernel (
+    const spmv_problem<data_type, index_type> &problem,
+    matrix_format format,
+    launcher_type launcher_arg)
+    : launcher (std::move (launcher_arg))
   {
-    cudaEvent_t start, stop;
-    cudaEventCreate (&start);
-    cudaEventCreate (&stop);
-
-    cudaDeviceSynchronize ();
-    cudaEventRecord (start);
-
-    {
-      dim3 block_size = 32 * 4;
-      dim3 grid_size {};
-
-      grid_size.x = (matrix.n_rows * matrix.bs * 32 + block_size.x - 1) / block_size.x;
-
-      switch (matrix.bs)
-        {
-          case  1: bcsr_spmv_kernel_block_per_block_row_warp_per_row_row_major_matrix<data_type, index_type, 1> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case  2: bcsr_spmv_kernel_block_per_block_row_warp_per_row_row_major_matrix<data_type, index_type, 2> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case  3: bcsr_spmv_kernel_block_per_block_row_warp_per_row_row_major_matrix<data_type, index_type, 3> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case  4: bcsr_spmv_kernel_block_per_block_row_warp_per_row_row_major_matrix<data_type, index_type, 4> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case  8: bcsr_spmv_kernel_block_per_block_row_warp_per_row_row_major_matrix<data_type, index_type, 8> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case 16: bcsr_spmv_kernel_block_per_block_row_warp_per_row_row_major_matrix<data_type, index_type,16> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case 32: bcsr_spmv_kernel_block_per_block_row_warp_per_row_row_major_matrix<data_type, index_type,32> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        }
-    }
+    const bool is_csr = format == matrix_format::csr;
 
-    cudaEventRecord (stop);
-    cudaEventSynchronize (stop);
+    n_rows = is_csr ? problem.csr.n_rows : problem.bcsr.n_rows;
+    n_cols = is_csr ? problem.csr.n_cols : problem.bcsr.n_cols;
+    bs = is_csr ? 1 : problem.bcsr.bs;
+    nnz = is_csr ? problem.csr.nnz : problem.bcsr.nnzb;
 
-    float milliseconds = 0;
-    cudaEventElapsedTime (&milliseconds, start, stop);
-    const double elapsed = milliseconds / 1000;
+    const index_type matrix_size = is_csr ? problem.csr.nnz : problem.bcsr.size ();
+    const index_type x_size = problem.get_x_size ();
+    y_size = problem.get_y_size ();
 
-    cudaEventDestroy (start);
-    cudaEventDestroy (stop);
+    const data_type *values = is_csr ? problem.csr.values.get ()
+                            : format == matrix_format::bcsr_row_major ? problem.bcsr.values.get ()
+                            : problem.column_major_values;
+    const index_type *columns = is_csr ? problem.csr.columns.get () : problem.bcsr.columns.get ();
+    const index_type *row_ptr = is_csr ? problem.csr.row_ptr.get () : problem.bcsr.row_ptr.get ();
 
-    results.emplace_back ("GPU BCSR (row major, warp per row)", elapsed, 0, 0);
-  }
+    cudaMalloc (&d_values, matrix_size * sizeof (data_type));
+    cudaMalloc (&d_x, x_size * sizeof (data_type));
+    cudaMalloc (&d_y, y_size * sizeof (data_type));
 
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-  compare_results (y_size, reference_y, cpu_y.get ());
+    cudaMalloc (&d_row_ptr, (n_rows + 1) * sizeof (index_type));
+    cudaMalloc (&d_columns, nnz * sizeof (index_type));
 
-  /// cuSPARSE Row major
-  {
-    cusparseHandle_t handle;
-    cusparseCreate (&handle);
+    cudaMemcpy (d_values, values, matrix_size * sizeof (data_type), cudaMemcpyHostToDevice);
+    cudaMemcpy (d_columns, columns, nnz * sizeof (index_type), cudaMemcpyHostToDevice);
+    cudaMemcpy (d_row_ptr, row_ptr, (n_rows + 1) * sizeof (index_type), cudaMemcpyHostToDevice);
+    cudaMemcpy (d_x, problem.x, x_size * sizeof (data_type), cudaMemcpyHostToDevice);
 
-    cusparseMatDescr_t descr_A;
-    cusparseCreateMatDescr (&descr_A);
-    cusparseSetMatType (descr_A, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatIndexBase (descr_A, CUSPARSE_INDEX_BASE_ZERO);
-
-    cudaEvent_t start, stop;
     cudaEventCreate (&start);
     cudaEventCreate (&stop);
-
-    cudaDeviceSynchronize ();
-    cudaEventRecord (start);
-
-    cusparse_bsrmv (handle, descr_A, CUSPARSE_DIRECTION_ROW, matrix.n_rows, matrix.n_cols, matrix.nnzb, matrix.bs, d_values, d_row_ptr, d_columns, d_x, d_y);
-
-    cudaEventRecord (stop);
-    cudaEventSynchronize (stop);
-
-    float milliseconds = 0;
-    cudaEventElapsedTime (&milliseconds, start, stop);
-    const double elapsed = milliseconds / 1000;
-
-    cudaEventDestroy (start);
-    cudaEventDestroy (stop);
-
-    cusparseDestroyMatDescr (descr_A);
-    cusparseDestroy (handle);
-
-    results.emplace_back ("GPU BSR (cuSPARSE, row major)", elapsed, 0, 0);
-
-    cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-    compare_results (y_size, reference_y, cpu_y.get ());
   }
 
+  ~gpu_spmv_kernel () override
   {
-    dim3 block_size = dim3 (512);
-    dim3 grid_size {};
-
-    grid_size.x = (y_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (y_size, d_y, 1.0);
-  }
-
-  cudaMemcpy (d_values, column_major_matrix, matrix_size * sizeof (data_type), cudaMemcpyHostToDevice);
-
-  /// cuSPARSE Column major
-  {
-    cusparseHandle_t handle;
-    cusparseCreate (&handle);
-
-    cusparseMatDescr_t descr_A;
-    cusparseCreateMatDescr (&descr_A);
-    cusparseSetMatType (descr_A, CUSPARSE_MATRIX_TYPE_GENERAL);
-    cusparseSetMatIndexBase (descr_A, CUSPARSE_INDEX_BASE_ZERO);
-
-    cudaEvent_t start, stop;
-    cudaEventCreate (&start);
-    cudaEventCreate (&stop);
-
-    cudaDeviceSynchronize ();
-    cudaEventRecord (start);
-
-    cusparse_bsrmv (handle, descr_A, CUSPARSE_DIRECTION_COLUMN, matrix.n_rows, matrix.n_cols, matrix.nnzb, matrix.bs, d_values, d_row_ptr, d_columns, d_x, d_y);
-
-    cudaEventRecord (stop);
-    cudaEventSynchronize (stop);
-
-    float milliseconds = 0;
-    cudaEventElapsedTime (&milliseconds, start, stop);
-    const double elapsed = milliseconds / 1000;
-
     cudaEventDestroy (start);
     cudaEventDestroy (stop);
 
-    cusparseDestroyMatDescr (descr_A);
-    cusparseDestroy (handle);
-
-    results.emplace_back ("GPU BSR (cuSPARSE, column major)", elapsed, 0, 0);
-
-    cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-    compare_results (y_size, reference_y, cpu_y.get ());
-  }
-
-  {
-    dim3 block_size = dim3 (512);
-    dim3 grid_size {};
-
-    grid_size.x = (y_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (y_size, d_y, 1.0);
+    cudaFree (d_values);
+    cudaFree (d_x);
+    cudaFree (d_y);
+    cudaFree (d_row_ptr);
+    cudaFree (d_columns);
   }
 
+  double run () override
   {
-    cudaEvent_t start, stop;
-    cudaEventCreate (&start);
-    cudaEventCreate (&stop);
-
-    cudaDeviceSynchronize ();
-    cudaEventRecord (start);
-
     {
-      dim3 block_size = 512;
+      /// Rows that kernel doesn't write are detected by validation
+      dim3 block_size = dim3 (512);
       dim3 grid_size {};
 
-      grid_size.x = (matrix.n_rows * matrix.bs + block_size.x - 1) / block_size.x;
-
-      bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix<data_type, index_type> <<<grid_size, block_size>>> (
-        matrix.n_rows, matrix.bs, d_columns, d_row_ptr, d_values, d_x, d_y);
+      grid_size.x = (y_size + block_size.x - 1) / block_size.x;
+      fill_vector<data_type><<<grid_size, block_size>>> (y_size, d_y, 1.0);
     }
 
-    cudaEventRecord (stop);
-    cudaEventSynchronize (stop);
-
-    float milliseconds = 0;
-    cudaEventElapsedTime (&milliseconds, start, stop);
-    const double elapsed = milliseconds / 1000;
-
-    cudaEventDestroy (start);
-    cudaEventDestroy (stop);
-
-    results.emplace_back ("GPU BCSR (column major, thread per row)", elapsed, 0, 0);
-  }
-
-  std::fill_n (cpu_y.get (), y_size, 0.0);
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-  compare_results (y_size, reference_y, cpu_y.get ());
-
-  {
-    dim3 block_size = dim3 (512);
-    dim3 grid_size {};
-
-    grid_size.x = (y_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (y_size, d_y, 1.0);
-  }
-
-  {
-    cudaEvent_t start, stop;
-    cudaEventCreate (&start);
-    cudaEventCreate (&stop);
-
     cudaDeviceSynchronize ();
     cudaEventRecord (start);
 
-    {
-      dim3 block_size = 512;
-      dim3 grid_size {};
-
-      grid_size.x = (matrix.n_rows * matrix.bs + block_size.x - 1) / block_size.x;
-
-      switch (matrix.bs)
-      {
-        case  1: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_template<data_type, index_type, 1> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case  2: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_template<data_type, index_type, 2> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case  3: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_template<data_type, index_type, 3> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case  4: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_template<data_type, index_type, 4> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case  8: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_template<data_type, index_type, 8> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case 16: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_template<data_type, index_type,16> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case 32: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_template<data_type, index_type,32> <<<grid_size, block_size>>> (matrix.n_rows, d_columns, d_row_ptr, d_values, d_x, d_y); break;
-      }
-    }
+    launcher (*this);
 
     cudaEventRecord (stop);
     cudaEventSynchronize (stop);
 
     float milliseconds = 0;
     cudaEventElapsedTime (&milliseconds, start, stop);
-    const double elapsed = milliseconds / 1000;
-
-    cudaEventDestroy (start);
-    cudaEventDestroy (stop);
 
-    results.emplace_back ("GPU BCSR (column major, thread per row, template)", elapsed, 0, 0);
+    return milliseconds / 1000;
   }
 
-  std::fill_n (cpu_y.get (), y_size, 0.0);
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-  compare_results (y_size, reference_y, cpu_y.get ());
-
+  void copy_y (data_type *y) override
   {
-    dim3 block_size = dim3 (512);
-    dim3 grid_size {};
-
-    grid_size.x = (y_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (y_size, d_y, 1.0);
+    cudaMemcpy (y, d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
   }
 
-  {
-    cudaEvent_t start, stop;
-    cudaEventCreate (&start);
-    cudaEventCreate (&stop);
-
-    cudaDeviceSynchronize ();
-    cudaEventRecord (start);
-
-    {
-      dim3 block_size = dim3 (32);
-      dim3 grid_size {};
-
-      grid_size.x = (matrix.n_rows * matrix.bs  + block_size.x - 1) / block_size.x;
-
-      bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_coal_x<data_type, index_type> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (
-        matrix.bs, d_columns, d_row_ptr, d_values, d_x, d_y);
-    }
-
-    cudaEventRecord (stop);
-    cudaEventSynchronize (stop);
+public:
+  index_type n_rows {};
+  index_type n_cols {};
+  index_type bs {};
+  index_type nnz {};
+  index_type y_size {};
 
-    float milliseconds = 0;
-    cudaEventElapsedTime (&milliseconds, start, stop);
-    const double elapsed = milliseconds / 1000;
+  data_type *d_values {};
+  data_type *d_y {};
+  data_type *d_x {};
 
-    cudaEventDestroy (start);
-    cudaEventDestroy (stop);
+  index_type *d_row_ptr {};
+  index_type *d_columns {};
 
-    results.emplace_back ("GPU BCSR (column major, thread per row, coal x)", elapsed, 0, 0);
-  }
+private:
+  const launcher_type launcher;
 
-  std::fill_n (cpu_y.get (), y_size, 0.0);
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-  compare_results (y_size, reference_y, cpu_y.get ());
+  cudaEvent_t start {};
+  cudaEvent_t stop {};
+};
 
+/// cuSPARSE handle and descriptor are created outside of the timed region
+template <typename data_type, typename index_type>
+class gpu_cusparse_bsrmv_kernel : public gpu_spmv_kernel<data_type, index_type>
+{
+public:
+  gpu_cusparse_bsrmv_kernel (
+    const spmv_problem<data_type, index_type> &problem,
+    matrix_format format)
+    : gpu_spmv_kernel<data_type, index_type> (problem, format, [this, format] (const gpu_spmv_kernel<data_type, index_type> &k) {
+        cusparse_bsrmv (
+          handle, descr_A,
+          format == matrix_format::bcsr_row_major ? CUSPARSE_DIRECTION_ROW : CUSPARSE_DIRECTION_COLUMN,
+          k.n_rows, k.n_cols, k.nnz, k.bs,
+          k.d_values, k.d_row_ptr, k.d_columns, k.d_x, k.d_y);
+      })
   {
-    dim3 block_size = dim3 (512);
-    dim3 grid_size {};
-
-    grid_size.x = (y_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (y_size, d_y, 1.0);
+    cusparseCreate (&handle);
+    cusparseCreateMatDescr (&descr_A);
+    cusparseSetMatType (descr_A, CUSPARSE_MATRIX_TYPE_GENERAL);
+    cusparseSetMatIndexBase (descr_A, CUSPARSE_INDEX_BASE_ZERO);
   }
 
+  ~gpu_cusparse_bsrmv_kernel () override
   {
-    cudaEvent_t start, stop;
-    cudaEventCreate (&start);
-    cudaEventCreate (&stop);
-
-    cudaDeviceSynchronize ();
-    cudaEventRecord (start);
-
-    {
-      dim3 block_size = dim3 (32);
-      dim3 grid_size {};
-
-      grid_size.x = (matrix.n_rows * matrix.bs  + block_size.x - 1) / block_size.x;
-
-      switch (matrix.bs)
-      {
-        case  1: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_coal_x_template<data_type, index_type, 1> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case  2: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_coal_x_template<data_type, index_type, 2> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case  3: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_coal_x_template<data_type, index_type, 3> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case  4: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_coal_x_template<data_type, index_type, 4> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case  8: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_coal_x_template<data_type, index_type, 8> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case 16: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_coal_x_template<data_type, index_type,16> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        case 32: bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_coal_x_template<data_type, index_type,32> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-      }
-    }
-
-    cudaEventRecord (stop);
-    cudaEventSynchronize (stop);
-
-    float milliseconds = 0;
-    cudaEventElapsedTime (&milliseconds, start, stop);
-    const double elapsed = milliseconds / 1000;
-
-    cudaEventDestroy (start);
-    cudaEventDestroy (stop);
-
-    results.emplace_back ("GPU BCSR (column major, thread per row, coal x, template)", elapsed, 0, 0);
+    cusparseDestroyMatDescr (descr_A);
+    cusparseDestroy (handle);
   }
 
-  std::fill_n (cpu_y.get (), y_size, 0.0);
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-  compare_results (y_size, reference_y, cpu_y.get ());
+private:
+  cusparseHandle_t handle {};
+  cusparseMatDescr_t descr_A {};
+};
 
+template <typename data_type, typename index_type>
+void register_gpu_spmv_kernels (spmv_kernel_registry<data_type, index_type> &registry)
+{
+  using problem_type = spmv_problem<data_type, index_type>;
+  using kernel_type = gpu_spmv_kernel<data_type, index_type>;
+  using kernel_ptr = std::unique_ptr<spmv_kernel<data_type, index_type>>;
+
+  auto add = [&] (
+    const std::string &name,
+    matrix_format format,
+    std::vector<index_type> block_sizes,
+    typename kernel_type::launcher_type launcher)
   {
+    registry.add (name, "GPU", format, std::move (block_sizes), [format, launcher] (const problem_type &problem, thread_pool &) -> kernel_ptr {
+      return std::make_unique<kernel_type> (problem, format, launcher);
+    });
+  };
+
+  add ("GPU CSR", matrix_format::csr, {}, [] (const kernel_type &k) {
     dim3 block_size = dim3 (512);
     dim3 grid_size {};
 
-    grid_size.x = (y_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (y_size, d_y, 1.0);
-  }
-
-  {
-    cudaEvent_t start, stop;
-    cudaEventCreate (&start);
-    cudaEventCreate (&stop);
-
-    cudaDeviceSynchronize ();
-    cudaEventRecord (start);
-
-    {
-      dim3 block_size = 32;
-      dim3 grid_size {};
-
-      grid_size.x = (matrix.n_rows * 32 + block_size.x - 1) / block_size.x;
-
-      bcsr_spmv_kernel_column_by_column<data_type, index_type> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (
-        matrix.bs, d_columns, d_row_ptr, d_values, d_x, d_y);
-    }
-
-    cudaEventRecord (stop);
-    cudaEventSynchronize (stop);
-
-    float milliseconds = 0;
-    cudaEventElapsedTime (&milliseconds, start, stop);
-    const double elapsed = milliseconds / 1000;
-
-    cudaEventDestroy (start);
-    cudaEventDestroy (stop);
-
-    results.emplace_back ("GPU BCSR (column major, column-by-column)", elapsed, 0, 0);
-  }
+    grid_size.x = (k.n_rows + block_size.x - 1) / block_size.x;
 
-  std::fill_n (cpu_y.get (), y_size, 0.0);
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-  compare_results (y_size, reference_y, cpu_y.get ());
+    csr_spmv_kernel<data_type, index_type> <<<grid_size, block_size>>> (k.n_rows, k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y);
+  });
 
-  /// fastdiv
-  {
+  add ("GPU CSR-Vector", matrix_format::csr, {}, [] (const kernel_type &k) {
     dim3 block_size = dim3 (512);
     dim3 grid_size {};
 
-    grid_size.x = (y_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (y_size, d_y, 1.0);
-  }
+    grid_size.x = (k.n_rows * 32 + block_size.x - 1) / block_size.x;
 
-  {
-    cudaEvent_t start, stop;
-    cudaEventCreate (&start);
-    cudaEventCreate (&stop);
+    csr_spmv_vector_kernel<data_type, index_type> <<<grid_size, block_size>>> (k.n_rows, k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y);
+  });
 
-    cudaDeviceSynchronize ();
-    cudaEventRecord (start);
-
-    {
-      dim3 block_size = 32;
-      dim3 grid_size {};
-
-      grid_size.x = (matrix.n_rows * 32 + block_size.x - 1) / block_size.x;
+  add ("GPU BCSR (row major, thread per row)", matrix_format::bcsr_row_major, {}, [] (const kernel_type &k) {
+    dim3 block_size = 512;
+    dim3 grid_size {};
 
-      int_fastdiv bs (matrix.bs);
+    grid_size.x = (k.n_rows * k.bs + block_size.x - 1) / block_size.x;
 
-      bcsr_spmv_kernel_column_by_column_fastdiv<data_type, index_type> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (
-        bs, d_columns, d_row_ptr, d_values, d_x, d_y);
-    }
+    bcsr_spmv_kernel_block_per_block_row_thread_per_row_row_major_matrix<data_type, index_type> <<<grid_size, block_size>>> (
+      k.n_rows, k.bs, k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y);
+  });
 
-    cudaEventRecord (stop);
-    cudaEventSynchronize (stop);
+  add ("GPU BCSR (row major, warp per row)", matrix_format::bcsr_row_major, TEMPLATE_BLOCK_SIZES, [] (const kernel_type &k) {
+    dim3 block_size = 32 * 4;
+    dim3 grid_size {};
 
-    float milliseconds = 0;
-    cudaEventElapsedTime (&milliseconds, start, stop);
-    const double elapsed = milliseconds / 1000;
+    grid_size.x = (k.n_rows * k.bs * 32 + block_size.x - 1) / block_size.x;
 
-    cudaEventDestroy (start);
-    cudaEventDestroy (stop);
+    BS_SWITCH (k.bs, (bcsr_spmv_kernel_block_per_block_row_warp_per_row_row_major_matrix<data_type, index_type, BS> <<<grid_size, block_size>>> (
+      k.n_rows, k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y)));
+  });
 
-    results.emplace_back ("GPU BCSR (column major, column-by-column, int fastdiv)", elapsed, 0, 0);
-  }
+  registry.add ("GPU BSR (cuSPARSE, row major)", "GPU", matrix_format::bcsr_row_major, {}, [] (const problem_type &problem, thread_pool &) -> kernel_ptr {
+    return std::make_unique<gpu_cusparse_bsrmv_kernel<data_type, index_type>> (problem, matrix_format::bcsr_row_major);
+  });
 
-  std::fill_n (cpu_y.get (), y_size, 0.0);
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-  compare_results (y_size, reference_y, cpu_y.get ());
+  registry.add ("GPU BSR (cuSPARSE, column major)", "GPU", matrix_format::bcsr_column_major, {}, [] (const problem_type &problem, thread_pool &) -> kernel_ptr {
+    return std::make_unique<gpu_cusparse_bsrmv_kernel<data_type, index_type>> (problem, matrix_format::bcsr_column_major);
+  });
 
-  /// po2
-  if (matrix.bs != 3)
-    {
-      {
-        dim3 block_size = dim3 (512);
-        dim3 grid_size {};
+  add ("GPU BCSR (column major, thread per row)", matrix_format::bcsr_column_major, {}, [] (const kernel_type &k) {
+    dim3 block_size = 512;
+    dim3 grid_size {};
 
-        grid_size.x = (y_size + block_size.x - 1) / block_size.x;
-        fill_vector<data_type><<<grid_size, block_size>>> (y_size, d_y, 1.0);
-      }
+    grid_size.x = (k.n_rows * k.bs + block_size.x - 1) / block_size.x;
 
-      {
-        cudaEvent_t start, stop;
-        cudaEventCreate (&start);
-        cudaEventCreate (&stop);
+    bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix<data_type, index_type> <<<grid_size, block_size>>> (
+      k.n_rows, k.bs, k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y);
+  });
 
-        cudaDeviceSynchronize ();
-        cudaEventRecord (start);
+  add ("GPU BCSR (column major, thread per row, template)", matrix_format::bcsr_column_major, TEMPLATE_BLOCK_SIZES, [] (const kernel_type &k) {
+    dim3 block_size = 512;
+    dim3 grid_size {};
 
-        {
-          dim3 block_size = 32;
-          dim3 grid_size {};
+    grid_size.x = (k.n_rows * k.bs + block_size.x - 1) / block_size.x;
 
-          grid_size.x = (matrix.n_rows * 32 + block_size.x - 1) / block_size.x;
+    BS_SWITCH (k.bs, (bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_template<data_type, index_type, BS> <<<grid_size, block_size>>> (
+      k.n_rows, k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y)));
+  });
 
-          bcsr_spmv_kernel_column_by_column_po2<data_type, index_type> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (
-            matrix.bs, d_columns, d_row_ptr, d_values, d_x, d_y);
-        }
+  add ("GPU BCSR (column major, thread per row, coal x)", matrix_format::bcsr_column_major, {}, [] (const kernel_type &k) {
+    dim3 block_size = dim3 (32);
+    dim3 grid_size {};
 
-        cudaEventRecord (stop);
-        cudaEventSynchronize (stop);
+    grid_size.x = (k.n_rows * k.bs + block_size.x - 1) / block_size.x;
 
-        float milliseconds = 0;
-        cudaEventElapsedTime (&milliseconds, start, stop);
-        const double elapsed = milliseconds / 1000;
+    bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_coal_x<data_type, index_type> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (
+      k.bs, k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y);
+  });
 
-        cudaEventDestroy (start);
-        cudaEventDestroy (stop);
+  add ("GPU BCSR (column major, thread per row, coal x, template)", matrix_format::bcsr_column_major, TEMPLATE_BLOCK_SIZES, [] (const kernel_type &k) {
+    dim3 block_size = dim3 (32);
+    dim3 grid_size {};
 
-        results.emplace_back ("GPU BCSR (column major, column-by-column, int po2)", elapsed, 0, 0);
-      }
+    grid_size.x = (k.n_rows * k.bs + block_size.x - 1) / block_size.x;
 
-      std::fill_n (cpu_y.get (), y_size, 0.0);
-      cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-      compare_results (y_size, reference_y, cpu_y.get ());
-    }
+    BS_SWITCH (k.bs, (bcsr_spmv_kernel_block_per_block_row_thread_per_row_column_major_matrix_coal_x_template<data_type, index_type, BS> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (
+      k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y)));
+  });
 
-  /// template
-  {
-    dim3 block_size = dim3 (512);
+  add ("GPU BCSR (column major, column-by-column)", matrix_format::bcsr_column_major, {}, [] (const kernel_type &k) {
+    dim3 block_size = 32;
     dim3 grid_size {};
 
-    grid_size.x = (y_size + block_size.x - 1) / block_size.x;
-    fill_vector<data_type><<<grid_size, block_size>>> (y_size, d_y, 1.0);
-  }
+    grid_size.x = (k.n_rows * 32 + block_size.x - 1) / block_size.x;
 
-  {
-    cudaEvent_t start, stop;
-    cudaEventCreate (&start);
-    cudaEventCreate (&stop);
+    bcsr_spmv_kernel_column_by_column<data_type, index_type> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (
+      k.bs, k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y);
+  });
 
-    cudaDeviceSynchronize ();
-    cudaEventRecord (start);
+  add ("GPU BCSR (column major, column-by-column, int fastdiv)", matrix_format::bcsr_column_major, {}, [] (const kernel_type &k) {
+    dim3 block_size = 32;
+    dim3 grid_size {};
 
-    {
-      dim3 block_size = 32;
-      dim3 grid_size {};
+    grid_size.x = (k.n_rows * 32 + block_size.x - 1) / block_size.x;
 
-      grid_size.x = (matrix.n_rows * 32 + block_size.x - 1) / block_size.x;
+    int_fastdiv bs (k.bs);
 
-      switch (matrix.bs)
-        {
-          case  1: bcsr_spmv_kernel_column_by_column_template<data_type, index_type, 1> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case  2: bcsr_spmv_kernel_column_by_column_template<data_type, index_type, 2> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case  3: bcsr_spmv_kernel_column_by_column_template<data_type, index_type, 3> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case  4: bcsr_spmv_kernel_column_by_column_template<data_type, index_type, 4> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case  8: bcsr_spmv_kernel_column_by_column_template<data_type, index_type, 8> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case 16: bcsr_spmv_kernel_column_by_column_template<data_type, index_type,16> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-          case 32: bcsr_spmv_kernel_column_by_column_template<data_type, index_type,32> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (d_columns, d_row_ptr, d_values, d_x, d_y); break;
-        }
-    }
+    bcsr_spmv_kernel_column_by_column_fastdiv<data_type, index_type> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (
+      bs, k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y);
+  });
 
-    cudaEventRecord (stop);
-    cudaEventSynchronize (stop);
+  add ("GPU BCSR (column major, column-by-column, int po2)", matrix_format::bcsr_column_major, { 1, 2, 4, 8, 16, 32 }, [] (const kernel_type &k) {
+    dim3 block_size = 32;
+    dim3 grid_size {};
 
-    float milliseconds = 0;
-    cudaEventElapsedTime (&milliseconds, start, stop);
-    const double elapsed = milliseconds / 1000;
+    grid_size.x = (k.n_rows * 32 + block_size.x - 1) / block_size.x;
 
-    cudaEventDestroy (start);
-    cudaEventDestroy (stop);
-
-    results.emplace_back ("GPU BCSR (column major, column-by-column, template)", elapsed, 0, 0);
-  }
+    bcsr_spmv_kernel_column_by_column_po2<data_type, index_type> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (
+      k.bs, k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y);
+  });
 
-  std::fill_n (cpu_y.get (), y_size, 0.0);
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
-  compare_results (y_size, reference_y, cpu_y.get ());
+  add ("GPU BCSR (column major, column-by-column, template)", matrix_format::bcsr_column_major, TEMPLATE_BLOCK_SIZES, [] (const kernel_type &k) {
+    dim3 block_size = 32;
+    dim3 grid_size {};
 
-  cudaFree (d_values);
-  cudaFree (d_x);
-  cudaFree (d_y);
-  cudaFree (d_row_ptr);
-  cudaFree (d_columns);
+    grid_size.x = (k.n_rows * 32 + block_size.x - 1) / block_size.x;
 
-  return results;
+    BS_SWITCH (k.bs, (bcsr_spmv_kernel_column_by_column_template<data_type, index_type, BS> <<<grid_size, block_size, block_size.x * sizeof (data_type)>>> (
+      k.d_columns, k.d_row_ptr, k.d_values, k.d_x, k.d_y)));
+  });
 }
 
+#undef TEMPLATE_BLOCK_SIZES
+#undef BS_SWITCH
+
 #define INSTANTIATE(DTYPE,ITYPE) \
-  template measurement_class gpu_csr_spmv (const csr_matrix_class<DTYPE, ITYPE> &matrix, const DTYPE *reference_y); \
-  template measurement_class gpu_csr_vector_spmv (const csr_matrix_class<DTYPE, ITYPE> &matrix, const DTYPE *reference_y); \
-  template std::vector<measurement_class> gpu_bcsr_spmv (bcsr_matrix_class<DTYPE, ITYPE> &matrix, const DTYPE *, const DTYPE *reference_y);
+  template void register_gpu_spmv_kernels (spmv_kernel_registry<DTYPE, ITYPE> &registry);
 
 INSTANTIATE (float,int)
 INSTANTIATE (double,int)
@@ -5,25 +5,10 @@
 #ifndef BLOCK_MATRIX_FORMAT_PERFORMANCE_GPU_MATRIX_MULTIPLIER_H
 #define BLOCK_MATRIX_FORMAT_PERFORMANCE_GPU_MATRIX_MULTIPLIER_H
 
-#include <vector>
-
-#include "matrix_converters.h"
-#include "measurement_class.h"
-
-template <typename data_type, typename index_type>
-measurement_class gpu_csr_spmv (
-  const csr_matrix_class<data_type, index_type> &matrix,
-  const data_type *reference_y);
-
-template <typename data_type, typename index_type>
-measurement_class gpu_csr_vector_spmv (
-  const csr_matrix_class<data_type, index_type> &matrix,
-  const data_type *reference_y);
+#include "spmv_kernel_registry.h"
 
+/// Add every GPU SpMV kernel (own kernels and cuSPARSE) to registry
 template <typename data_type, typename index_type>
-std::vector<measurement_class> gpu_bcsr_spmv (
-  bcsr_matrix_class<data_type, index_type> &matrix,
-  const data_type *transpose_matrix_data,
-  const data_type *reference_y);
+void register_gpu_spmv_kernels (spmv_kernel_registry<data_type, index_type> &registry);
 
 #endif //BLOCK_MATRIX_FORMAT_PERFORMANCE_GPU_MATRIX_MULTIPLIER_H
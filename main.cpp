@@ -1,67 +1,49 @@
 #include "measurement_class.h"
 #include "matrix_converters.h"
-
+#include "perf_counters.h"
+#include "machine_limits.h"
+#include "regression_check.h"
+
+#include "cpu_matrix_multiplier.h"
+#include "cpu_isa.h"
+#include "cpu_spmv_isa.h"
+#include "cpu_bicgstab.h"
+#include "cpu_cg.h"
+#include "cpu_batched_cg.h"
+#include "cpu_recycling_cg.h"
+#include "cpu_mixed_precision.h"
+#include "cpu_linear_operator.h"
+#include "cpu_amg.h"
+#include "cpu_chebyshev.h"
+#include "autotuner.h"
 #include "gpu_matrix_multiplier.h"
 #include "bicgstab.h"
 
 #include "fem_2d/golden_gate_bridge.h"
+#include "benchmark_options.h"
 
 #include <cuda_runtime.h>
 
+#include <type_traits>
+#include <filesystem>
 #include <functional>
 #include <iostream>
 #include <optional>
+#include <fstream>
+#include <cstdint>
 #include <chrono>
 #include <memory>
+#include <thread>
+#include <regex>
+#include <map>
+#include <set>
+
+#include "json.hpp"
 
 #include "fmt/format.h"
 #include "fmt/color.h"
 #include "fmt/core.h"
 
-template<typename data_type, typename index_type>
-measurement_class cpu_csr_spmv_single_thread_naive (
-  const csr_matrix_class<data_type, index_type> &matrix,
-  data_type *x,
-  data_type *y)
-{
-  std::fill_n (x, matrix.n_cols, 1.0);
-  std::fill_n (y, matrix.n_rows, 0.0);
-
-  const auto row_ptr = matrix.row_ptr.get ();
-  const auto col_ids = matrix.columns.get ();
-  const auto data = matrix.values.get ();
-
-  auto begin = std::chrono::system_clock::now ();
-
-  for (index_type row = 0; row < matrix.n_rows; row++)
-    {
-      const auto row_start = row_ptr[row];
-      const auto row_end = row_ptr[row + 1];
-
-      data_type dot = 0;
-      for (auto element = row_start; element < row_end; element++)
-        dot += data[element] * x[col_ids[element]];
-      y[row] = dot;
-    }
-
-  auto end = std::chrono::system_clock::now ();
-  const double elapsed = std::chrono::duration<double> (end - begin).count ();
-
-  const size_t data_bytes = matrix.nnz * sizeof (data_type);
-  const size_t x_bytes = matrix.nnz * sizeof (data_type);
-  const size_t col_ids_bytes = matrix.nnz * sizeof (index_type);
-  const size_t row_ids_bytes = 2 * matrix.n_rows * sizeof (index_type);
-  const size_t y_bytes = matrix.n_rows * sizeof (data_type);
-
-  const size_t operations_count = matrix.nnz * 2;
-
-  return measurement_class (
-    "CPU CSR",
-    elapsed,
-    data_bytes + x_bytes + col_ids_bytes + row_ids_bytes + y_bytes,
-    operations_count);
-}
-
 double size_to_gb (size_t size)
 {
   return static_cast<double> (size) / 1024 / 1024 / 1024;
@@ -71,6 +53,7 @@ class time_printer
 {
   double reference {};
   std::optional<double> parallel_reference;
+  const machine_limits *limits {};
 
   /// Settings
   const unsigned int time_width = 20;
@@ -79,8 +62,9 @@ class time_printer
 public:
   explicit time_printer (
     double reference_time,
-    std::optional<double> parallel_ref = std::nullopt)
-    : reference (reference_time), parallel_reference (move (parallel_ref))
+    std::optional<double> parallel_ref = std::nullopt,
+    const machine_limits *limits_arg = nullptr)
+    : reference (reference_time), parallel_reference (move (parallel_ref)), limits (limits_arg)
   {
   }
 
@@ -89,7 +73,8 @@ public:
     fmt::print (fmt::fg (color), "{2:<{0}.{1}g}   ", time_width, time_precision, time);
   }
 
-  void print_time (const measurement_class &measurement) const
+  /// Limits are of the host, so bandwidth is compared with STREAM for CPU kernels only
+  void print_time (const measurement_class &measurement, bool on_host = true) const
   {
     const double time = measurement.get_elapsed ();
     fmt::print (fmt::fg (fmt::color::yellow), "\t{0:<80}", measurement.get_format ());
@@ -98,6 +83,10 @@ public:
     add_time (speedup (time), fmt::color::green);
     if (parallel_reference)
       add_time (parallel_speedup (time), fmt::color::green_yellow);
+    if (limits && on_host && measurement.get_load_store_bytes () > 0)
+      fmt::print (fmt::fg (fmt::color::light_blue), "AI: {:.3f} FLOP/B; BW: {:.1f}% of STREAM",
+                  measurement.get_arithmetic_intensity (),
+                  100.0 * measurement.get_effective_bandwidth () / limits->bandwidth);
     fmt::print ("\n");
   }
 
@@ -128,198 +117,329 @@ index_type round_up_to_power_of_two (index_type v)
   return v;
 }
 
-template<typename data_type, typename index_type>
-std::unordered_map<std::string, double> perform_measurements (
-  csr_matrix_class<data_type, index_type> &matrix,
-  bcsr_matrix_class<data_type, index_type> &block_matrix
-)
+/// Column-by-column kernel with block size baked in at runtime compilation (float only)
+class gpu_bcsr_jit_spmv_kernel : public spmv_kernel<float, int>
 {
-  std::unordered_map<std::string, double> results;
-  const unsigned int measurements_count = 10;
-  auto measure_multiple_times = [&] (const std::function<measurement_class (bool)> &action)
+public:
+  explicit gpu_bcsr_jit_spmv_kernel (const spmv_problem<float, int> &problem)
   {
-    measurement_class result;
-    for (unsigned int measurement_id = 0; measurement_id < measurements_count; measurement_id++)
-      result += action (measurement_id == 0);
-    result.finalize ();
+    const auto &block_matrix = problem.bcsr;
 
-    results[result.get_format ()] = result.get_elapsed ();
-
-    return result;
-  };
-
-  const index_type n_rows = block_matrix.n_rows;
-  const index_type bs = block_matrix.bs;
-  std::unique_ptr<data_type> reference_answer (new data_type[n_rows * bs]);
-  std::unique_ptr<data_type> x (new data_type[n_rows * bs]);
-  auto cpu_naive = measure_multiple_times ([&] (bool)
-                                           {
-                                             return cpu_csr_spmv_single_thread_naive (matrix, x.get (), reference_answer.get ());
-                                           });
-
-  time_printer single_core_timer (cpu_naive.get_elapsed ());
-  single_core_timer.print_time (cpu_naive);
+    jit(bcsr_jit,
+    {
+      const int bs = {{ bs }};
+
+      const int idx = blockIdx.x * blockDim.x + threadIdx.x;
+      const int lane = idx % 32;
+      const int block_row = idx / 32; ///< Warp per block row
+      const int first_block = row_ptr[block_row];
+      const int last_block = row_ptr[block_row + 1];
+
+      int col = first_block * bs + lane / bs;
+      int r = lane % bs;
+
+      __shared__ float partial_sums[{{ shared_size }}]; // = shared_memory<float> (); ///< Size is equal to blockDim.x * sizeof(float)
+
+      float local_out = 0.0;
+
+      for (; col < last_block * bs; col += 32 / bs)
+        {
+          const int block = col / bs;
+          const int c = col % bs;
+
+          const float value = data[block * bs * bs + c * bs + r];
+          const float x_value = x[col_ids[block] * bs + c];
+          local_out += x_value * value;
+        }
+
+      partial_sums[threadIdx.x] = local_out;
+
+      for (int stride = {{ stride_begin }} ; stride > 0; stride /= 2)
+        {
+          __syncthreads ();
+          if ((lane < stride * bs) && ((threadIdx.x + stride * bs) < 32))
+            {
+              partial_sums[threadIdx.x] += partial_sums[threadIdx.x + stride * bs];
+            }
+        }
+
+      if (lane < bs)
+        {
+          y[block_row * bs + lane] = partial_sums[threadIdx.x];
+        }
+    },
+      (const int *, col_ids),
+      (const int *, row_ptr),
+      (const float *, data),
+      (const float *, x),
+      (float*, y));
+
+    dim3 block_size = 32;
+    dim3 grid_size {};
+
+    grid_size.x = (block_matrix.n_rows * 32 + block_size.x - 1) / block_size.x;
+
+    nlohmann::json json;
+    json["bs"] = block_matrix.bs;
+    json["stride_begin"] = round_up_to_power_of_two ((32 / block_matrix.bs) / 2);
+    json["shared_size"] = block_size.x;
+    auto bcsr_kernel = std::make_shared<decltype (bcsr_jit.compile (json))> (bcsr_jit.compile (json));
+
+    const int matrix_size = block_matrix.size ();
+    const int columns_size = block_matrix.nnzb;
+    const int row_ptr_size = block_matrix.n_rows + 1;
+    const int x_size = problem.get_x_size ();
+    y_size = problem.get_y_size ();
+
+    cudaMalloc (&d_values, matrix_size * sizeof (float));
+    cudaMalloc (&d_x, x_size * sizeof (float));
+    cudaMalloc (&d_y, y_size * sizeof (float));
+
+    cudaMalloc (&d_row_ptr, row_ptr_size * sizeof (int));
+    cudaMalloc (&d_columns, columns_size * sizeof (int));
+
+    cudaMemcpy (d_values, problem.column_major_values, matrix_size * sizeof (float), cudaMemcpyHostToDevice);
+    cudaMemcpy (d_columns, block_matrix.columns.get (), columns_size * sizeof (int), cudaMemcpyHostToDevice);
+    cudaMemcpy (d_row_ptr, block_matrix.row_ptr.get (), row_ptr_size * sizeof (int), cudaMemcpyHostToDevice);
+    cudaMemcpy (d_x, problem.x, x_size * sizeof (float), cudaMemcpyHostToDevice);
+
+    launch = [this, bcsr_kernel, grid_size, block_size] () {
+      bcsr_kernel->launch (grid_size, block_size, d_columns, d_row_ptr, d_values, d_x, d_y);
+    };
+
+    cudaEventCreate (&start);
+    cudaEventCreate (&stop);
+  }
 
-  auto gpu_elapsed_csr = measure_multiple_times ([&] (bool) { return gpu_csr_spmv<data_type, index_type> (matrix, reference_answer.get ()); });
-  single_core_timer.print_time (gpu_elapsed_csr);
+  ~gpu_bcsr_jit_spmv_kernel () override
+  {
+    cudaEventDestroy (start);
+    cudaEventDestroy (stop);
+
+    cudaFree (d_values);
+    cudaFree (d_x);
+    cudaFree (d_y);
+    cudaFree (d_row_ptr);
+    cudaFree (d_columns);
+  }
 
-  auto gpu_elapsed_csr_vector = measure_multiple_times ([&] (bool) { return gpu_csr_vector_spmv<data_type, index_type> (matrix, reference_answer.get ()); });
-  single_core_timer.print_time (gpu_elapsed_csr_vector);
+  double run () override
+  {
+    cudaDeviceSynchronize ();
+    cudaEventRecord (start);
 
+    launch ();
 
-  std::unique_ptr<data_type[]> transposed_matrix_data (new data_type[block_matrix.size ()]);
-  block_matrix.transpose_blocks (transposed_matrix_data.get ());
+    cudaEventRecord (stop);
+    cudaEventSynchronize (stop);
 
-  dim3 block_size = 32;
-  dim3 grid_size {};
+    float milliseconds = 0;
+    cudaEventElapsedTime (&milliseconds, start, stop);
 
-  grid_size.x = (block_matrix.n_rows * 32 + block_size.x - 1) / block_size.x;
+    return milliseconds / 1000;
+  }
 
-  jit(bcsr_jit,
+  void copy_y (float *y) override
   {
-    const int bs = {{ bs }};
+    cudaMemcpy (y, d_y, y_size * sizeof (float), cudaMemcpyDeviceToHost);
+  }
 
-    const int idx = blockIdx.x * blockDim.x + threadIdx.x;
-    const int lane = idx % 32;
-    const int block_row = idx / 32; ///< Warp per block row
-    const int first_block = row_ptr[block_row];
-    const int last_block = row_ptr[block_row + 1];
+private:
+  std::function<void ()> launch;
 
-    int col = first_block * bs + lane / bs;
-    int r = lane % bs;
+  int y_size {};
 
-    __shared__ float partial_sums[{{ shared_size }}]; // = shared_memory<float> (); ///< Size is equal to blockDim.x * sizeof(float)
+  float *d_values {};
+  float *d_y {};
+  float *d_x {};
 
-    float local_out = 0.0;
+  int *d_row_ptr {};
+  int *d_columns {};
 
-    for (; col < last_block * bs; col += 32 / bs)
-      {
-        const int block = col / bs;
-        const int c = col % bs;
+  cudaEvent_t start {};
+  cudaEvent_t stop {};
+};
 
-        const float value = data[block * bs * bs + c * bs + r];
-        const float x_value = x[col_ids[block] * bs + c];
-        local_out += x_value * value;
-      }
+template <typename data_type, typename index_type>
+void register_jit_spmv_kernels (spmv_kernel_registry<data_type, index_type> &)
+{
+}
 
-    partial_sums[threadIdx.x] = local_out;
+void register_jit_spmv_kernels (spmv_kernel_registry<float, int> &registry)
+{
+  registry.add ("GPU BCSR (column major, column-by-column, jit)", "GPU", matrix_format::bcsr_column_major, { 1, 2, 4, 8, 16, 32 },
+                [] (const spmv_problem<float, int> &problem, thread_pool &) -> std::unique_ptr<spmv_kernel<float, int>> {
+    return std::make_unique<gpu_bcsr_jit_spmv_kernel> (problem);
+  });
+}
 
-    for (int stride = {{ stride_begin }} ; stride > 0; stride /= 2)
-      {
-        __syncthreads ();
-        if ((lane < stride * bs) && ((threadIdx.x + stride * bs) < 32))
-          {
-            partial_sums[threadIdx.x] += partial_sums[threadIdx.x + stride * bs];
-          }
-      }
+template <typename data_type, typename index_type>
+const spmv_kernel_registry<data_type, index_type> &get_spmv_kernels ()
+{
+  static const auto registry = [] {
+    spmv_kernel_registry<data_type, index_type> result;
+    register_cpu_spmv_kernels (result);
 
-    if (lane < bs)
+    /// cuSPARSE bsrmv and device kernels are built for 32 bit indices
+    if constexpr (std::is_same_v<index_type, int>)
       {
-        y[block_row * bs + lane] = partial_sums[threadIdx.x];
+        register_gpu_spmv_kernels (result);
+        register_jit_spmv_kernels (result);
       }
-  },
-    (const int *, col_ids),
-    (const int *, row_ptr),
-    (const float *, data),
-    (const float *, x),
-    (float*, y));
-  nlohmann::json json;
-  json["bs"] = bs;
-  json["stride_begin"] = round_up_to_power_of_two((32 / bs) / 2);
-  json["shared_size"] = block_size.x;
-  auto bcsr_kernel = bcsr_jit.compile (json);
-
-  const index_type matrix_size = block_matrix.nnzb * block_matrix.bs * block_matrix.bs;
-  const index_type columns_size = block_matrix.nnzb;
-  const index_type row_ptr_size = block_matrix.n_rows + 1;
-  const index_type x_size = block_matrix.n_cols * block_matrix.bs;
-  const index_type y_size = block_matrix.n_rows * block_matrix.bs;
-
-  data_type *d_values {};
-  data_type *d_y {};
-  data_type *d_x {};
-
-  index_type *d_row_ptr {};
-  index_type *d_columns {};
-
-  cudaMalloc (&d_values, matrix_size * sizeof (data_type));
-  cudaMalloc (&d_x, x_size * sizeof (data_type));
-  cudaMalloc (&d_y, y_size * sizeof (data_type));
-
-  cudaMalloc (&d_row_ptr, row_ptr_size * sizeof (index_type));
-  cudaMalloc (&d_columns, columns_size * sizeof (index_type));
-
-  cudaMemcpy (d_values, transposed_matrix_data.get (), matrix_size * sizeof (data_type), cudaMemcpyHostToDevice);
-  cudaMemcpy (d_columns, block_matrix.columns.get (), columns_size * sizeof (index_type), cudaMemcpyHostToDevice);
-  cudaMemcpy (d_row_ptr, block_matrix.row_ptr.get (), row_ptr_size * sizeof (index_type), cudaMemcpyHostToDevice);
-
-  std::unique_ptr<float[]> h_x (new float[x_size]);
-  std::fill_n (h_x.get (), x_size, 1.0);
-
-  cudaMemcpy (d_x, h_x.get (), x_size * sizeof (float), cudaMemcpyHostToDevice);
+    return result;
+  } ();
 
-  cudaEvent_t start, stop;
-  cudaEventCreate (&start);
-  cudaEventCreate (&stop);
+  return registry;
+}
 
-  cudaDeviceSynchronize ();
-  cudaEventRecord (start);
+/// Cpus ordered node by node, so that first threads of a pool share a NUMA node
+std::vector<int> get_compact_cpus ()
+{
+  std::vector<int> cpus;
+  for (auto &node: thread_pool::get_numa_nodes ())
+    cpus.insert (cpus.end (), node.begin (), node.end ());
+  return cpus;
+}
 
-  bcsr_kernel.launch (grid_size, block_size, d_columns, d_row_ptr, d_values, d_x, d_y);
+/// Pools are kept alive between measurements so that threads are created once per count
+thread_pool &get_thread_pool (unsigned int threads_count)
+{
+  static std::map<unsigned int, std::unique_ptr<thread_pool>> pools;
 
-  cudaEventRecord (stop);
-  cudaEventSynchronize (stop);
+  auto &pool = pools[threads_count];
+  if (!pool)
+    pool = std::make_unique<thread_pool> (threads_count, get_compact_cpus ());
 
-  std::unique_ptr<data_type[]> cpu_y (new data_type[y_size]);
-  cudaMemcpy (cpu_y.get (), d_y, y_size * sizeof (data_type), cudaMemcpyDeviceToHost);
+  return *pool;
+}
 
-  compare_results (y_size, reference_answer.get (), cpu_y.get ());
+std::vector<unsigned int> get_threads_counts (const benchmark_options &options)
+{
+  if (options.threads_counts.empty ())
+    return { std::max (std::thread::hardware_concurrency (), 1u) };
+  return options.threads_counts;
+}
 
-  cudaFree (d_values);
-  cudaFree (d_x);
-  cudaFree (d_y);
-  cudaFree (d_row_ptr);
-  cudaFree (d_columns);
+template<typename data_type, typename index_type>
+nlohmann::json perform_measurements (
+  csr_matrix_class<data_type, index_type> &matrix,
+  bcsr_matrix_class<data_type, index_type> &block_matrix,
+  const benchmark_options &options
+)
+{
+  const measurement_settings &settings = options.settings;
 
-  float milliseconds = 0;
-  cudaEventElapsedTime (&milliseconds, start, stop);
-  const double elapsed = milliseconds / 1000;
+  nlohmann::json results;
+  std::map<unsigned int, std::unique_ptr<perf_counters>> counters; ///< Per pool, events are opened by its workers
 
-  cudaEventDestroy (start);
-  cudaEventDestroy (stop);
+  const index_type n_rows = block_matrix.n_rows;
+  const index_type bs = block_matrix.bs;
+  const index_type y_size = n_rows * bs;
 
-  results["jit"] = elapsed;
+  std::unique_ptr<data_type[]> reference_answer (new data_type[y_size]);
+  std::unique_ptr<data_type[]> y (new data_type[y_size]);
+  std::unique_ptr<data_type[]> x (new data_type[block_matrix.n_cols * bs]);
+  std::fill_n (x.get (), block_matrix.n_cols * bs, 1.0);
 
-  measurement_class jit_measure ("jit", elapsed, 0.0, 0.0);
-  single_core_timer.print_time (jit_measure);
+  cpu_csr_spmv_single_thread_naive (matrix, x.get (), reference_answer.get ());
 
-  std::vector<measurement_class> multiple_measurements = gpu_bcsr_spmv<data_type, index_type> (block_matrix, transposed_matrix_data.get (), reference_answer.get ());
+  std::unique_ptr<data_type[]> transposed_matrix_data (new data_type[block_matrix.size ()]);
+  block_matrix.transpose_blocks (transposed_matrix_data.get ());
 
-  for (unsigned int measurement_i = 0; measurement_i < measurements_count; measurement_i++)
-    {
-      auto new_result = gpu_bcsr_spmv<data_type, index_type> (block_matrix, transposed_matrix_data.get (), reference_answer.get ());
+  const spmv_problem<data_type, index_type> problem { matrix, block_matrix, transposed_matrix_data.get (), x.get () };
 
-      for (unsigned int i = 0; i < multiple_measurements.size(); i++)
-        multiple_measurements[i] += new_result[i];
-    }
+  std::optional<std::regex> filter;
+  if (options.kernel_filter)
+    filter.emplace (*options.kernel_filter);
 
-  for (auto &measure: multiple_measurements)
-    measure.finalize ();
+  const auto threads_counts = get_threads_counts (options);
+  std::optional<time_printer> single_core_timer;
 
-  for (auto &elapsed: multiple_measurements)
+  for (auto &entry: get_spmv_kernels<data_type, index_type> ().get_kernels ())
     {
-      results[elapsed.get_format ()] = elapsed.get_elapsed ();
-      single_core_timer.print_time (elapsed);
+      if (!entry.supports (bs))
+        continue;
+
+      if (filter && !std::regex_search (entry.name, *filter))
+        continue;
+
+      if (options.scaling != scaling_mode::none && !entry.threaded)
+        continue;
+
+      for (auto threads_count: entry.threaded ? threads_counts : std::vector<unsigned int> { 1 })
+        {
+          const std::string name = entry.threaded && threads_counts.size () > 1
+                                 ? fmt::format ("{} ({} threads)", entry.name, threads_count)
+                                 : entry.name;
+
+          std::unique_ptr<spmv_kernel<data_type, index_type>> kernel;
+
+          try
+            {
+              kernel = entry.create (problem, get_thread_pool (threads_count));
+            }
+          catch (const std::runtime_error &error)
+            {
+              /// E.g. runtime compiler isn't available, other kernels are still measured
+              std::cerr << entry.name << ": " << error.what () << std::endl;
+              continue;
+            }
+          perf_counters *kernel_counters = nullptr;
+          if (settings.collect_counters && entry.device == "CPU")
+            {
+              auto &pool_counters = counters[threads_count];
+              if (!pool_counters)
+                pool_counters = std::make_unique<perf_counters> (&get_thread_pool (threads_count));
+              kernel_counters = pool_counters.get ();
+            }
+
+          auto result = measure_multiple_times ([&] (bool) {
+            if (kernel_counters)
+              kernel_counters->start ();
+
+            measurement_class measurement (name, kernel->run (), entry.bytes_model (problem), entry.operations_model (problem));
+
+            if (kernel_counters)
+              {
+                kernel_counters->stop ();
+                measurement.set_counters (kernel_counters->get_values ());
+              }
+
+            return measurement;
+          }, settings);
+
+          std::fill_n (y.get (), y_size, 0.0);
+          kernel->copy_y (y.get ());
+          compare_results (y_size, reference_answer.get (), y.get ());
+
+          results[name] = result.to_json ();
+
+          if (entry.threaded)
+            results[name]["threads"] = threads_count;
+
+          if (settings.limits && entry.device == "CPU")
+            {
+              auto roofline = settings.limits->get_roofline (result, std::is_same_v<data_type, double>);
+              if (!roofline.empty ())
+                results[name]["roofline"] = roofline;
+            }
+
+          /// First measured kernel (single threaded CPU CSR unless filtered out) is the reference for speedup
+          if (!single_core_timer)
+            single_core_timer.emplace (result.get_elapsed (), std::nullopt, settings.limits);
+          single_core_timer->print_time (result, entry.device == "CPU");
+        }
     }
 
   return results;
 }
 
 template<typename data_type, typename index_type>
-auto measure_diag_matrices (
+nlohmann::json measure_diag_matrices (
   index_type bs,
   index_type n_rows,
   index_type blocks_per_row,
+  const benchmark_options &options,
   bool debug_info = false
 )
 {
@@ -343,12 +463,15 @@ auto measure_diag_matrices (
   auto block_matrix = gen_n_diag_bcsr<data_type, index_type> (n_rows, blocks_per_row, bs);
   auto matrix = std::make_unique<csr_matrix_class<data_type, index_type>> (*block_matrix);
 
-  return perform_measurements (*matrix, *block_matrix);
+  if (!options.save_binary.empty ())
+    matrix->write_binary (fmt::format ("{}.bs{}", options.save_binary, bs));
+
+  return perform_measurements (*matrix, *block_matrix, options);
 }
 
 template<typename data_type, typename index_type>
-void measure_golden_bridge (
-  bool solve = false
+nlohmann::json measure_golden_bridge (
+  const benchmark_options &options
 )
 {
   const data_type side_length = 345.0; ///< Size from bridge tower to bank in meters
@@ -366,40 +489,760 @@ void measure_golden_bridge (
   golden_gate_bridge_2d<data_type, index_type, false> bridge_2d (load, main_part_length, side_length, 260, 7.62);
   auto matrix = std::make_unique<csr_matrix_class<data_type, index_type>> (*bridge_2d.matrix);
 
-  if (solve)
+  if (options.solve)
     {
       matrix->write_mm ("matrix.mtx");
       bridge_2d.write_vtk ("output_1.vtk");
-      gpu_bicgstab<data_type, index_type> solver (*matrix, true);
-      auto solution = solver.solve (*matrix, bridge_2d.forces_rhs.get (), 0.8, 1000);
-      bridge_2d.write_vtk ("output_2.vtk", solution);
+
+      /// The same load window as load, moved to position; rhs should be zeroed
+      auto apply_load_at = [&] (data_type position, data_type *rhs) {
+        bridge_2d.apply_load ([=] (data_type x) -> std::pair<data_type, data_type> {
+          if (x > position - 450 && x < position + 450)
+            return {0, -2000000.0};
+          return {0, 0};
+        }, rhs);
+      };
+
+      /// Position of step out of steps_count along the main part
+      auto step_position = [&] (unsigned int step, unsigned int steps_count) {
+        return side_length + main_part_length * (step + data_type (0.5)) / steps_count;
+      };
+
+      /// Solvers only store history in iterations, lines are printed every monitor_stride of them
+      solver_monitor monitor ([] (const solver_monitor &monitor, unsigned int iteration) {
+        fmt::print ("{}\n", monitor.format (iteration));
+      }, options.monitor_stride);
+
+      if (options.solver != "gpu-bicgstab")
+        {
+          const auto variant = options.solver == "pbicgstab" ? bicgstab_variant::pipelined : bicgstab_variant::classic;
+          auto &pool = get_thread_pool (get_threads_counts (options).front ());
+
+          /// Solvers run the kernel of the chosen format on the stiffness matrix itself
+          std::unique_ptr<cpu_linear_operator<data_type, index_type>> A;
+          if (options.solver_format == "auto")
+            {
+              auto tuned = autotune_operator (*bridge_2d.matrix, pool);
+              fmt::print ("Autotuned solver format: {}\n", tuned->get_description ());
+              A = std::move (tuned);
+            }
+          else if (options.solver_format == "csr")
+            A = std::make_unique<cpu_csr_operator<data_type, index_type>> (*matrix);
+          else if (options.solver_format == "bcsr-column-major")
+            A = std::make_unique<cpu_bcsr_operator<data_type, index_type>> (*bridge_2d.matrix, matrix_format::bcsr_column_major);
+          else
+            A = std::make_unique<cpu_bcsr_operator<data_type, index_type>> (*bridge_2d.matrix);
+
+          nlohmann::json json;
+
+          /// Window of the same load at load_cases positions along the main part, all systems are solved in one batch
+          if (options.load_cases > 1)
+            {
+              const unsigned int k = options.load_cases;
+              const index_type n = A->size ();
+              std::unique_ptr<data_type[]> rhs (new data_type[n * k]);
+              std::fill_n (rhs.get (), n * k, data_type {});
+
+              for (unsigned int load_case = 0; load_case < k; load_case++)
+                apply_load_at (step_position (load_case, k), rhs.get () + load_case * n);
+
+              cpu_batched_cg<data_type, index_type> solver (*A, options.preconditioners.front () == "jacobi", pool, k);
+              solver.set_monitor (&monitor);
+
+              const auto solve_begin = std::chrono::steady_clock::now ();
+              auto solutions = solver.solve (*A, rhs.get (), k, 0.8, 1000);
+              const auto solve_end = std::chrono::steady_clock::now ();
+
+              bridge_2d.write_vtk ("output_2.vtk", solutions);
+
+              const auto &iterations = solver.get_iterations ();
+              const double solve_time = std::chrono::duration<double> (solve_end - solve_begin).count ();
+
+              fmt::print ("\nLoad cases: {}, solve: {:.4f} s, iterations: {} - {}\n",
+                          k, solve_time,
+                          *std::min_element (iterations.begin (), iterations.end ()),
+                          *std::max_element (iterations.begin (), iterations.end ()));
+
+              json["batch"]["load_cases"] = k;
+              json["batch"]["solve_time"] = solve_time;
+              json["batch"]["iterations"] = iterations;
+              json["batch"]["relative_residuals"] = solver.get_relative_residuals ();
+              json["batch"]["history"] = monitor.to_json<nlohmann::json> ();
+              json["solver"] = options.solver;
+              json["format"] = to_string (A->get_format ());
+              return json;
+            }
+
+          /// Moving load: every solve starts from the previous solution and keeps a deflation subspace of the previous ones
+          if (options.load_steps > 1)
+            {
+              const unsigned int steps_count = options.load_steps;
+              const index_type n = A->size ();
+              std::unique_ptr<data_type[]> rhs (new data_type[n]);
+
+              cpu_recycling_cg<data_type, index_type> solver (*A, options.preconditioners.front () == "jacobi", pool, options.recycled);
+              solver.set_monitor (&monitor);
+              data_type *solution = nullptr;
+
+              for (unsigned int step = 0; step < steps_count; step++)
+                {
+                  std::fill_n (rhs.get (), n, data_type {});
+                  apply_load_at (step_position (step, steps_count), rhs.get ());
+
+                  const auto solve_begin = std::chrono::steady_clock::now ();
+                  solution = solver.solve (*A, rhs.get (), 0.8, 1000);
+                  const auto solve_end = std::chrono::steady_clock::now ();
+
+                  nlohmann::json step_json;
+                  step_json["position"] = step_position (step, steps_count);
+                  step_json["solve_time"] = std::chrono::duration<double> (solve_end - solve_begin).count ();
+                  step_json["iterations"] = solver.get_iterations ();
+                  step_json["relative_residual"] = solver.get_relative_residual ();
+                  step_json["recycled"] = solver.get_recycled_count ();
+                  step_json["history"] = monitor.to_json<nlohmann::json> ();
+                  json["steps"].push_back (step_json);
+                }
+
+              bridge_2d.write_vtk ("output_2.vtk", solution);
+
+              fmt::print ("\n{:<6} {:>12} {:>10} {:>10} {:>10}\n", "Step", "Position, m", "Solve, s", "Iterations", "Residual");
+              for (unsigned int step = 0; step < steps_count; step++)
+                fmt::print ("{:<6} {:>12.1f} {:>10.4f} {:>10} {:>10.3e}\n",
+                            step,
+                            json["steps"][step]["position"].get<double> (),
+                            json["steps"][step]["solve_time"].get<double> (),
+                            json["steps"][step]["iterations"].get<unsigned int> (),
+                            json["steps"][step]["relative_residual"].get<double> ());
+
+              json["recycled"] = options.recycled;
+              json["solver"] = options.solver;
+              json["format"] = to_string (A->get_format ());
+              return json;
+            }
+
+          /// Inner iterations in float on float copy of the matrix, residual and solution in double
+          if constexpr (std::is_same_v<data_type, double>)
+            {
+              if (options.mixed_precision)
+                {
+                  std::unique_ptr<csr_matrix_class<float, index_type>> matrix_low;
+                  std::unique_ptr<bcsr_matrix_class<float, index_type>> block_matrix_low;
+                  std::unique_ptr<cpu_linear_operator<float, index_type>> A_low;
+
+                  if (options.solver_format == "auto")
+                    {
+                      /// The same format and block size as the double operator
+                      matrix_low = convert_values<float> (*matrix);
+                      A_low = std::make_unique<cpu_autotuned_operator<float, index_type>> (*matrix_low, A->get_format (), A->unit_rows ());
+                    }
+                  else if (options.solver_format == "csr")
+                    {
+                      matrix_low = convert_values<float> (*matrix);
+                      A_low = std::make_unique<cpu_csr_operator<float, index_type>> (*matrix_low);
+                    }
+                  else
+                    {
+                      block_matrix_low = convert_values<float> (*bridge_2d.matrix);
+                      A_low = std::make_unique<cpu_bcsr_operator<float, index_type>> (
+                        *block_matrix_low,
+                        options.solver_format == "bcsr-column-major" ? matrix_format::bcsr_column_major : matrix_format::bcsr_row_major);
+                    }
+
+                  const auto inner = options.solver == "cg" ? refinement_inner_solver::cg
+                                   : options.solver == "pbicgstab" ? refinement_inner_solver::pipelined_bicgstab
+                                                                   : refinement_inner_solver::bicgstab;
+                  cpu_mixed_precision_solver<index_type> solver (*A, *A_low, options.preconditioners.front () == "jacobi", pool, inner);
+                  solver.set_monitor (&monitor);
+
+                  const auto solve_begin = std::chrono::steady_clock::now ();
+                  auto solution = solver.solve (*A, *A_low, bridge_2d.forces_rhs.get (), 0.8, 1000);
+                  const auto solve_end = std::chrono::steady_clock::now ();
+
+                  bridge_2d.write_vtk ("output_2.vtk", solution);
+
+                  json["solve_time"] = std::chrono::duration<double> (solve_end - solve_begin).count ();
+                  json["iterations"] = solver.get_iterations ();
+                  json["outer_iterations"] = solver.get_outer_iterations ();
+                  json["relative_residual"] = solver.get_relative_residual ();
+                  json["history"] = monitor.to_json<nlohmann::json> ();
+
+                  fmt::print ("\nMixed precision: {} float iterations in {} refinement steps, {:.4f}s, relative residual {:.3e}\n",
+                              solver.get_iterations (),
+                              solver.get_outer_iterations (),
+                              json["solve_time"].get<double> (),
+                              solver.get_relative_residual ());
+
+                  if (solver.is_stagnated ())
+                    fmt::print ("Refinement stagnated at outer iteration {}\n", solver.get_outer_iterations ());
+
+                  json["stagnated"] = solver.is_stagnated ();
+                  json["mixed_precision"] = true;
+                  json["solver"] = options.solver;
+                  json["format"] = to_string (A->get_format ());
+                  return json;
+                }
+            }
+
+          /// Setup cost of stronger preconditioners pays off only if it's smaller than time of saved iterations
+          for (auto &name: options.preconditioners)
+            {
+              fmt::print (fmt::fg (fmt::color::tomato), "\nSolver: {}, preconditioner: {}\n", options.solver, name);
+
+              const auto setup_begin = std::chrono::steady_clock::now ();
+
+              std::unique_ptr<cpu_preconditioner<data_type, index_type>> precond;
+              if (name == "block-jacobi")
+                precond = std::make_unique<cpu_block_jacobi<data_type, index_type>> (*bridge_2d.matrix, pool);
+              else if (name == "bilu0")
+                precond = std::make_unique<cpu_block_ilu0<data_type, index_type>> (*bridge_2d.matrix, pool);
+              else if (name == "amg" || name == "amg-chebyshev")
+                {
+                  amg_settings settings;
+                  if (name == "amg-chebyshev")
+                    {
+                      settings.smoother = amg_smoother::chebyshev;
+                      settings.sweeps = 2;
+                    }
+
+                  auto amg = std::make_unique<cpu_amg<data_type, index_type>> (*bridge_2d.matrix, pool, settings);
+                  for (unsigned int level_id = 0; level_id < amg->levels_count (); level_id++)
+                    fmt::print ("AMG level {}: {} block rows\n", level_id, amg->level_rows (level_id));
+                  fmt::print ("AMG operator complexity: {:.2f}\n", amg->operator_complexity ());
+                  precond = std::move (amg);
+                }
+              else if (name == "chebyshev")
+                {
+                  chebyshev_settings settings;
+                  settings.degree = options.chebyshev_degree;
+
+                  auto chebyshev = std::make_unique<cpu_chebyshev<data_type, index_type>> (*bridge_2d.matrix, pool, settings);
+                  fmt::print ("Chebyshev degree {} on [{:.3e}, {:.3e}]\n", settings.degree, chebyshev->get_lower (), chebyshev->get_upper ());
+                  precond = std::move (chebyshev);
+                }
+
+              const auto setup_end = std::chrono::steady_clock::now ();
+
+              nlohmann::json &solve_json = json["solves"][name];
+              solve_json["setup_time"] = std::chrono::duration<double> (setup_end - setup_begin).count ();
+
+              auto solve = [&] (auto &solver, const auto &A) {
+                solver->set_monitor (&monitor);
+
+                const auto solve_begin = std::chrono::steady_clock::now ();
+                auto solution = solver->solve (A, bridge_2d.forces_rhs.get (), 0.8, 1000);
+                const auto solve_end = std::chrono::steady_clock::now ();
+
+                bridge_2d.write_vtk ("output_2.vtk", solution);
+
+                solve_json["solve_time"] = std::chrono::duration<double> (solve_end - solve_begin).count ();
+                solve_json["iterations"] = solver->get_iterations ();
+                solve_json["relative_residual"] = solver->get_relative_residual ();
+                solve_json["time_per_iteration"] = solve_json["solve_time"].get<double> () / std::max (solver->get_iterations (), 1u);
+                solve_json["history"] = monitor.to_json<nlohmann::json> ();
+              };
+
+              if (options.solver == "cg")
+                {
+                  auto solver = precond
+                              ? std::make_unique<cpu_cg<data_type, index_type>> (*A, *precond, pool)
+                              : std::make_unique<cpu_cg<data_type, index_type>> (*A, name == "jacobi", pool);
+                  solve (solver, *A);
+                }
+              else
+                {
+                  auto solver = precond
+                              ? std::make_unique<cpu_bicgstab<data_type, index_type>> (*A, *precond, pool, variant)
+                              : std::make_unique<cpu_bicgstab<data_type, index_type>> (*A, name == "jacobi", pool, variant);
+                  solve (solver, *A);
+                }
+            }
+
+          fmt::print ("\n{:<14} {:>10} {:>10} {:>10} {:>12} {:>10}\n", "Precond", "Setup, s", "Solve, s", "Iterations", "Per iter, s", "Residual");
+          for (auto &item: json["solves"].items ())
+            fmt::print ("{:<14} {:>10.4f} {:>10.4f} {:>10} {:>12.2e} {:>10.3e}\n",
+                        item.key (),
+                        item.value ()["setup_time"].get<double> (),
+                        item.value ()["solve_time"].get<double> (),
+                        item.value ()["iterations"].get<unsigned int> (),
+                        item.value ()["time_per_iteration"].get<double> (),
+                        item.value ()["relative_residual"].get<double> ());
+
+          json["solver"] = options.solver;
+          json["format"] = to_string (A->get_format ());
+          return json;
+        }
+      else
+        {
+          nlohmann::json json;
+
+          gpu_bicgstab<data_type, index_type> solver (*matrix, true);
+          solver.set_monitor (&monitor);
+
+          auto solution = solver.solve (*matrix, bridge_2d.forces_rhs.get (), 0.8, 1000);
+          json["iterations"] = solver.get_iterations ();
+          json["history"] = monitor.to_json<nlohmann::json> ();
+
+          /// Moving load, each step starts from the previous solution
+          if (options.load_steps > 1)
+            {
+              const unsigned int steps_count = options.load_steps;
+              std::unique_ptr<data_type[]> rhs (new data_type[matrix->n_rows]);
+
+              for (unsigned int step = 0; step < steps_count; step++)
+                {
+                  std::fill_n (rhs.get (), matrix->n_rows, data_type {});
+                  apply_load_at (step_position (step, steps_count), rhs.get ());
+
+                  solution = solver.solve (*matrix, rhs.get (), 0.8, 1000, solution);
+                  fmt::print ("Step {}: {} iterations\n", step, solver.get_iterations ());
+
+                  nlohmann::json step_json;
+                  step_json["position"] = step_position (step, steps_count);
+                  step_json["iterations"] = solver.get_iterations ();
+                  step_json["history"] = monitor.to_json<nlohmann::json> ();
+                  json["steps"].push_back (step_json);
+                }
+            }
+
+          bridge_2d.write_vtk ("output_2.vtk", solution);
+
+          json["solver"] = options.solver;
+          return json;
+        }
+
+      return {};
+    }
+
+  return perform_measurements (*matrix, *bridge_2d.matrix, options);
+}
+
+/**
+ * @brief Collect matrix market files from path
+ *
+ * Path might be a single .mtx file, a directory (searched recursively, as
+ * SuiteSparse archives are unpacked into per-matrix directories) or a manifest
+ * file with one path per line. Relative paths in manifest are resolved from its directory.
+ */
+std::vector<std::filesystem::path> collect_mtx_files (const std::filesystem::path &path)
+{
+  namespace fs = std::filesystem;
+  std::vector<fs::path> files;
+
+  if (fs::is_directory (path))
+    {
+      for (auto &entry: fs::recursive_directory_iterator (path))
+        if (entry.is_regular_file () && entry.path ().extension () == ".mtx")
+          files.push_back (entry.path ());
+      std::sort (files.begin (), files.end ());
+    }
+  else if (path.extension () == ".mtx")
+    {
+      files.push_back (path);
     }
   else
     {
-      perform_measurements (*matrix, *bridge_2d.matrix);
+      std::ifstream manifest (path);
+      if (!manifest)
+        throw std::runtime_error ("Error! Can't open manifest " + path.string ());
+
+      std::string line;
+
+      while (std::getline (manifest, line))
+        {
+          if (line.empty () || line[0] == '#')
+            continue;
+
+          fs::path file (line);
+          if (file.is_relative ())
+            file = path.parent_path () / file;
+
+          if (!fs::exists (file))
+            {
+              std::cerr << "Warning! " << file.string () << " listed in " << path.string () << " doesn't exist" << std::endl;
+              continue;
+            }
+
+          files.push_back (file);
+        }
     }
+
+  return files;
 }
 
-#include "json.hpp"
-#include <fstream>
+/// Measure all kernels on source_matrix split into blocks of each requested size
+template<typename data_type, typename index_type>
+nlohmann::json measure_csr_matrix (
+  const csr_matrix_class<data_type, index_type> &source_matrix,
+  const benchmark_options &options)
+{
+  nlohmann::json matrix_json;
+  matrix_json["n_rows"] = source_matrix.n_rows;
+  matrix_json["n_cols"] = source_matrix.n_cols;
+  matrix_json["nnz"] = source_matrix.nnz;
 
-int main ()
+  for (auto bs: options.block_sizes)
+    {
+      fmt::print (fmt::fg (fmt::color::tomato), "\nBS: {}\n", bs);
+
+      auto block_matrix = csr_to_bcsr<data_type, index_type> (source_matrix, bs);
+      auto matrix = std::make_unique<csr_matrix_class<data_type, index_type>> (*block_matrix);
+
+      nlohmann::json bs_json;
+      bs_json["nnzb"] = block_matrix->nnzb;
+      bs_json["fill_ratio"] = static_cast<double> (block_matrix->size ()) / source_matrix.nnz;
+      bs_json["results"] = perform_measurements (*matrix, *block_matrix, options);
+
+      matrix_json["block_sizes"][std::to_string (bs)] = bs_json;
+    }
+
+  return matrix_json;
+}
+
+template<typename data_type, typename index_type>
+nlohmann::json measure_mtx_matrices (
+  const std::filesystem::path &path,
+  const benchmark_options &options)
 {
-  cudaSetDevice (1);
+  namespace fs = std::filesystem;
+  nlohmann::json json;
+
+  /// Files of different directories might share names, so they are keyed by path from input root
+  const fs::path root = fs::is_directory (path) ? path : path.parent_path ();
+
+  for (auto &file: collect_mtx_files (path))
+    {
+      fs::path name = file.lexically_relative (root).replace_extension ();
+      if (name.empty () || *name.begin () == "..")
+        name = file.stem ();
+
+      fmt::print (fmt::fg (fmt::color::tomato), "\nMatrix: {}\n", file.string ());
+
+      std::unique_ptr<csr_matrix_class<data_type, index_type>> source_matrix;
+
+      try
+        {
+          source_matrix = read_csr_mm<data_type, index_type> (file.string ());
+        }
+      catch (const std::runtime_error &error)
+        {
+          std::cerr << error.what () << std::endl;
+          continue;
+        }
+
+      if (!options.save_binary.empty ())
+        {
+          const fs::path binary = fs::path (options.save_binary) / name;
+          fs::create_directories (binary.parent_path ());
+          source_matrix->write_binary (binary.string () + ".csr");
+        }
+
+      auto matrix_json = measure_csr_matrix (*source_matrix, options);
+      matrix_json["path"] = file.string ();
+
+      json[name.generic_string ()] = matrix_json;
+    }
+
+  return json;
+}
+
+/// 1, 2, 4 ... all cpus, plus the cpus of first, first two ... NUMA nodes
+std::vector<unsigned int> get_scaling_threads_counts (const benchmark_options &options)
+{
+  if (!options.threads_counts.empty ())
+    return options.threads_counts;
+
+  const unsigned int max_threads = std::max (std::thread::hardware_concurrency (), 1u);
+  std::set<unsigned int> counts { max_threads };
+
+  for (unsigned int threads_count = 1; threads_count < max_threads; threads_count *= 2)
+    counts.insert (threads_count);
+
+  unsigned int node_threads = 0;
+  for (auto &node: thread_pool::get_numa_nodes ())
+    counts.insert (std::min (node_threads += node.size (), max_threads));
+
+  return { counts.begin (), counts.end () };
+}
+
+/**
+ * @brief Speedup and efficiency of each threaded CPU kernel relative to its run on the smallest threads count
+ *
+ * Strong scaling efficiency is T(p0) p0 / (T(p) p), weak scaling efficiency
+ * (work grows with p) is T(p0) / T(p).
+ */
+template<typename data_type, typename index_type>
+nlohmann::json measure_scaling (const benchmark_options &options)
+{
+  const auto threads_counts = get_scaling_threads_counts (options);
+  const bool weak = options.scaling == scaling_mode::weak;
 
   nlohmann::json json;
-  for (auto bs: {2, 4, 8, 16, 32})
+  json["mode"] = weak ? "weak" : "strong";
+  json["threads"] = threads_counts;
+
+  /// configuration -> kernel -> threads count -> measurement
+  std::map<std::string, std::map<std::string, std::map<unsigned int, nlohmann::json>>> results;
+
+  auto measure = [&] (
+    const std::string &configuration,
+    unsigned int threads_count,
+    csr_matrix_class<data_type, index_type> &matrix,
+    bcsr_matrix_class<data_type, index_type> &block_matrix)
+  {
+    fmt::print (fmt::fg (fmt::color::tomato), "\n{}, threads: {}\n", configuration, threads_count);
+
+    benchmark_options threads_options = options;
+    threads_options.threads_counts = { threads_count };
+
+    const auto measurements = perform_measurements (matrix, block_matrix, threads_options);
+    for (auto &result: measurements.items ())
+      results[configuration][result.key ()][threads_count] = result.value ();
+  };
+
+  auto measure_csr = [&] (const std::string &prefix, const csr_matrix_class<data_type, index_type> &source_matrix)
+  {
+    for (auto bs: options.block_sizes)
+      {
+        auto block_matrix = csr_to_bcsr<data_type, index_type> (source_matrix, bs);
+        auto matrix = std::make_unique<csr_matrix_class<data_type, index_type>> (*block_matrix);
+
+        for (auto threads_count: threads_counts)
+          measure (prefix + std::to_string (bs), threads_count, *matrix, *block_matrix);
+      }
+  };
+
+  switch (options.source)
+    {
+      case matrix_source::generator:
+        for (auto bs: options.block_sizes)
+          {
+            for (auto threads_count: threads_counts)
+              {
+                const index_type n_rows = weak ? options.n_rows * threads_count : options.n_rows;
+
+                auto block_matrix = gen_n_diag_bcsr<data_type, index_type> (n_rows, options.blocks_per_row, bs);
+                auto matrix = std::make_unique<csr_matrix_class<data_type, index_type>> (*block_matrix);
+
+                measure (std::to_string (bs), threads_count, *matrix, *block_matrix);
+              }
+          }
+        break;
+      case matrix_source::mtx:
+        for (auto &file: collect_mtx_files (options.input))
+          measure_csr (file.stem ().string () + "/", *read_csr_mm<data_type, index_type> (file.string ()));
+        break;
+      case matrix_source::binary:
+        measure_csr ({}, *read_csr_binary<data_type, index_type> (options.input));
+        break;
+      case matrix_source::bridge:
+        throw std::runtime_error ("Error! Scaling isn't supported for bridge model");
+    }
+
+  for (auto &[configuration, kernels]: results)
     {
-      auto result = measure_diag_matrices<float, int> (bs, 50'000, 6);
-      json[std::to_string(bs)] = result;
+      fmt::print (fmt::fg (fmt::color::tomato), "\n{} scaling efficiency, {}\n", weak ? "Weak" : "Strong", configuration);
+      fmt::print ("\t{:<40}", "threads");
+      for (auto threads_count: threads_counts)
+        fmt::print ("{:>8}", threads_count);
+      fmt::print ("\n");
+
+      for (auto &[kernel, measurements]: kernels)
+        {
+          const unsigned int base_threads = measurements.begin ()->first;
+          const double base_elapsed = measurements.begin ()->second["elapsed"];
+
+          fmt::print (fmt::fg (fmt::color::yellow), "\t{:<40}", kernel);
+
+          for (auto &[threads_count, measurement]: measurements)
+            {
+              const double elapsed = measurement["elapsed"];
+              const double speedup = base_elapsed / elapsed;
+              const double efficiency = weak ? speedup : speedup * base_threads / threads_count;
+
+              measurement["speedup"] = speedup;
+              measurement["efficiency"] = efficiency;
+              json["results"][configuration][kernel][std::to_string (threads_count)] = measurement;
+
+              fmt::print ("{:>7.1f}%", 100 * efficiency);
+            }
+          fmt::print ("\n");
+        }
     }
 
-  std::ofstream os ("result.json");
-  os << json.dump (2) << std::endl;
+  return json;
+}
+
+template<typename data_type, typename index_type>
+nlohmann::json run_benchmark (const benchmark_options &options)
+{
+  if (options.scaling != scaling_mode::none)
+    return measure_scaling<data_type, index_type> (options);
+
+  switch (options.source)
+    {
+      case matrix_source::generator:
+        {
+          nlohmann::json json;
+          for (auto bs: options.block_sizes)
+            json[std::to_string (bs)] = measure_diag_matrices<data_type, index_type> (bs, options.n_rows, options.blocks_per_row, options);
+          return json;
+        }
+      case matrix_source::mtx:
+        {
+          if (!options.save_binary.empty ())
+            std::filesystem::create_directories (options.save_binary);
+          return measure_mtx_matrices<data_type, index_type> (options.input, options);
+        }
+      case matrix_source::binary:
+        {
+          fmt::print (fmt::fg (fmt::color::tomato), "\nMatrix: {}\n", options.input);
+
+          auto source_matrix = read_csr_binary<data_type, index_type> (options.input);
+          auto matrix_json = measure_csr_matrix (*source_matrix, options);
+          matrix_json["path"] = options.input;
+
+          nlohmann::json json;
+          json[std::filesystem::path (options.input).stem ().string ()] = matrix_json;
+          return json;
+        }
+      case matrix_source::bridge:
+        {
+          if constexpr (std::is_same_v<index_type, int>)
+            return measure_golden_bridge<data_type, index_type> (options);
+          else
+            throw std::runtime_error ("Error! Bridge model is built with int32 indices only");
+        }
+    }
+
+  return {};
+}
 
-  #if 0
-    measure_golden_bridge<double, int> (false);
-  #endif
+int main (int argc, char *argv[])
+{
+  std::optional<benchmark_options> parsed_options;
+
+  try
+    {
+      parsed_options = parse_benchmark_options (argc, argv);
+    }
+  catch (const std::runtime_error &error)
+    {
+      std::cerr << error.what () << "\n\n" << get_benchmark_usage (argv[0]);
+      return 1;
+    }
+
+  if (!parsed_options)
+    {
+      std::cout << get_benchmark_usage (argv[0]);
+      return 0;
+    }
+
+  benchmark_options &options = *parsed_options;
+
+  nlohmann::json baseline;
+  if (!options.baseline.empty ())
+    {
+      std::ifstream is (options.baseline);
+
+      if (!is)
+        {
+          std::cerr << "Error! Can't open " << options.baseline << std::endl;
+          return 1;
+        }
+
+      baseline = nlohmann::json::parse (is);
+      apply_baseline_options (options, baseline);
+    }
+
+  if (options.isa)
+    {
+      try
+        {
+          force_cpu_isa (cpu_isa_from_string (*options.isa));
+        }
+      catch (const std::runtime_error &error)
+        {
+          std::cerr << error.what () << std::endl;
+          return 1;
+        }
+    }
 
-  return 0;
-}
\ No newline at end of file
+  fmt::print ("CPU ISA: {} (detected {})\n", to_string (get_cpu_isa ()), to_string (detect_cpu_isa ()));
+
+  cudaSetDevice (options.device);
+
+  /// Probes of the active level are looked up here, pool workers only call them
+  const auto peak_float = get_cpu_spmv_functions<float, int> ().peak;
+  const auto peak_double = get_cpu_spmv_functions<double, int> ().peak;
+
+  machine_limits::peak_kernels peak_kernels;
+  peak_kernels.isa = to_string (get_cpu_isa ());
+  peak_kernels.float_kernel = [peak_float] (unsigned long long iterations) { float sink; return peak_float (iterations, &sink); };
+  peak_kernels.double_kernel = [peak_double] (unsigned long long iterations) { double sink; return peak_double (iterations, &sink); };
+
+  const auto limits = machine_limits::load_or_measure (std::thread::hardware_concurrency (), peak_kernels);
+  fmt::print ("STREAM triad: {:.1f} GB/s; peak: {:.1f} GFLOP/s float, {:.1f} GFLOP/s double\n",
+              limits.bandwidth, limits.peak_gflops_float, limits.peak_gflops_double);
+
+  options.settings.limits = &limits;
+
+  nlohmann::json json;
+
+  try
+    {
+      const bool is_double = options.data_type == "double";
+      const bool is_int64 = options.index_type == "int64";
+
+      if (is_double)
+        json = is_int64 ? run_benchmark<double, std::int64_t> (options) : run_benchmark<double, int> (options);
+      else
+        json = is_int64 ? run_benchmark<float, std::int64_t> (options) : run_benchmark<float, int> (options);
+    }
+  catch (const std::runtime_error &error)
+    {
+      std::cerr << error.what () << std::endl;
+      return 1;
+    }
+
+  if (options.source == matrix_source::bridge && options.solve)
+    {
+      if (!json.is_null ())
+        {
+          std::ofstream os (options.output);
+          os << json.dump (2) << std::endl;
+        }
+      return 0;
+    }
+
+  json["machine"] = limits.to_json ();
+  json["isa"]["detected"] = to_string (detect_cpu_isa ());
+  json["isa"]["used"] = to_string (get_cpu_isa ());
+  json["isa"]["forced"] = is_cpu_isa_forced ();
+  json["options"] = benchmark_options_to_json (options);
+
+  bool has_regressions = false;
+  if (!baseline.is_null ())
+    {
+      auto comparisons = compare_to_baseline (baseline, json, options.regression_threshold);
+
+      fmt::print (fmt::fg (fmt::color::tomato), "\nComparison with {} (threshold {:.1f}%)\n", options.baseline, 100 * options.regression_threshold);
+
+      for (auto &comparison: comparisons)
+        {
+          has_regressions |= comparison.regression;
+          json["comparison"].push_back (comparison.to_json ());
+
+          const auto color = comparison.regression ? fmt::color::red
+                           : comparison.relative_change < -options.regression_threshold ? fmt::color::green
+                           : fmt::color::white;
+          fmt::print (fmt::fg (color), "\t{:<20} {:<70} {:>+8.2f}%  t = {:.2f}{}\n",
+                      comparison.configuration, comparison.kernel, 100 * comparison.relative_change,
+                      comparison.t_statistic, comparison.regression ? "  REGRESSION" : "");
+        }
+    }
+
+  std::ofstream os (options.output);
+  os << json.dump (2) << std::endl;
+
+  return has_regressions ? 2 : 0;
+}
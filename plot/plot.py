@@ -1,3 +1,7 @@
+import json
+import sys
+
+import numpy as np
 import pandas as pd
 import matplotlib.pyplot as plt
 import seaborn as sns
@@ -14,8 +18,69 @@ def setup_printer():
     pd.set_option('expand_frame_repr', False)
 
 
-def load_data(file):
-    return pd.read_json(file).T
+# Top level keys that aren't measurements, same as metadata_keys of common/regression_check.cpp
+metadata_keys = ['machine', 'isa', 'options', 'comparison', 'path', 'n_rows', 'n_cols', 'nnz', 'nnzb', 'fill_ratio']
+
+
+def load_data(file, statistic='elapsed'):
+    with open(file) as f:
+        results = json.load(f)
+
+    df = pd.DataFrame({key: value for key, value in results.items() if key not in metadata_keys}).T
+    return df.applymap(lambda cell: cell[statistic] if isinstance(cell, dict) else cell)
+
+
+def plot_roofline(file, bs, filename=''):
+    with open(file) as f:
+        results = json.load(f)
+
+    machine = results['machine']
+    dtype = results['options']['dtype']
+    peak = machine['peak_gflops_' + dtype]
+    intensity = np.logspace(-3, 2, 200)
+    roof = np.minimum(peak, intensity * machine['bandwidth'])
+
+    fig, ax = plt.subplots(figsize=(10, 6))
+    ax.loglog(intensity, roof, color='black', label='STREAM {:.1f} GB/s, {} peak {:.1f} GFLOP/s'.format(
+        machine['bandwidth'], dtype, peak))
+
+    for kernel, result in results[str(bs)].items():
+        if 'roofline' in result:
+            ax.scatter(result['roofline']['arithmetic_intensity'], result['throughput'], label=kernel)
+
+    ax.set(xlabel='Arithmetic intensity (FLOP/byte)', ylabel='GFLOP/s', title='Roofline, bs = {}'.format(bs))
+    plt.legend(prop={'size': 10})
+
+    if filename:
+        plt.savefig(filename, dpi=200, bbox_inches='tight')
+    else:
+        plt.show()
+
+
+def plot_scaling(file, filename=''):
+    with open(file) as f:
+        results = json.load(f)
+
+    mode = results['mode']
+    configurations = results['results']
+
+    fig, axes = plt.subplots(1, len(configurations), figsize=(6 * len(configurations), 5), squeeze=False, sharey=True)
+
+    for ax, (configuration, kernels) in zip(axes[0], configurations.items()):
+        for kernel, measurements in kernels.items():
+            threads = sorted(int(count) for count in measurements)
+            efficiency = [measurements[str(count)]['efficiency'] for count in threads]
+            ax.plot(threads, efficiency, marker='o', label=kernel)
+
+        ax.axhline(1.0, color='black', linewidth=0.8)
+        ax.set_xscale('log', base=2)
+        ax.set(xlabel='Threads', ylabel='{} scaling efficiency'.format(mode.capitalize()), title=configuration)
+        ax.legend(prop={'size': 10})
+
+    if filename:
+        plt.savefig(filename, dpi=200, bbox_inches='tight')
+    else:
+        plt.show()
 
 
 def calculate_speedup(df, base='CPU CSR'):
@@ -30,6 +95,14 @@ def calculate_speedup(df, base='CPU CSR'):
 
 setup_printer()
 
+if len(sys.argv) > 2 and sys.argv[1] == '--roofline':
+    plot_roofline('{}/result.json'.format(path_to_results), sys.argv[2])
+    sys.exit(0)
+
+if len(sys.argv) > 2 and sys.argv[1] == '--scaling':
+    plot_scaling(sys.argv[2], sys.argv[3] if len(sys.argv) > 3 else '')
+    sys.exit(0)
+
 source_df = load_data('{}/result.json'.format(path_to_results))
 float_speedup = calculate_speedup(source_df).reset_index()
 